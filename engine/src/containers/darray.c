@@ -74,7 +74,7 @@ void _darray_pop(void *darray, void *dest) {
     vcopy_memory(dest, src, stride);
     darray_length_set(darray, length - 1);
   } else {
-    VERROR("darray_pop called on empty array");
+    VERROR_CAT(LOG_CATEGORY_MEMORY, "darray_pop called on empty array");
   }
 }
 
@@ -83,7 +83,8 @@ void _darray_remove(void *darray, u64 index, void *dest) {
   u64 stride = darray_stride(darray);
 
   if (index >= length) {
-    VERROR(
+    VERROR_CAT(
+        LOG_CATEGORY_MEMORY,
         "darray_remove called with index out of bounds: length=%lu, index=%lu",
         length, index);
     return;
@@ -107,7 +108,8 @@ void *_darray_insert(void *darray, u64 index, const void *element) {
   u64 length = darray_length(darray);
   u64 stride = darray_stride(darray);
   if (index >= length) {
-    VERROR(
+    VERROR_CAT(
+        LOG_CATEGORY_MEMORY,
         "darray_insert called with index out of bounds: length=%lu, index=%lu",
         length, index);
     return darray;
@@ -1,16 +1,110 @@
 #include <core/application.h>
 
+#include <core/async_io.h>
 #include <core/event.h>
+#include <core/game_module.h>
 #include <core/input.h>
+#include <core/job.h>
 #include <core/logger.h>
+#include <core/snapshot.h>
+#include <core/task_graph.h>
 #include <core/vmemory.h>
 #include <game_types.h>
+#include <memory/linear_allocator.h>
+#include <platform/atomic.h>
 #include <platform/platform.h>
 
 // TODO: Custom string library.
+#include <stdlib.h>
 #include <string.h>
 
+// Sleeping wakes up late by an unpredictable amount, so the last stretch
+// before a frame deadline is spun instead. This is the minimum spin margin.
+#define FRAME_PACING_MIN_SPIN_SECONDS 0.0005
+
+// Upper bound on the spin margin, as a fraction of the target frame time.
+// Oversleeps beyond it (the process was descheduled, stopped in a debugger or
+// suspended) are outliers and do not feed the estimate.
+#define FRAME_PACING_MAX_SPIN_FRACTION 0.25
+
+// Per-frame decay of the overshoot estimate towards the minimum spin margin.
+#define FRAME_PACING_OVERSHOOT_DECAY 0.99
+
+// Fixed updates per frame when application_config leaves it at 0.
+#define DEFAULT_MAX_UPDATES_PER_FRAME 5
+
+// How long a suspended application blocks waiting for window messages before
+// running a background tick.
+#define SUSPENDED_TICK_MS 100
+
+// How often frame pacing statistics are reported.
+#define FRAME_PACING_REPORT_INTERVAL_SECONDS 5.0
+
+typedef struct frame_pacing {
+  // Seconds per frame, or 0 when uncapped.
+  f64 target_frame_time;
+  // Absolute time the current frame should end at.
+  f64 next_deadline;
+  // Running estimate of how much later than asked platform_sleep returns.
+  f64 sleep_overshoot;
+
+  // Statistics since the last report.
+  f64 report_start;
+  u64 frame_count;
+  // Frames whose work was still running when their deadline passed.
+  u64 missed_count;
+  f64 total_deviation;
+  f64 max_deviation;
+} frame_pacing;
+
+/**
+ * Renders on a dedicated thread, one frame behind update. At each sync point
+ * the main thread waits for the previous render, copies the freshly updated
+ * game state into render_game's state and starts the next render.
+ */
+typedef struct render_pipeline {
+  platform_thread thread;
+  platform_semaphore start;
+  platform_semaphore done;
+  // Copy of the game whose state points at the render copy of the state.
+  game render_game;
+  f64 delta_time;
+  f64 alpha;
+  // Result of the last render. Only read after done is signalled.
+  b8 result;
+  b8 in_flight;
+  b8 quit;
+} render_pipeline;
+
+// Subsystems whose state is carved out of the engine's memory block, in the
+// order they are laid out.
+typedef enum engine_subsystem {
+  ENGINE_SUBSYSTEM_LOGGER,
+  ENGINE_SUBSYSTEM_JOB,
+  ENGINE_SUBSYSTEM_TASK_GRAPH,
+  ENGINE_SUBSYSTEM_SNAPSHOT,
+  ENGINE_SUBSYSTEM_EVENT,
+  ENGINE_SUBSYSTEM_INPUT,
+  ENGINE_SUBSYSTEM_ASYNC_IO,
+
+  ENGINE_SUBSYSTEM_MAX_COUNT
+} engine_subsystem;
+
+static const char *engine_subsystem_names[ENGINE_SUBSYSTEM_MAX_COUNT] = {
+    "logger", "jobs",  "task graph", "snapshots",
+    "events", "input", "async io"};
+
 typedef struct application_state {
+  // One cache line aligned block holding this state followed by the state of
+  // every subsystem.
+  void *memory;
+  u64 memory_size;
+  void *subsystem_states[ENGINE_SUBSYSTEM_MAX_COUNT];
+  u64 subsystem_sizes[ENGINE_SUBSYSTEM_MAX_COUNT];
+  // What has come up so far, so a failed startup shuts down only that.
+  b8 is_subsystem_up[ENGINE_SUBSYSTEM_MAX_COUNT];
+  b8 is_platform_up;
+
   game *game_instance;
   b8 is_running;
   b8 is_suspended;
@@ -18,10 +112,29 @@ typedef struct application_state {
   u32 width;
   u32 height;
   f64 last_frame_time;
+  // Seconds per fixed update, or 0 for a variable timestep.
+  f64 fixed_update_time;
+  // Simulation time not yet consumed by fixed updates.
+  f64 update_accumulator;
+  u32 max_updates_per_frame;
+  // Updates run this frame. Input only advances after a frame that ran one,
+  // so a press in a frame without a fixed update is not lost.
+  u32 update_count;
+  // Interpolation alpha produced by this frame's update for its render.
+  f64 alpha;
+  // Window state that decides is_suspended.
+  b8 is_visible;
+  b8 has_focus;
+  frame_pacing pacing;
+  // Frames run so far. Numbers the snapshots.
+  u64 frame_number;
+  // Only set up when rendering is pipelined.
+  b8 is_pipelined;
+  render_pipeline pipeline;
 } application_state;
 
 static b8 is_initialized = FALSE;
-static application_state app_state;
+static application_state *app_state;
 
 b8 application_on_event(u16 code, void *sender, void *listener_instance,
                         event_context context);
@@ -29,50 +142,420 @@ b8 application_on_event(u16 code, void *sender, void *listener_instance,
 b8 application_on_key(u16 code, void *sender, void *listener_instance,
                       event_context context);
 
-b8 application_init(game *game_instance) {
-  if (is_initialized) {
-    VERROR("application_init called more than once");
-    return FALSE;
+b8 application_on_window(u16 code, void *sender, void *listener_instance,
+                         event_context context);
+
+static b8 application_register_tasks();
+
+// Upper bound on the timed phases of application_init.
+#define STARTUP_MAX_PHASES 16
+
+typedef struct startup_phase {
+  const char *name;
+  // Offset from the start of application_init.
+  f64 offset;
+  f64 duration;
+} startup_phase;
+
+typedef struct startup_timing {
+  f64 start;
+  // Phases running on other threads record themselves concurrently.
+  atomic_u32 phase_count;
+  startup_phase phases[STARTUP_MAX_PHASES];
+} startup_timing;
+
+// Shared with the startup job.
+typedef struct startup_context {
+  game *game_instance;
+  b8 game_result;
+} startup_context;
+
+static startup_timing startup;
+
+static void startup_phase_end(const char *name, f64 phase_start) {
+  f64 now = platform_get_absolute_time();
+  u32 index =
+      vatomic_fetch_add_u32(&startup.phase_count, 1, VMEMORY_ORDER_RELAXED);
+  if (index < STARTUP_MAX_PHASES) {
+    startup.phases[index] = (startup_phase){
+        name, phase_start - startup.start, now - phase_start};
+  }
+}
+
+static void startup_report() {
+  f64 total = platform_get_absolute_time() - startup.start;
+  u32 count =
+      vatomic_load_u32(&startup.phase_count, VMEMORY_ORDER_ACQUIRE);
+  if (count > STARTUP_MAX_PHASES) {
+    count = STARTUP_MAX_PHASES;
   }
 
-  app_state.game_instance = game_instance;
+  VINFO("Startup took %.2f ms:", total * 1000.0);
+  f64 phase_total = 0.0;
+  for (u32 i = 0; i < count; ++i) {
+    startup_phase *phase = &startup.phases[i];
+    VINFO("  %-12s %8.2f ms, started at +%.2f ms", phase->name,
+          phase->duration * 1000.0, phase->offset * 1000.0);
+    phase_total += phase->duration;
+  }
 
-  app_state.is_running = TRUE;
-  app_state.is_suspended = FALSE;
+  if (phase_total > total) {
+    VINFO("  Running phases concurrently saved %.2f ms.",
+          (phase_total - total) * 1000.0);
+  }
+}
 
-  /* initialize the subsystems. */
+/**
+ * Creates the window. Must run on the main thread, which owns the window's
+ * message queue, after events and input are up, since the window may
+ * produce events as soon as it exists.
+ */
+static b8 startup_platform(game *game_instance, b8 headless) {
+  f64 phase_start = platform_get_absolute_time();
+  b8 result = platform_init(
+      &app_state->platform, game_instance->app_config.name,
+      game_instance->app_config.start_pos_x,
+      game_instance->app_config.start_pos_y, game_instance->app_config.width,
+      game_instance->app_config.height, headless);
+  startup_phase_end("platform", phase_start);
 
-  if (platform_init(&app_state.platform, game_instance->app_config.name,
-                    game_instance->app_config.start_pos_x,
-                    game_instance->app_config.start_pos_y,
-                    game_instance->app_config.width,
-                    game_instance->app_config.height)) {
+  app_state->is_platform_up = result;
+  if (result) {
     VINFO("Platform initialized successfully.");
   } else {
     VFATAL("Platform failed to initialize.");
-    return FALSE;
-  }
-
-  if (logger_init()) {
-    VINFO("Logger initialized successfully.");
-  } else {
-    VERROR("Failed to initialize logger.");
-    return FALSE;
   }
+  return result;
+}
 
-  if (events_init()) {
+// Brings up events and input and registers the application's handlers.
+static b8 startup_events_and_input() {
+  u64 memory_requirement = 0;
+  f64 phase_start = platform_get_absolute_time();
+  if (events_init(&memory_requirement,
+                  app_state->subsystem_states[ENGINE_SUBSYSTEM_EVENT])) {
+    app_state->is_subsystem_up[ENGINE_SUBSYSTEM_EVENT] = TRUE;
     VINFO("Event system initialized successfully.");
   } else {
     VERROR("Failed to initialize event system.");
     return FALSE;
   }
+  startup_phase_end("events", phase_start);
 
-  input_init();
+  phase_start = platform_get_absolute_time();
+  input_init(&memory_requirement,
+             app_state->subsystem_states[ENGINE_SUBSYSTEM_INPUT]);
+  app_state->is_subsystem_up[ENGINE_SUBSYSTEM_INPUT] = TRUE;
   VINFO("Input system initialized.");
+  startup_phase_end("input", phase_start);
+
+  snapshot_register("input",
+                    app_state->subsystem_states[ENGINE_SUBSYSTEM_INPUT],
+                    app_state->subsystem_sizes[ENGINE_SUBSYSTEM_INPUT]);
 
   event_register(EVENT_CODE_APPLICATION_QUIT, NULL, application_on_event);
   event_register(EVENT_CODE_KEY_PRESSED, NULL, application_on_key);
   event_register(EVENT_CODE_KEY_RELEASED, NULL, application_on_key);
+  event_register(EVENT_CODE_WINDOW_RESIZED, NULL, application_on_window);
+  event_register(EVENT_CODE_WINDOW_VISIBILITY_CHANGED, NULL,
+                 application_on_window);
+  return TRUE;
+}
+
+/**
+ * Brings up async I/O, then the game, which loads its assets in its
+ * initialize. Runs while the main thread creates the window, so the game
+ * must not expect the window to exist before on_resize.
+ */
+static void startup_game_job(void *params) {
+  startup_context *context = (startup_context *)params;
+  context->game_result = FALSE;
+
+  // Before the game, which may start loading assets in initialize.
+  u64 memory_requirement = 0;
+  f64 phase_start = platform_get_absolute_time();
+  if (async_io_init(&memory_requirement,
+                    app_state->subsystem_states[ENGINE_SUBSYSTEM_ASYNC_IO])) {
+    app_state->is_subsystem_up[ENGINE_SUBSYSTEM_ASYNC_IO] = TRUE;
+    VINFO("Async I/O initialized successfully.");
+  } else {
+    VERROR("Failed to initialize async I/O.");
+    return;
+  }
+  startup_phase_end("async io", phase_start);
+
+  // Initialize the game.
+  phase_start = platform_get_absolute_time();
+  if (!context->game_instance->initialize(context->game_instance)) {
+    VFATAL("Failed to initialize the game.");
+    return;
+  }
+  startup_phase_end("game", phase_start);
+
+  if (context->game_instance->state_size) {
+    snapshot_register("game", context->game_instance->state,
+                      context->game_instance->state_size);
+  }
+
+  context->game_result = TRUE;
+}
+
+static b8 render_pipeline_start();
+
+/**
+ * Queries every subsystem for the memory it needs and allocates the
+ * application state and all subsystem states as one block, each part starting
+ * on its own cache line.
+ */
+static b8 engine_memory_create(game *game_instance) {
+  u64 sizes[ENGINE_SUBSYSTEM_MAX_COUNT];
+  logger_init(&sizes[ENGINE_SUBSYSTEM_LOGGER], NULL);
+  job_system_init(&sizes[ENGINE_SUBSYSTEM_JOB], NULL,
+                  game_instance->app_config.job_worker_count);
+  task_graph_init(&sizes[ENGINE_SUBSYSTEM_TASK_GRAPH], NULL);
+  snapshot_system_init(&sizes[ENGINE_SUBSYSTEM_SNAPSHOT], NULL,
+                       game_instance->app_config.snapshot_frame_count);
+  events_init(&sizes[ENGINE_SUBSYSTEM_EVENT], NULL);
+  input_init(&sizes[ENGINE_SUBSYSTEM_INPUT], NULL);
+  async_io_init(&sizes[ENGINE_SUBSYSTEM_ASYNC_IO], NULL);
+
+  u64 total_size = VALIGN_UP(sizeof(application_state), VCACHE_LINE_SIZE);
+  for (u32 i = 0; i < ENGINE_SUBSYSTEM_MAX_COUNT; ++i) {
+    total_size += VALIGN_UP(sizes[i], VCACHE_LINE_SIZE);
+  }
+
+  void *memory = vallocate_aligned(total_size, MEMORY_TAG_APPLICATION);
+  if (!memory) {
+    return FALSE;
+  }
+
+  linear_allocator allocator;
+  linear_allocator_create(total_size, memory, &allocator);
+  app_state = linear_allocator_allocate(&allocator, sizeof(application_state),
+                                        VCACHE_LINE_SIZE);
+  app_state->memory = memory;
+  app_state->memory_size = total_size;
+  for (u32 i = 0; i < ENGINE_SUBSYSTEM_MAX_COUNT; ++i) {
+    app_state->subsystem_states[i] =
+        linear_allocator_allocate(&allocator, sizes[i], VCACHE_LINE_SIZE);
+    app_state->subsystem_sizes[i] = sizes[i];
+  }
+
+  return TRUE;
+}
+
+// Logs the layout of the engine's memory block. Needs the logger.
+static void engine_memory_report() {
+  VINFO("Engine state: %llu bytes in one block.", app_state->memory_size);
+  for (u32 i = 0; i < ENGINE_SUBSYSTEM_MAX_COUNT; ++i) {
+    VDEBUG("  %-12s at +%llu", engine_subsystem_names[i],
+           (u64)((u8 *)app_state->subsystem_states[i] -
+                 (u8 *)app_state->memory));
+  }
+}
+
+static void log_cpu_info() {
+  platform_cpu_info cpu;
+  platform_get_cpu_info(&cpu);
+
+  const char *feature_names[] = {"SSE4.2", "AVX", "AVX2",
+                                 "FMA",    "AVX-512F", "NEON"};
+  char features[64] = "";
+  for (u32 i = 0; i < sizeof(feature_names) / sizeof(feature_names[0]); ++i) {
+    if (cpu.features & (1u << i)) {
+      strcat(features, " ");
+      strcat(features, feature_names[i]);
+    }
+  }
+
+  VINFO("CPU: %s", cpu.model_name[0] ? cpu.model_name : "unknown");
+  VINFO("  %u cores, %u threads, L1d %u KiB, L2 %u KiB, L3 %u KiB, %u byte "
+        "lines, features:%s",
+        cpu.physical_core_count, cpu.logical_core_count,
+        cpu.l1_data_cache_size / 1024, cpu.l2_cache_size / 1024,
+        cpu.l3_cache_size / 1024, cpu.cache_line_size,
+        features[0] ? features : " none");
+}
+
+/**
+ * Shuts down, in the reverse of their startup order, the subsystems that have
+ * come up, then frees the engine's block. Ends both application_run and a
+ * failed application_init, after which another instance can be started.
+ */
+static void engine_shutdown() {
+  b8 *is_up = app_state->is_subsystem_up;
+
+  if (app_state->is_platform_up) {
+    platform_shutdown(&app_state->platform);
+    VINFO("Platform shutdown.");
+  }
+
+  if (is_up[ENGINE_SUBSYSTEM_ASYNC_IO]) {
+    async_io_shutdown();
+    VINFO("Async I/O shutdown.");
+  }
+
+  if (is_up[ENGINE_SUBSYSTEM_INPUT]) {
+    input_shutdown();
+    VINFO("Input system shutdown.");
+  }
+
+  if (is_up[ENGINE_SUBSYSTEM_EVENT]) {
+    event_unregister(EVENT_CODE_APPLICATION_QUIT, NULL, application_on_event);
+    event_unregister(EVENT_CODE_KEY_PRESSED, NULL, application_on_key);
+    event_unregister(EVENT_CODE_KEY_RELEASED, NULL, application_on_key);
+    event_unregister(EVENT_CODE_WINDOW_RESIZED, NULL, application_on_window);
+    event_unregister(EVENT_CODE_WINDOW_VISIBILITY_CHANGED, NULL,
+                     application_on_window);
+    events_shutdown();
+    VINFO("Event system shutdown.");
+  }
+
+  if (is_up[ENGINE_SUBSYSTEM_SNAPSHOT]) {
+    snapshot_system_shutdown();
+    VINFO("Snapshot system shutdown.");
+  }
+
+  if (is_up[ENGINE_SUBSYSTEM_TASK_GRAPH]) {
+    task_graph_shutdown();
+    VINFO("Task graph shutdown.");
+  }
+
+  if (is_up[ENGINE_SUBSYSTEM_JOB]) {
+    job_system_shutdown();
+    VINFO("Job system shutdown.");
+  }
+
+  if (is_up[ENGINE_SUBSYSTEM_LOGGER]) {
+    logger_shutdown();
+    VINFO("Logger shutdown.");
+  }
+
+  // The application state lives in the block too.
+  void *memory = app_state->memory;
+  u64 memory_size = app_state->memory_size;
+  app_state = NULL;
+  is_initialized = FALSE;
+  vfree_aligned(memory, memory_size, MEMORY_TAG_APPLICATION);
+}
+
+// Unwinds whatever application_init brought up before it failed.
+static b8 application_init_failed() {
+  engine_shutdown();
+  return FALSE;
+}
+
+b8 application_init(game *game_instance) {
+  if (is_initialized) {
+    VERROR("An engine instance is already running in this process.");
+    return FALSE;
+  }
+
+  vzero_memory(&startup, sizeof(startup));
+  startup.start = platform_get_absolute_time();
+
+  f64 phase_start = startup.start;
+  if (!engine_memory_create(game_instance)) {
+    VFATAL("Failed to allocate the engine state.");
+    return FALSE;
+  }
+  startup_phase_end("memory", phase_start);
+
+  app_state->game_instance = game_instance;
+
+  app_state->is_running = TRUE;
+  app_state->is_suspended = FALSE;
+  app_state->is_visible = TRUE;
+  app_state->has_focus = TRUE;
+  app_state->width = game_instance->app_config.width;
+  app_state->height = game_instance->app_config.height;
+
+  u32 fixed_update_rate = game_instance->app_config.fixed_update_rate;
+  app_state->fixed_update_time =
+      fixed_update_rate ? 1.0 / (f64)fixed_update_rate : 0.0;
+  app_state->update_accumulator = 0.0;
+  app_state->max_updates_per_frame =
+      game_instance->app_config.max_updates_per_frame
+          ? game_instance->app_config.max_updates_per_frame
+          : DEFAULT_MAX_UPDATES_PER_FRAME;
+
+  app_state->is_pipelined = game_instance->app_config.pipelined_rendering;
+  if (app_state->is_pipelined && !game_instance->state_size) {
+    VWARN("Pipelined rendering needs the game state_size. Rendering serially.");
+    app_state->is_pipelined = FALSE;
+  }
+
+  const char *headless_env = getenv("VIVID_HEADLESS");
+  b8 headless = game_instance->app_config.headless ||
+                (headless_env && strcmp(headless_env, "1") == 0);
+
+  /* initialize the subsystems. */
+
+  // The logger and job system come first: everything else logs, and the
+  // game loads in a job.
+  u64 memory_requirement = 0;
+  phase_start = platform_get_absolute_time();
+  if (logger_init(&memory_requirement,
+                  app_state->subsystem_states[ENGINE_SUBSYSTEM_LOGGER])) {
+    app_state->is_subsystem_up[ENGINE_SUBSYSTEM_LOGGER] = TRUE;
+    VINFO("Logger initialized successfully.");
+    log_cpu_info();
+    engine_memory_report();
+  } else {
+    VERROR("Failed to initialize logger.");
+    return application_init_failed();
+  }
+  startup_phase_end("logger", phase_start);
+
+  phase_start = platform_get_absolute_time();
+  if (job_system_init(&memory_requirement,
+                      app_state->subsystem_states[ENGINE_SUBSYSTEM_JOB],
+                      game_instance->app_config.job_worker_count)) {
+    app_state->is_subsystem_up[ENGINE_SUBSYSTEM_JOB] = TRUE;
+    VINFO("Job system initialized successfully.");
+  } else {
+    VERROR("Failed to initialize job system.");
+    return application_init_failed();
+  }
+  startup_phase_end("jobs", phase_start);
+
+  phase_start = platform_get_absolute_time();
+  app_state->is_subsystem_up[ENGINE_SUBSYSTEM_TASK_GRAPH] = task_graph_init(
+      &memory_requirement,
+      app_state->subsystem_states[ENGINE_SUBSYSTEM_TASK_GRAPH]);
+  if (app_state->is_subsystem_up[ENGINE_SUBSYSTEM_TASK_GRAPH] &&
+      application_register_tasks()) {
+    VINFO("Task graph initialized successfully.");
+  } else {
+    VERROR("Failed to initialize task graph.");
+    return application_init_failed();
+  }
+  startup_phase_end("task graph", phase_start);
+
+  if (!snapshot_system_init(
+          &memory_requirement,
+          app_state->subsystem_states[ENGINE_SUBSYSTEM_SNAPSHOT],
+          game_instance->app_config.snapshot_frame_count)) {
+    VERROR("Failed to initialize snapshot system.");
+    return application_init_failed();
+  }
+  app_state->is_subsystem_up[ENGINE_SUBSYSTEM_SNAPSHOT] = TRUE;
+
+  if (!startup_events_and_input()) {
+    return application_init_failed();
+  }
+
+  // The game loads on a worker while the main thread creates the window.
+  startup_context context = {.game_instance = game_instance};
+  job_desc game_job = {startup_game_job, &context, JOB_PRIORITY_HIGH};
+  job_counter counter = {0};
+  job_submit(&game_job, &counter);
+  b8 platform_result = startup_platform(game_instance, headless);
+  job_wait(&counter);
+
+  if (!platform_result || !context.game_result) {
+    return application_init_failed();
+  }
 
   // TODO: Remove these messages.
   VFATAL("A test fatal log message: %d", 42);
@@ -82,71 +565,441 @@ b8 application_init(game *game_instance) {
   VDEBUG("A test debug log message: %d", 42);
   VTRACE("A test trace log message: %d", 42);
 
-  // Initialize the game.
-  if (!app_state.game_instance->initialize(app_state.game_instance)) {
-    VFATAL("Failed to initialize the game.");
-    return FALSE;
+  app_state->game_instance->on_resize(app_state->game_instance,
+                                      app_state->width, app_state->height);
+
+  if (app_state->is_pipelined) {
+    if (!render_pipeline_start()) {
+      VFATAL("Failed to start the render thread.");
+      return application_init_failed();
+    }
+    VINFO("Pipelined rendering enabled.");
   }
 
-  app_state.game_instance->on_resize(app_state.game_instance, app_state.width,
-                                     app_state.height);
+  startup_report();
 
   is_initialized = TRUE;
 
   return TRUE;
 }
 
+static void frame_pacing_init(frame_pacing *pacing, u32 target_frame_rate) {
+  vzero_memory(pacing, sizeof(frame_pacing));
+  pacing->target_frame_time =
+      target_frame_rate ? 1.0 / (f64)target_frame_rate : 0.0;
+  pacing->sleep_overshoot = FRAME_PACING_MIN_SPIN_SECONDS;
+  pacing->report_start = platform_get_absolute_time();
+  pacing->next_deadline = pacing->report_start + pacing->target_frame_time;
+}
+
+static void frame_pacing_report(frame_pacing *pacing, f64 now) {
+  if (pacing->frame_count) {
+    VDEBUG("Frame pacing: %llu frames, %llu missed deadline, deviation avg "
+           "%.3f ms, max %.3f ms.",
+           pacing->frame_count, pacing->missed_count,
+           pacing->total_deviation / (f64)pacing->frame_count * 1000.0,
+           pacing->max_deviation * 1000.0);
+  }
+
+  pacing->report_start = now;
+  pacing->frame_count = 0;
+  pacing->missed_count = 0;
+  pacing->total_deviation = 0.0;
+  pacing->max_deviation = 0.0;
+}
+
+/**
+ * Idles until the current frame's deadline: sleeps while the deadline is far
+ * enough away, then spins for sub-millisecond precision. Records how far from
+ * the deadline the frame actually ended.
+ */
+static void frame_pacing_wait(frame_pacing *pacing) {
+  if (pacing->target_frame_time <= 0.0) {
+    return;
+  }
+
+  f64 max_overshoot =
+      pacing->target_frame_time * FRAME_PACING_MAX_SPIN_FRACTION;
+  if (max_overshoot < FRAME_PACING_MIN_SPIN_SECONDS) {
+    max_overshoot = FRAME_PACING_MIN_SPIN_SECONDS;
+  }
+
+  // Decay the estimate once a frame, whether or not this frame sleeps, so a
+  // run of frames with too little time left to sleep cannot pin it high.
+  pacing->sleep_overshoot =
+      pacing->sleep_overshoot * FRAME_PACING_OVERSHOOT_DECAY +
+      FRAME_PACING_MIN_SPIN_SECONDS * (1.0 - FRAME_PACING_OVERSHOOT_DECAY);
+
+  f64 now = platform_get_absolute_time();
+  b8 missed = now > pacing->next_deadline;
+
+  f64 remaining = pacing->next_deadline - now;
+  while (remaining > pacing->sleep_overshoot) {
+    u64 sleep_ms = (u64)((remaining - pacing->sleep_overshoot) * 1000.0);
+    if (sleep_ms == 0) {
+      break;
+    }
+
+    platform_sleep(sleep_ms);
+    f64 after = platform_get_absolute_time();
+
+    // Track the worst recent overshoot. Outliers are dropped: one would
+    // otherwise leave too little time to sleep and the frame would spin.
+    f64 overshoot = (after - now) - (f64)sleep_ms / 1000.0;
+    if (overshoot > pacing->sleep_overshoot && overshoot <= max_overshoot) {
+      pacing->sleep_overshoot = overshoot;
+    }
+
+    now = after;
+    remaining = pacing->next_deadline - now;
+  }
+
+  while (now < pacing->next_deadline) {
+    now = platform_get_absolute_time();
+  }
+
+  f64 deviation = now - pacing->next_deadline;
+  pacing->frame_count++;
+  pacing->missed_count += missed;
+  pacing->total_deviation += deviation;
+  if (deviation > pacing->max_deviation) {
+    pacing->max_deviation = deviation;
+  }
+
+  pacing->next_deadline += pacing->target_frame_time;
+  if (pacing->next_deadline < now) {
+    // Fell more than a whole frame behind. Start a fresh schedule rather
+    // than rushing through frames to catch up.
+    pacing->next_deadline = now + pacing->target_frame_time;
+  }
+
+  if (now - pacing->report_start >= FRAME_PACING_REPORT_INTERVAL_SECONDS) {
+    frame_pacing_report(pacing, now);
+  }
+}
+
+/**
+ * Runs the game's update for this frame. With a fixed update rate, consumes
+ * the accumulated frame time in fixed steps and returns the interpolation
+ * alpha for rendering through out_alpha.
+ */
+static b8 application_update(f64 delta_time, f64 *out_alpha) {
+  game *game_instance = app_state->game_instance;
+
+  if (app_state->fixed_update_time <= 0.0) {
+    *out_alpha = 1.0;
+    app_state->update_count = 1;
+    return game_instance->update(game_instance, delta_time);
+  }
+
+  const f64 step = app_state->fixed_update_time;
+  app_state->update_accumulator += delta_time;
+
+  u32 steps = 0;
+  b8 result = TRUE;
+  while (app_state->update_accumulator >= step &&
+         steps < app_state->max_updates_per_frame) {
+    // Only the first update of the frame sees its presses and releases.
+    input_hide_edges(steps > 0);
+    result = game_instance->update(game_instance, step);
+    if (!result) {
+      break;
+    }
+    app_state->update_accumulator -= step;
+    ++steps;
+  }
+  input_hide_edges(FALSE);
+  app_state->update_count = steps;
+  if (!result) {
+    return FALSE;
+  }
+
+  if (app_state->update_accumulator >= step) {
+    // Updates cannot keep up. Drop the backlog rather than falling further
+    // behind every frame (the "spiral of death").
+    VLOG_RATE_LIMITED(LOG_CATEGORY_GENERAL, LOG_LEVEL_DEBUG, 1,
+                      "Simulation fell behind, dropping %.2f ms of updates.",
+                      (app_state->update_accumulator - step) * 1000.0);
+    while (app_state->update_accumulator >= step) {
+      app_state->update_accumulator -= step;
+    }
+  }
+
+  *out_alpha = app_state->update_accumulator / step;
+  return TRUE;
+}
+
+/**
+ * Suspends the application while its window cannot be seen (minimized, hidden
+ * or zero-sized) or, if configured, while it does not have focus.
+ */
+static void application_update_suspended() {
+  b8 suspended =
+      !app_state->is_visible || app_state->width == 0 ||
+      app_state->height == 0 ||
+      (app_state->game_instance->app_config.suspend_when_unfocused &&
+       !app_state->has_focus);
+
+  if (suspended == app_state->is_suspended) {
+    return;
+  }
+
+  app_state->is_suspended = suspended;
+  if (suspended) {
+    VINFO("Application suspended.");
+    return;
+  }
+
+  VINFO("Application resumed.");
+
+  // Time spent suspended is not simulated and must not count as a frame.
+  f64 now = platform_get_absolute_time();
+  app_state->last_frame_time = now;
+  app_state->update_accumulator = 0.0;
+  app_state->pacing.next_deadline = now + app_state->pacing.target_frame_time;
+}
+
+static b8 application_update_task(void *params, f64 delta_time) {
+  return application_update(delta_time, &app_state->alpha);
+}
+
+static b8 application_render_task(void *params, f64 delta_time) {
+  return app_state->game_instance->render(app_state->game_instance, delta_time,
+                                          app_state->alpha);
+}
+
+static b8 application_input_task(void *params, f64 delta_time) {
+  if (app_state->update_count) {
+    input_update(delta_time);
+  }
+  return TRUE;
+}
+
+/**
+ * Registers the engine's per-frame tasks. Game tasks are registered after
+ * these, in game initialize, and are ordered against them by resource.
+ */
+static b8 application_register_tasks() {
+  task_desc update = {
+      .name = "game_update",
+      .run = application_update_task,
+      .reads = {TASK_RESOURCE_INPUT},
+      .writes = {TASK_RESOURCE_GAME_STATE},
+  };
+
+  task_desc render = {
+      .name = "game_render",
+      .run = application_render_task,
+      .reads = {TASK_RESOURCE_INPUT, TASK_RESOURCE_GAME_STATE},
+      .writes = {TASK_RESOURCE_RENDER},
+  };
+
+  // NOTE: Input update/state copying should always be handled after any
+  // input has been read. As the only writer of input, this runs after every
+  // task that reads it.
+  task_desc input = {
+      .name = "input_update",
+      .run = application_input_task,
+      .writes = {TASK_RESOURCE_INPUT},
+  };
+
+  // Pipelined rendering runs outside the graph, on the render thread, and
+  // may read input while the graph runs. Input is then updated by
+  // application_run between frames instead.
+  if (app_state->is_pipelined) {
+    return task_graph_add(&update);
+  }
+  return task_graph_add(&update) && task_graph_add(&render) &&
+         task_graph_add(&input);
+}
+
+static u32 render_thread(void *params) {
+  render_pipeline *pipeline = &app_state->pipeline;
+
+  while (TRUE) {
+    platform_semaphore_wait(&pipeline->start, PLATFORM_WAIT_INFINITE);
+    if (pipeline->quit) {
+      break;
+    }
+
+    pipeline->result = pipeline->render_game.render(
+        &pipeline->render_game, pipeline->delta_time, pipeline->alpha);
+    platform_semaphore_signal(&pipeline->done);
+  }
+
+  return 0;
+}
+
+static b8 render_pipeline_start() {
+  render_pipeline *pipeline = &app_state->pipeline;
+  game *game_instance = app_state->game_instance;
+
+  pipeline->render_game = *game_instance;
+  pipeline->render_game.state =
+      vallocate(game_instance->state_size, MEMORY_TAG_GAME);
+  pipeline->in_flight = FALSE;
+  pipeline->quit = FALSE;
+
+  if (platform_semaphore_create(0, &pipeline->start)) {
+    if (platform_semaphore_create(0, &pipeline->done)) {
+      if (platform_thread_create("vivid-render", render_thread, NULL,
+                                 &pipeline->thread)) {
+        return TRUE;
+      }
+      platform_semaphore_destroy(&pipeline->done);
+    }
+    platform_semaphore_destroy(&pipeline->start);
+  }
+
+  vfree(pipeline->render_game.state, game_instance->state_size,
+        MEMORY_TAG_GAME);
+  pipeline->render_game.state = NULL;
+  return FALSE;
+}
+
+/**
+ * Sync point: waits for the render in flight, if any, to finish.
+ *
+ * @return FALSE if that render failed.
+ */
+static b8 render_pipeline_sync() {
+  render_pipeline *pipeline = &app_state->pipeline;
+  if (!pipeline->in_flight) {
+    return TRUE;
+  }
+
+  platform_semaphore_wait(&pipeline->done, PLATFORM_WAIT_INFINITE);
+  pipeline->in_flight = FALSE;
+  return pipeline->result;
+}
+
+// Hands the latest updated state to the render thread. Must follow a sync.
+static void render_pipeline_submit(f64 delta_time) {
+  render_pipeline *pipeline = &app_state->pipeline;
+  game *game_instance = app_state->game_instance;
+
+  vcopy_memory(pipeline->render_game.state, game_instance->state,
+               game_instance->state_size);
+  pipeline->delta_time = delta_time;
+  pipeline->alpha = app_state->alpha;
+  pipeline->in_flight = TRUE;
+  platform_semaphore_signal(&pipeline->start);
+}
+
+// Points the render copy of the game at reloaded game code.
+static void render_pipeline_rebind() {
+  render_pipeline *pipeline = &app_state->pipeline;
+  void *render_state = pipeline->render_game.state;
+
+  pipeline->render_game = *app_state->game_instance;
+  pipeline->render_game.state = render_state;
+}
+
+static void render_pipeline_stop() {
+  render_pipeline *pipeline = &app_state->pipeline;
+
+  render_pipeline_sync();
+  pipeline->quit = TRUE;
+  platform_semaphore_signal(&pipeline->start);
+  platform_thread_join(&pipeline->thread);
+
+  platform_semaphore_destroy(&pipeline->start);
+  platform_semaphore_destroy(&pipeline->done);
+  vfree(pipeline->render_game.state, app_state->game_instance->state_size,
+        MEMORY_TAG_GAME);
+  pipeline->render_game.state = NULL;
+}
+
 b8 application_run() {
   char *memory_usage = get_memory_usage_string();
 
-  VINFO(memory_usage);
+  VINFO("%s", memory_usage);
 
   vfree(memory_usage, strlen(memory_usage) + 1, MEMORY_TAG_STRING);
 
-  while (app_state.is_running) {
-    if (!platform_pump_messages(&app_state.platform)) {
-      app_state.is_running = FALSE;
+  frame_pacing_init(&app_state->pacing,
+                    app_state->game_instance->app_config.target_frame_rate);
+  app_state->last_frame_time = platform_get_absolute_time();
+
+  // Set when a pipelined frame ran its tasks but not yet input_update.
+  b8 is_input_update_pending = FALSE;
+  f64 input_delta_time = 0.0;
+
+  while (app_state->is_running) {
+    // Wait for the previous frame's render before handling any messages, so
+    // event handlers never run concurrently with it.
+    if (app_state->is_pipelined && !render_pipeline_sync()) {
+      VFATAL("Game render failed. Exiting.");
+      app_state->is_running = FALSE;
       break;
     }
 
-    if (!app_state.is_suspended) {
-      if (!app_state.game_instance->update(app_state.game_instance, 0.0f)) {
-        VFATAL("Game update failed. Exiting.");
-        app_state.is_running = FALSE;
-        break;
+    // No game code runs on any thread here, so it can be swapped.
+    if (game_module_update(app_state->game_instance) &&
+        app_state->is_pipelined) {
+      render_pipeline_rebind();
+    }
+
+    // With pipelined rendering, the previous frame's input_update runs here:
+    // its update and render are done and this frame's messages are not yet
+    // in, so nothing reads input concurrently.
+    if (is_input_update_pending) {
+      input_update(input_delta_time);
+      is_input_update_pending = FALSE;
+    }
+
+    if (!platform_pump_messages(&app_state->platform)) {
+      app_state->is_running = FALSE;
+      break;
+    }
+
+    // Completions run on the main thread, before this frame's tasks.
+    async_io_update();
+
+    f64 now = platform_get_absolute_time();
+    f64 delta_time = now - app_state->last_frame_time;
+    app_state->last_frame_time = now;
+
+    if (!app_state->is_suspended) {
+      // Applies a requested rewind before anything reads the state.
+      snapshot_frame(app_state->frame_number++);
+
+      // Render what the previous frame's update produced while this frame
+      // updates.
+      if (app_state->is_pipelined) {
+        render_pipeline_submit(delta_time);
       }
 
-      if (!app_state.game_instance->render(app_state.game_instance, 0.0f)) {
-        VFATAL("Game render failed. Exiting.");
-        app_state.is_running = FALSE;
+      // Runs update, render and input_update (unless pipelined) and any
+      // game tasks.
+      if (!task_graph_execute(delta_time)) {
+        VFATAL("Frame task failed. Exiting.");
+        app_state->is_running = FALSE;
         break;
       }
 
-      // NOTE: Input update/state copying should always be handleled
-      // after any input should be recorded; I.E. before this line.
-      // As a safety, input is the last thing to be updated before
-      // the next frame.
-      input_update(0.0f);
+      if (app_state->is_pipelined && app_state->update_count) {
+        is_input_update_pending = TRUE;
+        input_delta_time = delta_time;
+      }
+
+      frame_pacing_wait(&app_state->pacing);
+    } else {
+      // Nothing is drawn while suspended, so block on the window system
+      // instead of spinning through empty frames.
+      platform_wait_messages(&app_state->platform, SUSPENDED_TICK_MS);
     }
   }
 
-  app_state.is_running = FALSE;
+  app_state->is_running = FALSE;
 
-  event_unregister(EVENT_CODE_APPLICATION_QUIT, NULL, application_on_event);
-  event_unregister(EVENT_CODE_KEY_PRESSED, NULL, application_on_key);
-  event_unregister(EVENT_CODE_KEY_RELEASED, NULL, application_on_key);
-
-  input_shutdown();
-  VINFO("Input system shutdown.");
-
-  events_shutdown();
-  VINFO("Event system shutdown.");
+  if (app_state->is_pipelined) {
+    render_pipeline_stop();
+  }
 
-  logger_shutdown();
-  VINFO("Logger shutdown.");
+  frame_pacing_report(&app_state->pacing, platform_get_absolute_time());
 
-  platform_shutdown(&app_state.platform);
-  VINFO("Platform shutdown.");
+  engine_shutdown();
 
   return TRUE;
 }
@@ -156,7 +1009,7 @@ b8 application_on_event(u16 code, void *sender, void *listener_instance,
   switch (code) {
   case EVENT_CODE_APPLICATION_QUIT:
     VINFO("Application quit event received. Shutting down.");
-    app_state.is_running = FALSE;
+    app_state->is_running = FALSE;
     return TRUE;
   }
 
@@ -193,3 +1046,31 @@ b8 application_on_key(u16 code, void *sender, void *listener_instance,
 
   return FALSE;
 }
+
+b8 application_on_window(u16 code, void *sender, void *listener_instance,
+                         event_context context) {
+  if (code == EVENT_CODE_WINDOW_RESIZED) {
+    u16 width = context.data.u16[0];
+    u16 height = context.data.u16[1];
+
+    if (width != app_state->width || height != app_state->height) {
+      app_state->width = width;
+      app_state->height = height;
+      VDEBUG("Window resized: %i, %i", width, height);
+
+      // A zero-sized window is minimized; the game sees its next real size.
+      if (width != 0 && height != 0) {
+        app_state->game_instance->on_resize(app_state->game_instance, width,
+                                            height);
+      }
+      application_update_suspended();
+    }
+  } else if (code == EVENT_CODE_WINDOW_VISIBILITY_CHANGED) {
+    app_state->is_visible = context.data.u8[0];
+    app_state->has_focus = context.data.u8[1];
+    application_update_suspended();
+  }
+
+  // Other listeners may want window events too.
+  return FALSE;
+}
@@ -16,8 +16,44 @@ typedef struct application_config {
   u32 height;
   // The application name used in windowing. If applicable.
   char *name;
+  // Run without a window, e.g. for servers, benchmarks and CI. Can also be
+  // enabled by setting the VIVID_HEADLESS environment variable to 1.
+  b8 headless;
+  // Frames per second the main loop is paced to. 0 runs uncapped.
+  u32 target_frame_rate;
+  // Rate, in updates per second, of the fixed timestep simulation. 0 calls
+  // update once per frame with the real frame time instead.
+  u32 fixed_update_rate;
+  // Maximum fixed updates run in one frame before the remaining backlog is
+  // dropped, so a slow frame cannot snowball. 0 uses a default of 5.
+  u32 max_updates_per_frame;
+  // Also suspend, not just when minimized or hidden, while the window does
+  // not have input focus.
+  b8 suspend_when_unfocused;
+  // Number of job system workers, including the main thread. 0 uses one per
+  // physical core.
+  u32 job_worker_count;
+  // Render frame N on a render thread while frame N+1 updates, trading one
+  // frame of latency for throughput. Render then sees a copy of the game
+  // state taken after each update, so the state must be self-contained (no
+  // pointers into data update changes) and game state_size must be set.
+  b8 pipelined_rendering;
+  // Frames of engine and game state kept for snapshot_request_rewind. Each
+  // costs a copy of the game state and input state per frame. 0 disables
+  // snapshots.
+  u32 snapshot_frame_count;
 } application_config;
 
+/**
+ * Starts the engine: allocates the block holding the state of every
+ * subsystem, brings the subsystems up and initializes the game.
+ *
+ * Subsystems reach their part of the block through a pointer of their own
+ * module, so only one engine instance runs per process at a time. Another
+ * can be started once application_run has returned.
+ *
+ * @return FALSE if startup failed or an instance is already running.
+ */
 VAPI b8 application_init(struct game *game_instance);
 
 VAPI b8 application_run();
@@ -0,0 +1,292 @@
+#include <core/async_io.h>
+
+#include <core/logger.h>
+#include <core/vmemory.h>
+
+// Marks the end of the free list.
+#define INVALID_READ_INDEX 0xFFFFFFFFu
+
+typedef struct async_read {
+  platform_file file;
+  u64 offset;
+  u8 *buffer;
+  u64 size;
+  // Bytes read so far. Short reads are continued until the end of the file.
+  u64 bytes_read;
+  b8 failed;
+  pfn_async_read_complete on_complete;
+  void *user_data;
+  // Next free read, while on the free list.
+  u32 next_free;
+} async_read;
+
+typedef struct async_io_state {
+  // Guards everything below.
+  platform_mutex mutex;
+  async_read reads[ASYNC_IO_MAX_READS];
+  u32 free_head;
+  u32 in_flight;
+
+  b8 is_kernel_backed;
+  platform_io_queue queue;
+
+  // Fallback: reads waiting for an I/O thread, as a ring of read indices,
+  // and reads the threads have finished.
+  u32 pending[ASYNC_IO_MAX_READS];
+  u32 pending_head;
+  u32 pending_count;
+  u32 finished[ASYNC_IO_MAX_READS];
+  u32 finished_count;
+  platform_condition pending_available;
+  platform_thread threads[ASYNC_IO_FALLBACK_THREAD_COUNT];
+  u32 thread_count;
+  b8 threads_running;
+
+  // Copies of finished reads whose callbacks are being run. Main thread only.
+  async_read completed[ASYNC_IO_MAX_READS];
+} async_io_state;
+
+static b8 is_initialized = FALSE;
+static async_io_state *state;
+
+static u32 io_thread(void *params) {
+  platform_mutex_lock(&state->mutex);
+  for (;;) {
+    while (state->threads_running && state->pending_count == 0) {
+      platform_condition_wait(&state->pending_available, &state->mutex,
+                              PLATFORM_WAIT_INFINITE);
+    }
+    if (state->pending_count == 0) {
+      break;
+    }
+
+    u32 index = state->pending[state->pending_head];
+    state->pending_head = (state->pending_head + 1) % ASYNC_IO_MAX_READS;
+    state->pending_count--;
+    async_read *read = &state->reads[index];
+
+    // The read's fields are not touched by anyone else while it is pending.
+    platform_mutex_unlock(&state->mutex);
+    i64 result =
+        platform_file_read(&read->file, read->offset, read->buffer, read->size);
+    platform_mutex_lock(&state->mutex);
+
+    read->failed = result < 0;
+    read->bytes_read = result > 0 ? (u64)result : 0;
+    state->finished[state->finished_count++] = index;
+  }
+  platform_mutex_unlock(&state->mutex);
+
+  return 0;
+}
+
+b8 async_io_init(u64 *memory_requirement, void *memory) {
+  *memory_requirement = sizeof(async_io_state);
+  if (!memory) {
+    return TRUE;
+  }
+
+  if (is_initialized) {
+    return FALSE;
+  }
+
+  state = memory;
+  vzero_memory(state, sizeof(async_io_state));
+
+  for (u32 i = 0; i < ASYNC_IO_MAX_READS; ++i) {
+    state->reads[i].next_free = i + 1 < ASYNC_IO_MAX_READS ? i + 1
+                                                           : INVALID_READ_INDEX;
+  }
+  state->free_head = 0;
+
+  if (!platform_mutex_create(&state->mutex)) {
+    return FALSE;
+  }
+
+  state->is_kernel_backed =
+      platform_io_queue_create(ASYNC_IO_MAX_READS, &state->queue);
+  if (!state->is_kernel_backed) {
+    if (!platform_condition_create(&state->pending_available)) {
+      platform_mutex_destroy(&state->mutex);
+      return FALSE;
+    }
+
+    state->threads_running = TRUE;
+    for (u32 i = 0; i < ASYNC_IO_FALLBACK_THREAD_COUNT; ++i) {
+      if (!platform_thread_create("vivid-io", io_thread, NULL,
+                                  &state->threads[i])) {
+        break;
+      }
+      state->thread_count++;
+    }
+
+    if (state->thread_count == 0) {
+      VERROR("Failed to start any I/O thread.");
+      platform_condition_destroy(&state->pending_available);
+      platform_mutex_destroy(&state->mutex);
+      return FALSE;
+    }
+  }
+
+  VINFO("Asynchronous I/O uses %s.",
+        state->is_kernel_backed ? "the kernel queue" : "I/O threads");
+
+  is_initialized = TRUE;
+  return TRUE;
+}
+
+void async_io_shutdown() {
+  if (!is_initialized) {
+    return;
+  }
+
+  // Buffers of reads in flight may still be written to.
+  while (state->in_flight) {
+    async_io_update();
+    if (state->in_flight) {
+      platform_sleep(1);
+    }
+  }
+
+  if (state->is_kernel_backed) {
+    platform_io_queue_destroy(&state->queue);
+  } else {
+    platform_mutex_lock(&state->mutex);
+    state->threads_running = FALSE;
+    platform_condition_broadcast(&state->pending_available);
+    platform_mutex_unlock(&state->mutex);
+
+    for (u32 i = 0; i < state->thread_count; ++i) {
+      platform_thread_join(&state->threads[i]);
+    }
+    platform_condition_destroy(&state->pending_available);
+  }
+
+  platform_mutex_destroy(&state->mutex);
+  state = NULL;
+  is_initialized = FALSE;
+}
+
+// Queues the unread rest of a read. Expects the mutex to be held.
+static b8 submit(u32 index) {
+  async_read *read = &state->reads[index];
+
+  if (state->is_kernel_backed) {
+    return platform_io_queue_read(&state->queue, &read->file,
+                                  read->offset + read->bytes_read,
+                                  read->buffer + read->bytes_read,
+                                  read->size - read->bytes_read, index);
+  }
+
+  u32 tail = (state->pending_head + state->pending_count) % ASYNC_IO_MAX_READS;
+  state->pending[tail] = index;
+  state->pending_count++;
+  platform_condition_signal(&state->pending_available);
+  return TRUE;
+}
+
+b8 async_io_read(platform_file *file, u64 offset, void *buffer, u64 size,
+                 pfn_async_read_complete on_complete, void *user_data) {
+  if (!is_initialized) {
+    return FALSE;
+  }
+
+  platform_mutex_lock(&state->mutex);
+  u32 index = state->free_head;
+  if (index == INVALID_READ_INDEX) {
+    platform_mutex_unlock(&state->mutex);
+    VWARN("Too many asynchronous reads in flight.");
+    return FALSE;
+  }
+
+  async_read *read = &state->reads[index];
+  state->free_head = read->next_free;
+  *read = (async_read){
+      .file = *file,
+      .offset = offset,
+      .buffer = buffer,
+      .size = size,
+      .on_complete = on_complete,
+      .user_data = user_data,
+  };
+
+  b8 submitted = submit(index);
+  if (submitted) {
+    state->in_flight++;
+  } else {
+    read->next_free = state->free_head;
+    state->free_head = index;
+  }
+  platform_mutex_unlock(&state->mutex);
+
+  return submitted;
+}
+
+/**
+ * Collects kernel completions into the finished list, continuing short reads.
+ * Expects the mutex to be held.
+ */
+static void collect_kernel_completions() {
+  platform_io_completion completions[64];
+  u32 count;
+  while ((count = platform_io_queue_poll(&state->queue, completions, 64))) {
+    for (u32 i = 0; i < count; ++i) {
+      u32 index = (u32)completions[i].user_data;
+      async_read *read = &state->reads[index];
+
+      if (completions[i].result < 0) {
+        read->failed = TRUE;
+      } else {
+        read->bytes_read += (u64)completions[i].result;
+        // A short read that is not at the end of the file carries on. If
+        // the rest cannot be queued, the read fails rather than pass for
+        // one that reached the end of the file.
+        if (completions[i].result > 0 && read->bytes_read < read->size) {
+          if (submit(index)) {
+            continue;
+          }
+          VWARN("Could not queue the rest of a short read.");
+          read->failed = TRUE;
+        }
+      }
+
+      state->finished[state->finished_count++] = index;
+    }
+  }
+}
+
+void async_io_update() {
+  if (!is_initialized) {
+    return;
+  }
+
+  u32 completed_count = 0;
+
+  platform_mutex_lock(&state->mutex);
+  if (state->is_kernel_backed) {
+    collect_kernel_completions();
+  }
+
+  // Copy the reads out and free them, so callbacks can start new ones.
+  for (u32 i = 0; i < state->finished_count; ++i) {
+    u32 index = state->finished[i];
+    state->completed[completed_count++] = state->reads[index];
+    state->reads[index].next_free = state->free_head;
+    state->free_head = index;
+  }
+  state->in_flight -= state->finished_count;
+  state->finished_count = 0;
+  platform_mutex_unlock(&state->mutex);
+
+  for (u32 i = 0; i < completed_count; ++i) {
+    async_read *read = &state->completed[i];
+    if (read->on_complete) {
+      read->on_complete(read->user_data, read->buffer, read->bytes_read,
+                        !read->failed);
+    }
+  }
+}
+
+b8 async_io_is_kernel_backed() {
+  return is_initialized && state->is_kernel_backed;
+}
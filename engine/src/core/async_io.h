@@ -0,0 +1,63 @@
+#pragma once
+
+#include <defines.h>
+#include <platform/platform.h>
+
+/**
+ * Asynchronous file reads. Reads go to the kernel through a platform I/O
+ * queue (io_uring on Linux) where available, and otherwise to a few I/O
+ * threads that block on the disk in place of the caller. Either way, finished
+ * reads are collected in a queue and their callbacks run on the main thread
+ * from async_io_update, once per frame, so callbacks may touch game state.
+ */
+
+// Reads that can be in flight at once.
+#define ASYNC_IO_MAX_READS 256
+
+// Threads servicing reads when the platform has no asynchronous I/O.
+#define ASYNC_IO_FALLBACK_THREAD_COUNT 2
+
+/**
+ * Called on the main thread once a read finished.
+ *
+ * @param user_data As passed to async_io_read.
+ * @param buffer The buffer that was read into.
+ * @param bytes_read Bytes read, less than requested at the end of the file.
+ * @param succeeded FALSE if the read failed.
+ */
+typedef void (*pfn_async_read_complete)(void *user_data, void *buffer,
+                                        u64 bytes_read, b8 succeeded);
+
+/**
+ * Initializes asynchronous I/O in two passes, like events_init.
+ *
+ * @param memory_requirement Receives the size of the state in bytes.
+ * @param state Memory for the state, which must stay valid until after
+ * async_io_shutdown. NULL to only query the size.
+ * @return TRUE on success or after a size query, FALSE otherwise.
+ */
+b8 async_io_init(u64 *memory_requirement, void *state);
+
+// Waits for reads in flight and runs their callbacks, then shuts down.
+void async_io_shutdown();
+
+// Runs the callbacks of the reads that finished since the last call.
+void async_io_update();
+
+/**
+ * Starts reading part of a file without blocking. Can be called from any
+ * thread.
+ *
+ * @param file The file to read. Must stay open until the read completes.
+ * @param offset Where to start reading.
+ * @param buffer Receives the data. Must stay valid until the read completes.
+ * @param size The number of bytes to read.
+ * @param on_complete Called on the main thread once the read finished.
+ * @param user_data Passed to on_complete.
+ * @return TRUE if the read was started, FALSE if too many are in flight.
+ */
+VAPI b8 async_io_read(platform_file *file, u64 offset, void *buffer, u64 size,
+                      pfn_async_read_complete on_complete, void *user_data);
+
+// Whether reads go to the kernel rather than to I/O threads.
+VAPI b8 async_io_is_kernel_backed();
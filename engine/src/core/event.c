@@ -24,15 +24,21 @@ typedef struct event_system_state {
  * Event system internal state.
  */
 static b8 is_initialized = FALSE;
-static event_system_state state;
+static event_system_state *state;
+
+b8 events_init(u64 *memory_requirement, void *memory) {
+  *memory_requirement = sizeof(event_system_state);
+  if (!memory) {
+    return TRUE;
+  }
 
-b8 events_init() {
   if (is_initialized) {
-    VWARN("Event system already initialized.");
+    VWARN_CAT(LOG_CATEGORY_EVENTS, "Event system already initialized.");
     return FALSE;
   }
 
-  vzero_memory(&state, sizeof(event_system_state));
+  state = memory;
+  vzero_memory(state, sizeof(event_system_state));
 
   is_initialized = TRUE;
 
@@ -41,35 +47,36 @@ b8 events_init() {
 
 void events_shutdown() {
   if (!is_initialized) {
-    VWARN("Event system not initialized.");
+    VWARN_CAT(LOG_CATEGORY_EVENTS, "Event system not initialized.");
     return;
   }
 
   for (u16 i = 0; i < MAX_MESSAGE_CODES; ++i) {
-    if (state.registered[i].events) {
-      darray_destroy(state.registered[i].events);
-      state.registered[i].events = NULL;
+    if (state->registered[i].events) {
+      darray_destroy(state->registered[i].events);
+      state->registered[i].events = NULL;
     }
   }
 
+  state = NULL;
   is_initialized = FALSE;
 }
 
 b8 event_register(u16 code, void *listener_instance, PFN_on_event on_event) {
   if (!is_initialized) {
-    VERROR("Event system not initialized.");
+    VERROR_CAT(LOG_CATEGORY_EVENTS, "Event system not initialized.");
     return FALSE;
   }
 
-  if (state.registered[code].events == NULL) {
-    state.registered[code].events = darray_create(registered_event);
+  if (state->registered[code].events == NULL) {
+    state->registered[code].events = darray_create(registered_event);
   }
 
-  u64 registered_length = darray_length(state.registered[code].events);
+  u64 registered_length = darray_length(state->registered[code].events);
   for (u64 i = 0; i < registered_length; ++i) {
-    if (state.registered[code].events[i].listener == listener_instance &&
-        state.registered[code].events[i].callback == on_event) {
-      VWARN("Event listener already registered.");
+    if (state->registered[code].events[i].listener == listener_instance &&
+        state->registered[code].events[i].callback == on_event) {
+      VWARN_CAT(LOG_CATEGORY_EVENTS, "Event listener already registered.");
       return FALSE;
     }
   }
@@ -79,50 +86,50 @@ b8 event_register(u16 code, void *listener_instance, PFN_on_event on_event) {
       .callback = on_event,
   };
 
-  darray_push(state.registered[code].events, event);
+  darray_push(state->registered[code].events, event);
 
   return TRUE;
 }
 
 b8 event_unregister(u16 code, void *listener_instance, PFN_on_event on_event) {
   if (!is_initialized) {
-    VERROR("Event system not initialized.");
+    VERROR_CAT(LOG_CATEGORY_EVENTS, "Event system not initialized.");
     return FALSE;
   }
 
-  if (state.registered[code].events == NULL) {
-    VWARN("No events registered for code %d.", code);
+  if (state->registered[code].events == NULL) {
+    VWARN_CAT(LOG_CATEGORY_EVENTS, "No events registered for code %d.", code);
     return FALSE;
   }
 
-  u64 registered_length = darray_length(state.registered[code].events);
+  u64 registered_length = darray_length(state->registered[code].events);
   for (u64 i = 0; i < registered_length; ++i) {
-    if (state.registered[code].events[i].listener == listener_instance &&
-        state.registered[code].events[i].callback == on_event) {
+    if (state->registered[code].events[i].listener == listener_instance &&
+        state->registered[code].events[i].callback == on_event) {
       registered_event event;
-      darray_remove(state.registered[code].events, i, &event);
+      darray_remove(state->registered[code].events, i, &event);
       return TRUE;
     }
   }
 
-  VWARN("Event listener not found.");
+  VWARN_CAT(LOG_CATEGORY_EVENTS, "Event listener not found.");
   return FALSE;
 }
 
 b8 event_fire(u16 code, void *sender, event_context context) {
   if (!is_initialized) {
-    VERROR("Event system not initialized.");
+    VERROR_CAT(LOG_CATEGORY_EVENTS, "Event system not initialized.");
     return FALSE;
   }
 
-  if (state.registered[code].events == NULL) {
+  if (state->registered[code].events == NULL) {
     return FALSE;
   }
 
-  u64 registered_length = darray_length(state.registered[code].events);
+  u64 registered_length = darray_length(state->registered[code].events);
   for (u64 i = 0; i < registered_length; ++i) {
-    if (state.registered[code].events[i].callback(
-            code, sender, state.registered[code].events[i].listener, context)) {
+    registered_event *event = &state->registered[code].events[i];
+    if (event->callback(code, sender, event->listener, context)) {
       // Event was handled. do not call any more listeners.
       return TRUE;
     }
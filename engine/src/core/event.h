@@ -29,7 +29,16 @@ typedef struct event_context {
 typedef b8 (*PFN_on_event)(u16 code, void *sender, void *listener_instance,
                            event_context context);
 
-b8 events_init();
+/**
+ * Initializes the event system in two passes: call once with state NULL to
+ * get the memory it needs, then again with that much memory.
+ *
+ * @param memory_requirement Receives the size of the state in bytes.
+ * @param state Memory for the state, which must stay valid until after
+ * events_shutdown. NULL to only query the size.
+ * @return TRUE on success or after a size query, FALSE otherwise.
+ */
+b8 events_init(u64 *memory_requirement, void *state);
 void events_shutdown();
 
 /**
@@ -118,5 +127,12 @@ typedef enum system_event_code {
    */
   EVENT_CODE_WINDOW_RESIZED = 0x08,
 
+  // Window was shown, hidden, obscured or gained/lost focus.
+  /* Context usage:
+   * b8 is_visible = context.data.u8[0];
+   * b8 has_focus = context.data.u8[1];
+   */
+  EVENT_CODE_WINDOW_VISIBILITY_CHANGED = 0x09,
+
   MAX_SYSTEM_EVENT_CODE = 0xFF
 } system_event_code;
@@ -0,0 +1,140 @@
+#include <core/file_reader.h>
+
+#include <core/logger.h>
+#include <core/vmemory.h>
+
+b8 file_reader_open(const char *path, u64 buffer_size,
+                    file_reader *out_reader) {
+  vzero_memory(out_reader, sizeof(file_reader));
+
+  if (!platform_file_open_read(path, &out_reader->file)) {
+    return FALSE;
+  }
+
+  if (!platform_file_get_size(&out_reader->file, &out_reader->file_size)) {
+    VERROR("Failed to get the size of '%s'.", path);
+    platform_file_close(&out_reader->file);
+    return FALSE;
+  }
+
+  out_reader->buffer_capacity =
+      buffer_size ? buffer_size : FILE_READER_DEFAULT_BUFFER_SIZE;
+  out_reader->buffer =
+      vallocate(out_reader->buffer_capacity, MEMORY_TAG_FILE);
+  return TRUE;
+}
+
+void file_reader_close(file_reader *reader) {
+  if (reader->buffer) {
+    vfree(reader->buffer, reader->buffer_capacity, MEMORY_TAG_FILE);
+  }
+
+  platform_file_close(&reader->file);
+  vzero_memory(reader, sizeof(file_reader));
+}
+
+// Refills the buffer from the current position. Returns FALSE at the end.
+static b8 fill_buffer(file_reader *reader) {
+  u64 offset = file_reader_tell(reader);
+  i64 read = platform_file_read(&reader->file, offset, reader->buffer,
+                                reader->buffer_capacity);
+
+  reader->buffer_offset = offset;
+  reader->cursor = 0;
+  reader->buffer_length = read > 0 ? (u64)read : 0;
+  return reader->buffer_length > 0;
+}
+
+u64 file_reader_read(file_reader *reader, void *out_data, u64 size) {
+  u8 *destination = out_data;
+  u64 total = 0;
+
+  // Whatever is left in the buffer first.
+  u64 buffered = reader->buffer_length - reader->cursor;
+  if (buffered) {
+    u64 count = size < buffered ? size : buffered;
+    vcopy_memory(destination, reader->buffer + reader->cursor, count);
+    reader->cursor += count;
+    total += count;
+  }
+
+  // Copying a large read through the buffer would only add a copy.
+  if (size - total >= reader->buffer_capacity) {
+    u64 offset = file_reader_tell(reader);
+    i64 read = platform_file_read(&reader->file, offset, destination + total,
+                                  size - total);
+    if (read > 0) {
+      total += (u64)read;
+    }
+    reader->buffer_offset = offset + (read > 0 ? (u64)read : 0);
+    reader->buffer_length = 0;
+    reader->cursor = 0;
+    return total;
+  }
+
+  while (total < size && fill_buffer(reader)) {
+    u64 count = size - total;
+    if (count > reader->buffer_length) {
+      count = reader->buffer_length;
+    }
+    vcopy_memory(destination + total, reader->buffer, count);
+    reader->cursor = count;
+    total += count;
+  }
+
+  return total;
+}
+
+b8 file_reader_read_line(file_reader *reader, char *out_line, u64 max_length,
+                         u64 *out_length) {
+  if (max_length == 0) {
+    return FALSE;
+  }
+
+  u64 length = 0;
+  b8 found_any = FALSE;
+  while (length < max_length - 1) {
+    if (reader->cursor == reader->buffer_length && !fill_buffer(reader)) {
+      break;
+    }
+
+    found_any = TRUE;
+    char c = (char)reader->buffer[reader->cursor++];
+    if (c == '\n') {
+      break;
+    }
+    out_line[length++] = c;
+  }
+
+  // Drop the carriage return of Windows line endings.
+  if (length > 0 && out_line[length - 1] == '\r') {
+    length--;
+  }
+
+  out_line[length] = '\0';
+  if (out_length) {
+    *out_length = length;
+  }
+  return found_any;
+}
+
+void file_reader_seek(file_reader *reader, u64 offset) {
+  // Stay within the buffer when possible.
+  if (offset >= reader->buffer_offset &&
+      offset < reader->buffer_offset + reader->buffer_length) {
+    reader->cursor = offset - reader->buffer_offset;
+    return;
+  }
+
+  reader->buffer_offset = offset;
+  reader->buffer_length = 0;
+  reader->cursor = 0;
+}
+
+u64 file_reader_tell(file_reader *reader) {
+  return reader->buffer_offset + reader->cursor;
+}
+
+b8 file_reader_at_end(file_reader *reader) {
+  return file_reader_tell(reader) >= reader->file_size;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <defines.h>
+#include <platform/platform.h>
+
+// Buffer size used when file_reader_open is given 0.
+#define FILE_READER_DEFAULT_BUFFER_SIZE (64 * 1024)
+
+/**
+ * Reads a file front to back through a buffer, so many small reads cost few
+ * system calls. Reads larger than the buffer go straight to the caller's
+ * memory. For random access to a whole file, prefer platform_file_map_read.
+ */
+typedef struct file_reader {
+  platform_file file;
+  u64 file_size;
+  u8 *buffer;
+  u64 buffer_capacity;
+  // File offset of buffer[0].
+  u64 buffer_offset;
+  // Valid bytes in the buffer.
+  u64 buffer_length;
+  // Read position within the buffer.
+  u64 cursor;
+} file_reader;
+
+/**
+ * Opens a file for buffered reading.
+ *
+ * @param path The path of the file.
+ * @param buffer_size Size of the read buffer in bytes. 0 uses
+ * FILE_READER_DEFAULT_BUFFER_SIZE.
+ * @param out_reader Receives the reader.
+ * @return TRUE if the file was opened, FALSE otherwise.
+ */
+VAPI b8 file_reader_open(const char *path, u64 buffer_size,
+                         file_reader *out_reader);
+
+VAPI void file_reader_close(file_reader *reader);
+
+/**
+ * Reads up to size bytes at the current position and advances past them.
+ *
+ * @return The number of bytes read, less than size at the end of the file
+ * or on failure.
+ */
+VAPI u64 file_reader_read(file_reader *reader, void *out_data, u64 size);
+
+/**
+ * Reads up to and including the next newline, which is not stored. Lines
+ * longer than max_length - 1 are split.
+ *
+ * @param out_line Receives the line, null terminated.
+ * @param max_length Size of out_line in bytes.
+ * @param out_length Receives the length of the line. Can be NULL.
+ * @return FALSE at the end of the file, TRUE otherwise.
+ */
+VAPI b8 file_reader_read_line(file_reader *reader, char *out_line,
+                              u64 max_length, u64 *out_length);
+
+// Moves the read position to the given file offset.
+VAPI void file_reader_seek(file_reader *reader, u64 offset);
+
+// Current read position as a file offset.
+VAPI u64 file_reader_tell(file_reader *reader);
+
+VAPI b8 file_reader_at_end(file_reader *reader);
@@ -0,0 +1,177 @@
+#include <core/game_module.h>
+
+#include <core/logger.h>
+#include <platform/platform.h>
+
+#include <stdio.h>
+
+#define GAME_MODULE_MAX_PATH 512
+
+typedef struct loaded_module {
+  platform_dynamic_library library;
+  pfn_game_module_bind bind;
+  // The copy that was loaded, removed again once it is unloaded.
+  char live_path[GAME_MODULE_MAX_PATH];
+} loaded_module;
+
+typedef struct game_module_state {
+  char path[GAME_MODULE_MAX_PATH];
+  // The application name, usually a literal in the module's own memory.
+  char name[256];
+  loaded_module current;
+  // Modification time of the library the current code was loaded from.
+  u64 loaded_time;
+  // A newer modification time waiting for the build to finish writing.
+  u64 pending_time;
+  f64 next_check;
+  // Numbers the live copies, so each load sees a path it has not seen.
+  u32 load_count;
+  u32 reload_count;
+} game_module_state;
+
+static b8 is_initialized = FALSE;
+static game_module_state state;
+
+/**
+ * Copies the library and loads the copy. Loading the library in place would
+ * lock it on Windows, and dlopen may hand back the already loaded image for
+ * a path it has seen before.
+ */
+static b8 module_open(loaded_module *out_module) {
+  snprintf(out_module->live_path, sizeof(out_module->live_path), "%s.live.%u",
+           state.path, state.load_count++);
+
+  if (!platform_file_copy(state.path, out_module->live_path)) {
+    VERROR("Failed to copy game module '%s'.", state.path);
+    return FALSE;
+  }
+
+  if (!platform_dynamic_library_load(out_module->live_path,
+                                     &out_module->library)) {
+    platform_file_remove(out_module->live_path);
+    return FALSE;
+  }
+
+  void *bind = platform_dynamic_library_load_function(&out_module->library,
+                                                     GAME_MODULE_BIND_NAME);
+  out_module->bind = (pfn_game_module_bind)bind;
+  if (!out_module->bind) {
+    VERROR("Game module '%s' does not export %s.", state.path,
+           GAME_MODULE_BIND_NAME);
+    platform_dynamic_library_unload(&out_module->library);
+    platform_file_remove(out_module->live_path);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static void module_close(loaded_module *module) {
+  platform_dynamic_library_unload(&module->library);
+  platform_file_remove(module->live_path);
+  module->bind = NULL;
+}
+
+b8 game_module_load(const char *path, game *game_instance) {
+  if (is_initialized) {
+    return FALSE;
+  }
+
+  if (snprintf(state.path, sizeof(state.path), "%s", path) >=
+      (i32)sizeof(state.path)) {
+    VERROR("Game module path '%s' is too long.", path);
+    return FALSE;
+  }
+
+  if (!platform_file_get_modified_time(state.path, &state.loaded_time)) {
+    VERROR("Game module '%s' not found.", path);
+    return FALSE;
+  }
+
+  if (!module_open(&state.current)) {
+    return FALSE;
+  }
+
+  if (!state.current.bind(game_instance, FALSE)) {
+    VERROR("Game module '%s' failed to bind.", path);
+    module_close(&state.current);
+    return FALSE;
+  }
+
+  if (game_instance->app_config.name) {
+    snprintf(state.name, sizeof(state.name), "%s",
+             game_instance->app_config.name);
+    game_instance->app_config.name = state.name;
+  }
+
+  state.pending_time = state.loaded_time;
+  state.next_check = platform_get_absolute_time() + GAME_MODULE_CHECK_INTERVAL;
+
+  VINFO("Game module '%s' loaded.", path);
+  is_initialized = TRUE;
+  return TRUE;
+}
+
+b8 game_module_update(game *game_instance) {
+  if (!is_initialized) {
+    return FALSE;
+  }
+
+  f64 now = platform_get_absolute_time();
+  if (now < state.next_check) {
+    return FALSE;
+  }
+  state.next_check = now + GAME_MODULE_CHECK_INTERVAL;
+
+  u64 modified_time;
+  if (!platform_file_get_modified_time(state.path, &modified_time) ||
+      modified_time == state.loaded_time) {
+    return FALSE;
+  }
+
+  // The linker may still be writing. Wait until the time holds still for a
+  // whole check interval.
+  if (modified_time != state.pending_time) {
+    state.pending_time = modified_time;
+    return FALSE;
+  }
+
+  // Whatever happens, do not try this build again.
+  state.loaded_time = modified_time;
+
+  loaded_module next;
+  if (!module_open(&next)) {
+    VWARN("Rebuilt game module could not be loaded. Keeping the old code.");
+    return FALSE;
+  }
+
+  // Bind onto a copy, so a failed bind leaves the running game untouched.
+  game rebound = *game_instance;
+  if (!next.bind(&rebound, TRUE)) {
+    VWARN("Rebuilt game module failed to bind. Keeping the old code.");
+    module_close(&next);
+    return FALSE;
+  }
+
+  // The state and config carry over; only the code changes.
+  rebound.app_config = game_instance->app_config;
+  rebound.state = game_instance->state;
+  rebound.state_size = game_instance->state_size;
+  *game_instance = rebound;
+
+  module_close(&state.current);
+  state.current = next;
+  state.reload_count++;
+
+  VINFO("Game module reloaded (%u).", state.reload_count);
+  return TRUE;
+}
+
+void game_module_unload() {
+  if (!is_initialized) {
+    return;
+  }
+
+  module_close(&state.current);
+  is_initialized = FALSE;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <defines.h>
+#include <game_types.h>
+
+/**
+ * Hot reloading of game code. The game is built as its own shared library
+ * that exports game_module_bind, which fills in the game's function
+ * pointers. The engine loads a copy of the library, so the original can be
+ * rebuilt while the game runs, and checks it for changes between frames.
+ * After a rebuild the new code is bound to the same game instance and keeps
+ * running on the existing state.
+ *
+ * Only function pointers held in the game struct are updated. Anything else
+ * the game registered that points into its code, such as tasks, event
+ * listeners or async_io callbacks, must be registered again when bind is
+ * called with is_reload set, and pointers the state keeps into the module's
+ * constant data, such as string literals, must be refreshed. The layout of
+ * the state must stay compatible across a reload; changing it needs a
+ * restart.
+ */
+
+#ifdef _MSC_VER
+#define GAME_MODULE_EXPORT __declspec(dllexport)
+#else
+#define GAME_MODULE_EXPORT __attribute__((visibility("default")))
+#endif
+
+// Name of the function every game module exports.
+#define GAME_MODULE_BIND_NAME "game_module_bind"
+
+// How often, in seconds, the library is checked for a rebuild.
+#define GAME_MODULE_CHECK_INTERVAL 0.25
+
+/**
+ * Exported by the game module as game_module_bind.
+ *
+ * @param game_instance The game to set the function pointers of. On the
+ * first bind the game also sets its config and creates its state.
+ * @param is_reload TRUE when binding new code to a running game, whose state
+ * must be kept.
+ * @return TRUE on success. Failing a reload keeps the previous code.
+ */
+typedef b8 (*pfn_game_module_bind)(game *game_instance, b8 is_reload);
+
+/**
+ * Loads the game module and binds it to the game for the first time. Meant
+ * to be called from create_game.
+ *
+ * @param path Path of the game's shared library.
+ * @param game_instance The game to bind.
+ * @return TRUE if the module was loaded and bound, FALSE otherwise.
+ */
+VAPI b8 game_module_load(const char *path, game *game_instance);
+
+/**
+ * Reloads the module if it was rebuilt. Must be called between frames, when
+ * no game code is running on any thread.
+ *
+ * @param game_instance The game the module is bound to.
+ * @return TRUE if new code was bound, FALSE otherwise.
+ */
+b8 game_module_update(game *game_instance);
+
+// Unloads the module. Game code must not be called afterwards.
+VAPI void game_module_unload();
@@ -3,6 +3,7 @@
 #include <core/event.h>
 #include <core/logger.h>
 #include <core/vmemory.h>
+#include <platform/platform.h>
 
 typedef struct keyboard_state {
   b8 keys[KEY_MAX_KEYS];
@@ -23,49 +24,78 @@ typedef struct input_state {
 
 // Internal state of the input system.
 static b8 is_initialized = FALSE;
-static input_state state;
+static input_state *state;
+
+// Set on the thread running the second and later fixed updates of a frame.
+// See input_hide_edges.
+static VTHREAD_LOCAL b8 are_edges_hidden = FALSE;
+
+// The state the input_was_* queries compare against on this thread.
+static const keyboard_state *keyboard_previous() {
+  return are_edges_hidden ? &state->keyboard_current
+                          : &state->keyboard_previous;
+}
+
+static const mouse_state *mouse_previous() {
+  return are_edges_hidden ? &state->mouse_current : &state->mouse_previous;
+}
+
+void input_init(u64 *memory_requirement, void *memory) {
+  *memory_requirement = sizeof(input_state);
+  if (!memory) {
+    return;
+  }
 
-void input_init() {
   if (is_initialized) {
-    VWARN("Input system already initialized.");
+    VWARN_CAT(LOG_CATEGORY_INPUT, "Input system already initialized.");
     return;
   }
-  vzero_memory(&state, sizeof(input_state));
+
+  state = memory;
+  vzero_memory(state, sizeof(input_state));
 
   is_initialized = TRUE;
 }
 
 void input_shutdown() {
   if (!is_initialized) {
-    VWARN("Input system already shutdown.");
+    VWARN_CAT(LOG_CATEGORY_INPUT, "Input system already shutdown.");
     return;
   }
 
   // TODO: Add shutdown routines when needed.
 
+  state = NULL;
   is_initialized = FALSE;
 }
 
 void input_update(f64 delta_time) {
   if (!is_initialized) {
-    VWARN("Input system not initialized.");
+    VWARN_CAT(LOG_CATEGORY_INPUT, "Input system not initialized.");
     return;
   }
 
   // Update previous state.
-  vcopy_memory(&state.keyboard_previous, &state.keyboard_current,
+  vcopy_memory(&state->keyboard_previous, &state->keyboard_current,
                sizeof(keyboard_state));
-  vcopy_memory(&state.mouse_previous, &state.mouse_current,
+  vcopy_memory(&state->mouse_previous, &state->mouse_current,
                sizeof(mouse_state));
 }
 
+void input_hide_edges(b8 hide) { are_edges_hidden = hide; }
+
 void input_process_key(keys key, b8 is_down) {
+  // Input arriving before init or after shutdown has nowhere to go.
+  if (!is_initialized) {
+    return;
+  }
+
   // only handle this if the key state has changed
-  if (state.keyboard_current.keys[key] == is_down) {
+  if (state->keyboard_current.keys[key] == is_down) {
     return;
   }
 
-  state.keyboard_current.keys[key] = is_down;
+  state->keyboard_current.keys[key] = is_down;
 
   // fire the event
   event_context context;
@@ -75,12 +105,16 @@ void input_process_key(keys key, b8 is_down) {
 }
 
 void input_process_button(buttons button, b8 is_down) {
+  if (!is_initialized) {
+    return;
+  }
+
   // only handle this if the button state has changed
-  if (state.mouse_current.buttons[button] == is_down) {
+  if (state->mouse_current.buttons[button] == is_down) {
     return;
   }
 
-  state.mouse_current.buttons[button] = is_down;
+  state->mouse_current.buttons[button] = is_down;
 
   // fire the event
   event_context context;
@@ -90,15 +124,21 @@ void input_process_button(buttons button, b8 is_down) {
 }
 
 void input_process_mouse_move(i32 x, i32 y) {
+  if (!is_initialized) {
+    return;
+  }
+
   // only handle this if the mouse position has changed
-  if (state.mouse_current.x == x && state.mouse_current.y == y) {
+  if (state->mouse_current.x == x && state->mouse_current.y == y) {
     return;
   }
 
-  VDEBUG("Mouse pos: %i, %i!", x, y);
+  // Mouse motion arrives at hundreds of events per second.
+  VLOG_RATE_LIMITED(LOG_CATEGORY_INPUT, LOG_LEVEL_DEBUG, 10,
+                    "Mouse pos: %i, %i!", x, y);
 
-  state.mouse_current.x = x;
-  state.mouse_current.y = y;
+  state->mouse_current.x = x;
+  state->mouse_current.y = y;
 
   // fire the event
   event_context context;
@@ -118,92 +158,92 @@ void input_process_mouse_wheel(i8 z_delta) {
 
 b8 input_is_key_down(keys key) {
   if (!is_initialized) {
-    VWARN("Input system not initialized.");
+    VWARN_CAT(LOG_CATEGORY_INPUT, "Input system not initialized.");
     return FALSE;
   }
 
-  return state.keyboard_current.keys[key];
+  return state->keyboard_current.keys[key];
 }
 
 b8 input_is_key_up(keys key) {
   if (!is_initialized) {
-    VWARN("Input system not initialized.");
+    VWARN_CAT(LOG_CATEGORY_INPUT, "Input system not initialized.");
     return FALSE;
   }
 
-  return !state.keyboard_current.keys[key];
+  return !state->keyboard_current.keys[key];
 }
 
 b8 input_was_key_down(keys key) {
   if (!is_initialized) {
-    VWARN("Input system not initialized.");
+    VWARN_CAT(LOG_CATEGORY_INPUT, "Input system not initialized.");
     return FALSE;
   }
 
-  return state.keyboard_previous.keys[key];
+  return keyboard_previous()->keys[key];
 }
 
 b8 input_was_key_up(keys key) {
   if (!is_initialized) {
-    VWARN("Input system not initialized.");
+    VWARN_CAT(LOG_CATEGORY_INPUT, "Input system not initialized.");
     return FALSE;
   }
 
-  return !state.keyboard_previous.keys[key];
+  return !keyboard_previous()->keys[key];
 }
 
 b8 input_is_button_down(buttons button) {
   if (!is_initialized) {
-    VWARN("Input system not initialized.");
+    VWARN_CAT(LOG_CATEGORY_INPUT, "Input system not initialized.");
     return FALSE;
   }
 
-  return state.mouse_current.buttons[button];
+  return state->mouse_current.buttons[button];
 }
 
 b8 input_is_button_up(buttons button) {
   if (!is_initialized) {
-    VWARN("Input system not initialized.");
+    VWARN_CAT(LOG_CATEGORY_INPUT, "Input system not initialized.");
     return FALSE;
   }
 
-  return !state.mouse_current.buttons[button];
+  return !state->mouse_current.buttons[button];
 }
 
 b8 input_was_button_down(buttons button) {
   if (!is_initialized) {
-    VWARN("Input system not initialized.");
+    VWARN_CAT(LOG_CATEGORY_INPUT, "Input system not initialized.");
     return FALSE;
   }
 
-  return state.mouse_previous.buttons[button];
+  return mouse_previous()->buttons[button];
 }
 
 b8 input_was_button_up(buttons button) {
   if (!is_initialized) {
-    VWARN("Input system not initialized.");
+    VWARN_CAT(LOG_CATEGORY_INPUT, "Input system not initialized.");
     return FALSE;
   }
 
-  return !state.mouse_previous.buttons[button];
+  return !mouse_previous()->buttons[button];
 }
 
 void input_get_mouse_position(i32 *x, i32 *y) {
   if (!is_initialized) {
-    VWARN("Input system not initialized.");
+    VWARN_CAT(LOG_CATEGORY_INPUT, "Input system not initialized.");
     return;
   }
 
-  *x = state.mouse_current.x;
-  *y = state.mouse_current.y;
+  *x = state->mouse_current.x;
+  *y = state->mouse_current.y;
 }
 
 void input_get_previous_mouse_position(i32 *x, i32 *y) {
   if (!is_initialized) {
-    VWARN("Input system not initialized.");
+    VWARN_CAT(LOG_CATEGORY_INPUT, "Input system not initialized.");
     return;
   }
 
-  *x = state.mouse_previous.x;
-  *y = state.mouse_previous.y;
+  *x = mouse_previous()->x;
+  *y = mouse_previous()->y;
 }
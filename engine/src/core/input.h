@@ -155,10 +155,25 @@ typedef enum keys {
 
 } keys;
 
-void input_init();
+/**
+ * Initializes the input system in two passes, like events_init.
+ *
+ * @param memory_requirement Receives the size of the state in bytes.
+ * @param state Memory for the state, which must stay valid until after
+ * input_shutdown. NULL to only query the size.
+ */
+void input_init(u64 *memory_requirement, void *state);
 void input_shutdown();
 void input_update(f64 delta_time);
 
+/**
+ * While hide is TRUE, the input_was_* queries and the previous mouse position
+ * on the calling thread report the current state, so no press, release or
+ * motion is seen. The application sets this between the fixed updates of one
+ * frame, so only the first of them sees the frame's input edges.
+ */
+void input_hide_edges(b8 hide);
+
 // keyboard input
 VAPI b8 input_is_key_down(keys key);
 VAPI b8 input_is_key_up(keys key);
@@ -0,0 +1,539 @@
+#include <core/job.h>
+
+#include <core/logger.h>
+#include <memory/linear_allocator.h>
+#include <platform/platform.h>
+
+// Jobs each worker deque can hold per priority. Must be a power of two.
+#define JOB_DEQUE_CAPACITY 4096
+
+// Jobs the injection queue can hold per priority.
+#define JOB_INJECTION_CAPACITY 1024
+
+// Upper bound on workers, including the main thread.
+#define JOB_MAX_WORKERS 64
+
+// Times an idle worker looks for work before going to sleep.
+#define JOB_IDLE_SPIN_COUNT 256
+
+// Upper bound on the batches job_parallel_for splits its range into.
+#define JOB_PARALLEL_FOR_MAX_BATCHES 256
+
+STATIC_ASSERT((JOB_DEQUE_CAPACITY & (JOB_DEQUE_CAPACITY - 1)) == 0,
+              job_deque_capacity_power_of_two);
+
+/**
+ * A queued job. Thieves may read a slot while its owner overwrites it, so the
+ * fields are atomics; a torn read is always discarded because the thief's
+ * claim on the slot then fails.
+ */
+typedef struct job_slot {
+  atomic_ptr entry;
+  atomic_ptr params;
+  atomic_ptr counter;
+} job_slot;
+
+typedef struct job {
+  pfn_job_entry entry;
+  void *params;
+  job_counter *counter;
+} job;
+
+/**
+ * Chase-Lev work-stealing deque, in the C11 formulation by Lê et al. Only the
+ * owning worker pushes and pops at the bottom; any thread may steal from the
+ * top.
+ */
+typedef struct job_deque {
+  _Alignas(VCACHE_LINE_SIZE) atomic_i64 top;
+  _Alignas(VCACHE_LINE_SIZE) atomic_i64 bottom;
+  job_slot *slots;
+} job_deque;
+
+typedef struct job_worker {
+  job_deque deques[JOB_PRIORITY_MAX_COUNT];
+  platform_thread thread;
+  // State of the xorshift generator used to pick steal victims.
+  u32 random_state;
+} job_worker;
+
+// Queue for jobs submitted from threads that are not workers.
+typedef struct job_injection_queue {
+  platform_mutex mutex;
+  // Lets workers skip the lock when the queue is empty.
+  atomic_u32 count;
+  u32 head[JOB_PRIORITY_MAX_COUNT];
+  u32 length[JOB_PRIORITY_MAX_COUNT];
+  job jobs[JOB_PRIORITY_MAX_COUNT][JOB_INJECTION_CAPACITY];
+} job_injection_queue;
+
+typedef struct job_system_state {
+  u32 worker_count;
+  job_worker *workers;
+  job_injection_queue *injection;
+  atomic_b8 is_running;
+  // Workers sleep on the semaphore once they run out of work.
+  _Alignas(VCACHE_LINE_SIZE) atomic_u32 sleeping_count;
+  platform_semaphore wake;
+} job_system_state;
+
+static b8 is_initialized = FALSE;
+static job_system_state *state;
+
+static VTHREAD_LOCAL i32 current_worker_index = -1;
+
+static void deque_write(job_slot *slot, const job *value) {
+  vatomic_store_ptr(&slot->entry, (void *)value->entry, VMEMORY_ORDER_RELAXED);
+  vatomic_store_ptr(&slot->params, value->params, VMEMORY_ORDER_RELAXED);
+  vatomic_store_ptr(&slot->counter, value->counter, VMEMORY_ORDER_RELAXED);
+}
+
+static void deque_read(job_slot *slot, job *out_value) {
+  out_value->entry =
+      (pfn_job_entry)vatomic_load_ptr(&slot->entry, VMEMORY_ORDER_RELAXED);
+  out_value->params = vatomic_load_ptr(&slot->params, VMEMORY_ORDER_RELAXED);
+  out_value->counter = vatomic_load_ptr(&slot->counter, VMEMORY_ORDER_RELAXED);
+}
+
+// Owner only. Returns FALSE if the deque is full.
+static b8 deque_push(job_deque *deque, const job *value) {
+  i64 bottom = vatomic_load_i64(&deque->bottom, VMEMORY_ORDER_RELAXED);
+  i64 top = vatomic_load_i64(&deque->top, VMEMORY_ORDER_ACQUIRE);
+  if (bottom - top >= JOB_DEQUE_CAPACITY) {
+    return FALSE;
+  }
+
+  deque_write(&deque->slots[bottom & (JOB_DEQUE_CAPACITY - 1)], value);
+  // Publishes the slot to thieves, who load bottom with acquire.
+  vatomic_store_i64(&deque->bottom, bottom + 1, VMEMORY_ORDER_RELEASE);
+  return TRUE;
+}
+
+// Owner only. Takes the most recently pushed job.
+static b8 deque_pop(job_deque *deque, job *out_value) {
+  i64 bottom = vatomic_load_i64(&deque->bottom, VMEMORY_ORDER_RELAXED) - 1;
+  vatomic_store_i64(&deque->bottom, bottom, VMEMORY_ORDER_RELAXED);
+  vatomic_thread_fence(VMEMORY_ORDER_SEQ_CST);
+  i64 top = vatomic_load_i64(&deque->top, VMEMORY_ORDER_RELAXED);
+
+  if (top > bottom) {
+    // Empty.
+    vatomic_store_i64(&deque->bottom, bottom + 1, VMEMORY_ORDER_RELAXED);
+    return FALSE;
+  }
+
+  deque_read(&deque->slots[bottom & (JOB_DEQUE_CAPACITY - 1)], out_value);
+  if (top != bottom) {
+    return TRUE;
+  }
+
+  // Last job left: race the thieves for it.
+  b8 won = vatomic_compare_exchange_i64(&deque->top, &top, top + 1,
+                                        VMEMORY_ORDER_SEQ_CST,
+                                        VMEMORY_ORDER_RELAXED);
+  vatomic_store_i64(&deque->bottom, bottom + 1, VMEMORY_ORDER_RELAXED);
+  return won;
+}
+
+// Any thread. Takes the oldest job. Fails if empty or if another thread won.
+static b8 deque_steal(job_deque *deque, job *out_value) {
+  i64 top = vatomic_load_i64(&deque->top, VMEMORY_ORDER_ACQUIRE);
+  vatomic_thread_fence(VMEMORY_ORDER_SEQ_CST);
+  i64 bottom = vatomic_load_i64(&deque->bottom, VMEMORY_ORDER_ACQUIRE);
+
+  if (top >= bottom) {
+    return FALSE;
+  }
+
+  deque_read(&deque->slots[top & (JOB_DEQUE_CAPACITY - 1)], out_value);
+  return vatomic_compare_exchange_i64(&deque->top, &top, top + 1,
+                                      VMEMORY_ORDER_SEQ_CST,
+                                      VMEMORY_ORDER_RELAXED);
+}
+
+static b8 deque_is_empty(job_deque *deque) {
+  i64 top = vatomic_load_i64(&deque->top, VMEMORY_ORDER_ACQUIRE);
+  i64 bottom = vatomic_load_i64(&deque->bottom, VMEMORY_ORDER_ACQUIRE);
+  return top >= bottom;
+}
+
+static b8 injection_push(job_priority priority, const job *value) {
+  job_injection_queue *queue = state->injection;
+  b8 pushed = FALSE;
+
+  platform_mutex_lock(&queue->mutex);
+  if (queue->length[priority] < JOB_INJECTION_CAPACITY) {
+    u32 index = (queue->head[priority] + queue->length[priority]) %
+                JOB_INJECTION_CAPACITY;
+    queue->jobs[priority][index] = *value;
+    queue->length[priority]++;
+    vatomic_fetch_add_u32(&queue->count, 1, VMEMORY_ORDER_RELEASE);
+    pushed = TRUE;
+  }
+  platform_mutex_unlock(&queue->mutex);
+
+  return pushed;
+}
+
+static b8 injection_pop(job_priority priority, job *out_value) {
+  job_injection_queue *queue = state->injection;
+  if (vatomic_load_u32(&queue->count, VMEMORY_ORDER_ACQUIRE) == 0) {
+    return FALSE;
+  }
+
+  b8 popped = FALSE;
+
+  platform_mutex_lock(&queue->mutex);
+  if (queue->length[priority] > 0) {
+    *out_value = queue->jobs[priority][queue->head[priority]];
+    queue->head[priority] =
+        (queue->head[priority] + 1) % JOB_INJECTION_CAPACITY;
+    queue->length[priority]--;
+    vatomic_fetch_sub_u32(&queue->count, 1, VMEMORY_ORDER_RELAXED);
+    popped = TRUE;
+  }
+  platform_mutex_unlock(&queue->mutex);
+
+  return popped;
+}
+
+static u32 next_random(u32 *random_state) {
+  u32 x = *random_state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *random_state = x;
+  return x;
+}
+
+/**
+ * Finds the next job for the calling thread. Higher priorities are looked for
+ * everywhere before lower ones: first the worker's own deque, then the
+ * injection queue, then the other workers starting from a random victim.
+ */
+static b8 find_job(job *out_job) {
+  i32 self = current_worker_index;
+  u32 start = 0;
+  if (self >= 0) {
+    start = next_random(&state->workers[self].random_state);
+  }
+
+  for (u32 priority = 0; priority < JOB_PRIORITY_MAX_COUNT; ++priority) {
+    if (self >= 0 &&
+        deque_pop(&state->workers[self].deques[priority], out_job)) {
+      return TRUE;
+    }
+
+    if (injection_pop(priority, out_job)) {
+      return TRUE;
+    }
+
+    for (u32 i = 0; i < state->worker_count; ++i) {
+      u32 victim = (start + i) % state->worker_count;
+      if ((i32)victim == self) {
+        continue;
+      }
+
+      if (deque_steal(&state->workers[victim].deques[priority], out_job)) {
+        return TRUE;
+      }
+    }
+  }
+
+  return FALSE;
+}
+
+static void run_job(const job *value) {
+  value->entry(value->params);
+
+  if (value->counter) {
+    vatomic_fetch_sub_u32(&value->counter->pending, 1, VMEMORY_ORDER_RELEASE);
+  }
+}
+
+static b8 has_queued_jobs() {
+  if (vatomic_load_u32(&state->injection->count, VMEMORY_ORDER_ACQUIRE)) {
+    return TRUE;
+  }
+
+  for (u32 i = 0; i < state->worker_count; ++i) {
+    for (u32 priority = 0; priority < JOB_PRIORITY_MAX_COUNT; ++priority) {
+      if (!deque_is_empty(&state->workers[i].deques[priority])) {
+        return TRUE;
+      }
+    }
+  }
+
+  return FALSE;
+}
+
+// Wakes up to count sleeping workers.
+static void wake_workers(u32 count) {
+  // Pairs with the fence in worker_thread so that either the worker sees the
+  // new job or this sees the worker asleep.
+  vatomic_thread_fence(VMEMORY_ORDER_SEQ_CST);
+  u32 sleeping =
+      vatomic_load_u32(&state->sleeping_count, VMEMORY_ORDER_RELAXED);
+  if (count > sleeping) {
+    count = sleeping;
+  }
+
+  for (u32 i = 0; i < count; ++i) {
+    platform_semaphore_signal(&state->wake);
+  }
+}
+
+static u32 worker_thread(void *params) {
+  current_worker_index = (i32)(u64)params;
+
+  u32 idle_count = 0;
+  while (vatomic_load_b8(&state->is_running, VMEMORY_ORDER_ACQUIRE)) {
+    job next;
+    if (find_job(&next)) {
+      run_job(&next);
+      idle_count = 0;
+      continue;
+    }
+
+    if (++idle_count < JOB_IDLE_SPIN_COUNT) {
+      vatomic_pause();
+      continue;
+    }
+
+    vatomic_fetch_add_u32(&state->sleeping_count, 1, VMEMORY_ORDER_RELAXED);
+    vatomic_thread_fence(VMEMORY_ORDER_SEQ_CST);
+    // A job may have been submitted before this worker counted as asleep.
+    if (!has_queued_jobs() &&
+        vatomic_load_b8(&state->is_running, VMEMORY_ORDER_ACQUIRE)) {
+      platform_semaphore_wait(&state->wake, PLATFORM_WAIT_INFINITE);
+    }
+    vatomic_fetch_sub_u32(&state->sleeping_count, 1, VMEMORY_ORDER_RELAXED);
+    idle_count = 0;
+  }
+
+  return 0;
+}
+
+// Size of each part of the job system's memory, in the order it is laid out.
+static void memory_layout(u32 worker_count, u64 *out_sizes) {
+  out_sizes[0] = VALIGN_UP(sizeof(job_system_state), VCACHE_LINE_SIZE);
+  out_sizes[1] = VALIGN_UP(sizeof(job_worker) * worker_count, VCACHE_LINE_SIZE);
+  out_sizes[2] = VALIGN_UP(sizeof(job_injection_queue), VCACHE_LINE_SIZE);
+  out_sizes[3] = VALIGN_UP(sizeof(job_slot) * JOB_DEQUE_CAPACITY,
+                           VCACHE_LINE_SIZE) *
+                 worker_count * JOB_PRIORITY_MAX_COUNT;
+}
+
+b8 job_system_init(u64 *memory_requirement, void *memory, u32 worker_count) {
+  if (worker_count == 0) {
+    worker_count = platform_get_physical_core_count();
+  }
+  if (worker_count == 0) {
+    worker_count = 1;
+  }
+  if (worker_count > JOB_MAX_WORKERS) {
+    worker_count = JOB_MAX_WORKERS;
+  }
+
+  u64 sizes[4];
+  memory_layout(worker_count, sizes);
+  *memory_requirement = sizes[0] + sizes[1] + sizes[2] + sizes[3];
+  if (!memory) {
+    return TRUE;
+  }
+
+  if (is_initialized) {
+    return FALSE;
+  }
+
+  linear_allocator allocator;
+  linear_allocator_create(*memory_requirement, memory, &allocator);
+  state = linear_allocator_allocate(&allocator, sizes[0], VCACHE_LINE_SIZE);
+  state->worker_count = worker_count;
+  state->workers =
+      linear_allocator_allocate(&allocator, sizes[1], VCACHE_LINE_SIZE);
+  state->injection =
+      linear_allocator_allocate(&allocator, sizes[2], VCACHE_LINE_SIZE);
+
+  if (!platform_mutex_create(&state->injection->mutex) ||
+      !platform_semaphore_create(0, &state->wake)) {
+    VERROR("Failed to create job system synchronization objects.");
+    return FALSE;
+  }
+
+  for (u32 i = 0; i < worker_count; ++i) {
+    job_worker *worker = &state->workers[i];
+    // xorshift needs a non-zero seed.
+    worker->random_state = 0x9E3779B9u * (i + 1);
+    for (u32 priority = 0; priority < JOB_PRIORITY_MAX_COUNT; ++priority) {
+      worker->deques[priority].slots = linear_allocator_allocate(
+          &allocator, sizeof(job_slot) * JOB_DEQUE_CAPACITY, VCACHE_LINE_SIZE);
+    }
+  }
+
+  vatomic_store_b8(&state->is_running, TRUE, VMEMORY_ORDER_RELEASE);
+
+  // The calling thread is worker 0 and only runs jobs while waiting.
+  current_worker_index = 0;
+  platform_thread_current(&state->workers[0].thread);
+
+  for (u32 i = 1; i < worker_count; ++i) {
+    if (!platform_thread_create("vivid-worker", worker_thread, (void *)(u64)i,
+                                &state->workers[i].thread)) {
+      VERROR("Failed to start job worker %u.", i);
+      // Run with the workers that did start.
+      state->worker_count = i;
+      break;
+    }
+  }
+
+  VINFO("Job system started with %u workers.", state->worker_count);
+
+  is_initialized = TRUE;
+  return TRUE;
+}
+
+void job_system_shutdown() {
+  if (!is_initialized) {
+    return;
+  }
+
+  vatomic_store_b8(&state->is_running, FALSE, VMEMORY_ORDER_RELEASE);
+  for (u32 i = 1; i < state->worker_count; ++i) {
+    platform_semaphore_signal(&state->wake);
+  }
+  for (u32 i = 1; i < state->worker_count; ++i) {
+    platform_thread_join(&state->workers[i].thread);
+  }
+
+  platform_semaphore_destroy(&state->wake);
+  platform_mutex_destroy(&state->injection->mutex);
+
+  current_worker_index = -1;
+  state = NULL;
+  is_initialized = FALSE;
+}
+
+// Queues a job without waking anyone. Returns FALSE if it had to run inline.
+static b8 enqueue(const job_desc *desc, job_counter *counter) {
+  job value = {desc->entry, desc->params, counter};
+  if (counter) {
+    vatomic_fetch_add_u32(&counter->pending, 1, VMEMORY_ORDER_RELAXED);
+  }
+
+  if (!is_initialized) {
+    run_job(&value);
+    return FALSE;
+  }
+
+  i32 self = current_worker_index;
+  b8 queued =
+      self >= 0
+          ? deque_push(&state->workers[self].deques[desc->priority], &value)
+          : injection_push(desc->priority, &value);
+  if (!queued) {
+    // Full. Running it now also throttles the producer.
+    run_job(&value);
+  }
+
+  return queued;
+}
+
+void job_submit(const job_desc *desc, job_counter *counter) {
+  if (enqueue(desc, counter)) {
+    wake_workers(1);
+  }
+}
+
+void job_submit_batch(const job_desc *jobs, u32 count, job_counter *counter) {
+  u32 queued = 0;
+  for (u32 i = 0; i < count; ++i) {
+    queued += enqueue(&jobs[i], counter);
+  }
+
+  if (queued) {
+    wake_workers(queued);
+  }
+}
+
+b8 job_try_run() {
+  job next;
+  if (!is_initialized || !find_job(&next)) {
+    return FALSE;
+  }
+
+  run_job(&next);
+  return TRUE;
+}
+
+void job_wait(job_counter *counter) {
+  u32 idle_count = 0;
+  while (vatomic_load_u32(&counter->pending, VMEMORY_ORDER_ACQUIRE) != 0) {
+    if (job_try_run()) {
+      idle_count = 0;
+    } else if (++idle_count < JOB_IDLE_SPIN_COUNT) {
+      vatomic_pause();
+    } else {
+      // The remaining jobs are running elsewhere.
+      platform_thread_yield();
+    }
+  }
+}
+
+typedef struct job_range {
+  pfn_job_range entry;
+  void *params;
+  u32 start;
+  u32 end;
+} job_range;
+
+static void run_job_range(void *params) {
+  job_range *range = (job_range *)params;
+  range->entry(range->params, range->start, range->end);
+}
+
+void job_parallel_for(u32 count, u32 min_batch_size, pfn_job_range entry,
+                      void *params) {
+  if (count == 0) {
+    return;
+  }
+
+  // Aim for a few batches per worker so stealing can even out the load.
+  u32 batch_count = is_initialized ? state->worker_count * 4 : 1;
+  if (batch_count > JOB_PARALLEL_FOR_MAX_BATCHES) {
+    batch_count = JOB_PARALLEL_FOR_MAX_BATCHES;
+  }
+
+  u32 batch_size = (count + batch_count - 1) / batch_count;
+  if (batch_size < min_batch_size) {
+    batch_size = min_batch_size;
+  }
+  if (batch_size == 0) {
+    batch_size = 1;
+  }
+  batch_count = (count + batch_size - 1) / batch_size;
+
+  if (batch_count == 1) {
+    entry(params, 0, count);
+    return;
+  }
+
+  // The ranges live on this stack frame, which outlives the jobs because
+  // this waits for them below.
+  job_range ranges[JOB_PARALLEL_FOR_MAX_BATCHES];
+  job_desc jobs[JOB_PARALLEL_FOR_MAX_BATCHES];
+  for (u32 i = 0; i < batch_count; ++i) {
+    u32 start = i * batch_size;
+    u32 end = start + batch_size < count ? start + batch_size : count;
+    ranges[i] = (job_range){entry, params, start, end};
+    jobs[i] = (job_desc){run_job_range, &ranges[i], JOB_PRIORITY_HIGH};
+  }
+
+  job_counter counter = {0};
+  job_submit_batch(jobs, batch_count, &counter);
+  job_wait(&counter);
+}
+
+u32 job_worker_count() { return is_initialized ? state->worker_count : 1; }
+
+i32 job_worker_index() { return current_worker_index; }
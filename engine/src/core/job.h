@@ -0,0 +1,103 @@
+#pragma once
+
+#include <defines.h>
+#include <platform/atomic.h>
+
+/**
+ * Work-stealing job system. Runs one worker per physical core, with the main
+ * thread acting as worker 0. Each worker owns a Chase-Lev deque per priority:
+ * it pushes and pops its own jobs at the bottom without locking while idle
+ * workers steal from the top. Jobs submitted from threads that are not
+ * workers go through a shared injection queue.
+ *
+ * Jobs are fire-and-forget. To wait for a group of jobs, submit them with the
+ * same job_counter and call job_wait on it; the waiting thread runs other jobs
+ * in the meantime instead of blocking.
+ */
+
+typedef enum job_priority {
+  JOB_PRIORITY_HIGH,
+  JOB_PRIORITY_NORMAL,
+  JOB_PRIORITY_LOW,
+
+  JOB_PRIORITY_MAX_COUNT
+} job_priority;
+
+typedef void (*pfn_job_entry)(void *params);
+
+// Processes the items [start, end) of a job_parallel_for.
+typedef void (*pfn_job_range)(void *params, u32 start, u32 end);
+
+/**
+ * Counts the unfinished jobs submitted with it, for fork-join waits. Zero
+ * initialize before use, e.g. job_counter counter = {0};
+ */
+typedef struct job_counter {
+  atomic_u32 pending;
+} job_counter;
+
+typedef struct job_desc {
+  pfn_job_entry entry;
+  // Passed to entry. Must stay valid until the job has run.
+  void *params;
+  job_priority priority;
+} job_desc;
+
+/**
+ * Starts the worker threads. Called in two passes like events_init, with the
+ * same worker_count both times.
+ *
+ * @param memory_requirement Receives the size of the state in bytes, which
+ * includes every worker's deques.
+ * @param state Cache line aligned memory for the state, which must stay valid
+ * until after job_system_shutdown. NULL to only query the size.
+ * @param worker_count Total number of workers including the calling thread,
+ * which becomes worker 0. 0 uses one worker per physical core.
+ * @return TRUE on success or after a size query, FALSE otherwise.
+ */
+VAPI b8 job_system_init(u64 *memory_requirement, void *state,
+                        u32 worker_count);
+
+// Stops and joins the worker threads. Jobs still queued are not run.
+VAPI void job_system_shutdown();
+
+/**
+ * Queues a job. If the queue is full the job runs immediately on the calling
+ * thread instead.
+ *
+ * @param desc The job to run.
+ * @param counter Incremented now and decremented once the job has run. Can
+ * be NULL.
+ */
+VAPI void job_submit(const job_desc *desc, job_counter *counter);
+
+// Queues several jobs, waking only as many sleeping workers as needed.
+VAPI void job_submit_batch(const job_desc *jobs, u32 count,
+                           job_counter *counter);
+
+/**
+ * Runs one queued job on the calling thread, if there is one. Lets threads
+ * that wait on something other than a job_counter help out meanwhile.
+ *
+ * @return TRUE if a job was run, FALSE if none was found.
+ */
+VAPI b8 job_try_run();
+
+/**
+ * Waits until every job submitted with the counter has run, running queued
+ * jobs on the calling thread while waiting.
+ */
+VAPI void job_wait(job_counter *counter);
+
+/**
+ * Splits [0, count) into batches of at least min_batch_size items, runs them
+ * across all workers at high priority and waits for them to finish.
+ */
+VAPI void job_parallel_for(u32 count, u32 min_batch_size, pfn_job_range entry,
+                           void *params);
+
+// Total number of workers, including the main thread.
+VAPI u32 job_worker_count();
+
+// Index of the calling worker, or -1 if the calling thread is not a worker.
+VAPI i32 job_worker_index();
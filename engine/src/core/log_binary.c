@@ -0,0 +1,244 @@
+#include <core/log_binary.h>
+
+#include <core/logger.h>
+#include <platform/platform.h>
+
+#include <stdio.h>
+#include <string.h>
+
+// Size of each thread's record buffer.
+#define LOG_BINARY_BUFFER_SIZE (64 * 1024)
+
+// Maximum number of threads that can write binary log records.
+#define LOG_BINARY_MAX_THREADS 64
+
+STATIC_ASSERT(LOG_BINARY_BUFFER_SIZE > 2 * LOG_BINARY_MAX_RECORD_SIZE,
+              log_binary_buffer_fits_records);
+
+typedef struct log_binary_buffer {
+  u32 thread_index;
+  // Number of bytes of records in data.
+  u64 length;
+  u8 data[LOG_BINARY_BUFFER_SIZE];
+} log_binary_buffer;
+
+typedef struct log_binary_state {
+  FILE *file;
+  // Guards the file, site registration and the buffer list.
+  platform_mutex mutex;
+  // Incremented by every log_binary_init. Site ids and thread buffers from an
+  // earlier generation are stale.
+  u32 generation;
+  u32 next_site_id;
+  u32 buffer_count;
+  log_binary_buffer *buffers[LOG_BINARY_MAX_THREADS];
+} log_binary_state;
+
+static atomic_b8 is_initialized = FALSE;
+static log_binary_state state;
+
+// The calling thread's buffer, created on its first binary log call in each
+// generation.
+static VTHREAD_LOCAL log_binary_buffer *thread_buffer;
+static VTHREAD_LOCAL u32 thread_buffer_generation;
+
+b8 log_binary_init(const char *path) {
+  if (vatomic_load_b8(&is_initialized, VMEMORY_ORDER_ACQUIRE)) {
+    return FALSE;
+  }
+
+  state.file = fopen(path, "wb");
+  if (!state.file) {
+    VERROR("Failed to open binary log file '%s'.", path);
+    return FALSE;
+  }
+
+  if (!platform_mutex_create(&state.mutex)) {
+    fclose(state.file);
+    return FALSE;
+  }
+
+  u32 header[2] = {LOG_BINARY_MAGIC, LOG_BINARY_VERSION};
+  fwrite(header, sizeof(header), 1, state.file);
+
+  state.generation++;
+  state.next_site_id = 1;
+  state.buffer_count = 0;
+
+  vatomic_store_b8(&is_initialized, TRUE, VMEMORY_ORDER_RELEASE);
+  return TRUE;
+}
+
+// Writes a buffer's records as one block. Expects the mutex to be held.
+static void flush_buffer(log_binary_buffer *buffer) {
+  if (buffer->length == 0) {
+    return;
+  }
+
+  log_binary_block_header header = {
+      .type = LOG_BLOCK_RECORDS,
+      .size = (u32)(sizeof(u32) + buffer->length),
+  };
+  fwrite(&header, sizeof(header), 1, state.file);
+  fwrite(&buffer->thread_index, sizeof(u32), 1, state.file);
+  fwrite(buffer->data, buffer->length, 1, state.file);
+
+  buffer->length = 0;
+}
+
+void log_binary_shutdown() {
+  if (!vatomic_load_b8(&is_initialized, VMEMORY_ORDER_ACQUIRE)) {
+    return;
+  }
+
+  // NOTE: Any thread still logging at this point will lose its records, so
+  // this must run after all other threads have stopped.
+  vatomic_store_b8(&is_initialized, FALSE, VMEMORY_ORDER_RELEASE);
+
+  platform_mutex_lock(&state.mutex);
+  for (u32 i = 0; i < state.buffer_count; ++i) {
+    flush_buffer(state.buffers[i]);
+    platform_free(state.buffers[i], FALSE);
+    state.buffers[i] = NULL;
+  }
+  state.buffer_count = 0;
+  fclose(state.file);
+  state.file = NULL;
+  platform_mutex_unlock(&state.mutex);
+
+  platform_mutex_destroy(&state.mutex);
+  thread_buffer = NULL;
+}
+
+static u32 registration_generation(u64 registration) {
+  return (u32)(registration >> 32);
+}
+
+static void register_site(log_site *site) {
+  platform_mutex_lock(&state.mutex);
+
+  // Another thread may have won the race to register this site.
+  u64 registration =
+      vatomic_load_u64(&site->registration, VMEMORY_ORDER_ACQUIRE);
+  if (registration_generation(registration) != state.generation) {
+    u32 id = state.next_site_id++;
+    u16 format_length = (u16)strlen(site->format);
+    u16 file_length = (u16)strlen(site->file);
+
+    log_binary_block_header header = {
+        .type = LOG_BLOCK_SITE,
+        .size = sizeof(u32) + 2 * sizeof(u8) + LOG_BINARY_MAX_ARGS +
+                sizeof(u32) + 2 * sizeof(u16) + format_length + file_length,
+    };
+    fwrite(&header, sizeof(header), 1, state.file);
+    fwrite(&id, sizeof(u32), 1, state.file);
+    fwrite(&site->level, sizeof(u8), 1, state.file);
+    fwrite(&site->arg_count, sizeof(u8), 1, state.file);
+    fwrite(site->arg_types, LOG_BINARY_MAX_ARGS, 1, state.file);
+    fwrite(&site->line, sizeof(u32), 1, state.file);
+    fwrite(&format_length, sizeof(u16), 1, state.file);
+    fwrite(&file_length, sizeof(u16), 1, state.file);
+    fwrite(site->format, format_length, 1, state.file);
+    fwrite(site->file, file_length, 1, state.file);
+
+    // Publish only once the definition precedes any record that uses it.
+    vatomic_store_u64(&site->registration,
+                      ((u64)state.generation << 32) | id,
+                      VMEMORY_ORDER_RELEASE);
+  }
+
+  platform_mutex_unlock(&state.mutex);
+}
+
+static log_binary_buffer *create_thread_buffer() {
+  platform_mutex_lock(&state.mutex);
+
+  log_binary_buffer *buffer = NULL;
+  if (state.buffer_count < LOG_BINARY_MAX_THREADS) {
+    buffer = platform_allocate(sizeof(log_binary_buffer), FALSE);
+    buffer->thread_index = state.buffer_count;
+    buffer->length = 0;
+    state.buffers[state.buffer_count++] = buffer;
+  }
+
+  platform_mutex_unlock(&state.mutex);
+  return buffer;
+}
+
+b8 log_binary_begin(log_site *site) {
+  if (!vatomic_load_b8(&is_initialized, VMEMORY_ORDER_ACQUIRE)) {
+    return FALSE;
+  }
+
+  // A buffer from an earlier generation was freed by its shutdown.
+  if (!thread_buffer || thread_buffer_generation != state.generation) {
+    thread_buffer = create_thread_buffer();
+    thread_buffer_generation = state.generation;
+    if (!thread_buffer) {
+      return FALSE;
+    }
+  }
+
+  u64 registration =
+      vatomic_load_u64(&site->registration, VMEMORY_ORDER_ACQUIRE);
+  if (registration_generation(registration) != state.generation) {
+    register_site(site);
+    registration =
+        vatomic_load_u64(&site->registration, VMEMORY_ORDER_RELAXED);
+  }
+  u32 id = (u32)registration;
+
+  // Records never straddle a flush, so make room for the largest one.
+  if (LOG_BINARY_BUFFER_SIZE - thread_buffer->length <
+      LOG_BINARY_MAX_RECORD_SIZE) {
+    log_binary_flush_thread();
+  }
+
+  u8 *cursor = thread_buffer->data + thread_buffer->length;
+  f64 timestamp = platform_get_absolute_time();
+  memcpy(cursor, &id, sizeof(u32));
+  memcpy(cursor + sizeof(u32), &timestamp, sizeof(f64));
+  thread_buffer->length += LOG_BINARY_RECORD_HEADER_SIZE;
+
+  return TRUE;
+}
+
+static void write_bytes(const void *data, u64 size) {
+  memcpy(thread_buffer->data + thread_buffer->length, data, size);
+  thread_buffer->length += size;
+}
+
+void log_binary_write_i64(i64 value) { write_bytes(&value, sizeof(i64)); }
+
+void log_binary_write_u64(u64 value) { write_bytes(&value, sizeof(u64)); }
+
+void log_binary_write_f64(f64 value) { write_bytes(&value, sizeof(f64)); }
+
+void log_binary_write_pointer(const void *value) {
+  u64 address = (u64)value;
+  write_bytes(&address, sizeof(u64));
+}
+
+void log_binary_write_string(const char *value) {
+  u64 length = value ? strlen(value) : 0;
+  if (length > LOG_BINARY_MAX_STRING_LENGTH) {
+    length = LOG_BINARY_MAX_STRING_LENGTH;
+  }
+
+  u16 encoded_length = (u16)length;
+  write_bytes(&encoded_length, sizeof(u16));
+  if (length) {
+    write_bytes(value, length);
+  }
+}
+
+void log_binary_flush_thread() {
+  if (!vatomic_load_b8(&is_initialized, VMEMORY_ORDER_ACQUIRE) ||
+      !thread_buffer || thread_buffer_generation != state.generation) {
+    return;
+  }
+
+  platform_mutex_lock(&state.mutex);
+  flush_buffer(thread_buffer);
+  platform_mutex_unlock(&state.mutex);
+}
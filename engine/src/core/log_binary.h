@@ -0,0 +1,143 @@
+#pragma once
+
+#include <core/log_binary_format.h>
+#include <defines.h>
+#include <platform/atomic.h>
+
+/**
+ * Deferred-format logging. Instead of formatting the message, a call site
+ * records its static site id plus the raw bytes of its arguments into a
+ * per-thread buffer. The resulting binary log is turned back into text offline
+ * by the vlog_decode tool.
+ *
+ * The format string must be a string literal and the call can take at most
+ * LOG_BINARY_MAX_ARGS arguments. Each argument is evaluated exactly once.
+ */
+
+// Static description of a single log call site.
+typedef struct log_site {
+  // Generation of the binary log the site is registered with in the upper 32
+  // bits, and its id in that log in the lower. A site registers again when
+  // the log has been restarted since. Zero until first use.
+  atomic_u64 registration;
+  u8 level;
+  u8 arg_count;
+  u8 arg_types[LOG_BINARY_MAX_ARGS];
+  u32 line;
+  const char *format;
+  const char *file;
+} log_site;
+
+b8 log_binary_init(const char *path);
+void log_binary_shutdown();
+
+/**
+ * Starts a record for the given site on the calling thread's buffer.
+ *
+ * @param site The call site. Registered with the log on first use.
+ * @return TRUE if the arguments should now be written, FALSE if binary
+ * logging is unavailable and the caller should fall back to text.
+ */
+VAPI b8 log_binary_begin(log_site *site);
+
+VAPI void log_binary_write_i64(i64 value);
+VAPI void log_binary_write_u64(u64 value);
+VAPI void log_binary_write_f64(f64 value);
+VAPI void log_binary_write_pointer(const void *value);
+VAPI void log_binary_write_string(const char *value);
+
+// Writes the calling thread's buffered records out to the log file.
+VAPI void log_binary_flush_thread();
+
+#define _VLOG_ARG_TYPE(arg)                                                    \
+  _Generic((arg),                                                              \
+      char: LOG_ARG_I64,                                                       \
+      signed char: LOG_ARG_I64,                                                \
+      short: LOG_ARG_I64,                                                      \
+      int: LOG_ARG_I64,                                                        \
+      long: LOG_ARG_I64,                                                       \
+      long long: LOG_ARG_I64,                                                  \
+      _Bool: LOG_ARG_U64,                                                      \
+      unsigned char: LOG_ARG_U64,                                              \
+      unsigned short: LOG_ARG_U64,                                             \
+      unsigned int: LOG_ARG_U64,                                               \
+      unsigned long: LOG_ARG_U64,                                              \
+      unsigned long long: LOG_ARG_U64,                                         \
+      float: LOG_ARG_F64,                                                      \
+      double: LOG_ARG_F64,                                                     \
+      char *: LOG_ARG_STRING,                                                  \
+      const char *: LOG_ARG_STRING,                                            \
+      default: LOG_ARG_POINTER)
+
+#define _VLOG_WRITE_ARG(arg)                                                   \
+  _Generic((arg),                                                              \
+      char: log_binary_write_i64,                                              \
+      signed char: log_binary_write_i64,                                       \
+      short: log_binary_write_i64,                                             \
+      int: log_binary_write_i64,                                               \
+      long: log_binary_write_i64,                                              \
+      long long: log_binary_write_i64,                                         \
+      _Bool: log_binary_write_u64,                                             \
+      unsigned char: log_binary_write_u64,                                     \
+      unsigned short: log_binary_write_u64,                                    \
+      unsigned int: log_binary_write_u64,                                      \
+      unsigned long: log_binary_write_u64,                                     \
+      unsigned long long: log_binary_write_u64,                                \
+      float: log_binary_write_f64,                                             \
+      double: log_binary_write_f64,                                            \
+      char *: log_binary_write_string,                                         \
+      const char *: log_binary_write_string,                                   \
+      default: log_binary_write_pointer)(arg);
+
+// Argument counting and per-argument expansion, for up to 8 arguments.
+#define _VLOG_ARG_COUNT(...)                                                   \
+  _VLOG_ARG_COUNT_IMPL(_, ##__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define _VLOG_ARG_COUNT_IMPL(_0, _1, _2, _3, _4, _5, _6, _7, _8, count, ...)   \
+  count
+
+#define _VLOG_CONCAT(a, b) _VLOG_CONCAT_IMPL(a, b)
+#define _VLOG_CONCAT_IMPL(a, b) a##b
+
+#define _VLOG_TYPES(...)                                                       \
+  _VLOG_CONCAT(_VLOG_TYPES_, _VLOG_ARG_COUNT(__VA_ARGS__))(__VA_ARGS__)
+#define _VLOG_TYPES_0()
+#define _VLOG_TYPES_1(a) _VLOG_ARG_TYPE(a)
+#define _VLOG_TYPES_2(a, ...) _VLOG_ARG_TYPE(a), _VLOG_TYPES_1(__VA_ARGS__)
+#define _VLOG_TYPES_3(a, ...) _VLOG_ARG_TYPE(a), _VLOG_TYPES_2(__VA_ARGS__)
+#define _VLOG_TYPES_4(a, ...) _VLOG_ARG_TYPE(a), _VLOG_TYPES_3(__VA_ARGS__)
+#define _VLOG_TYPES_5(a, ...) _VLOG_ARG_TYPE(a), _VLOG_TYPES_4(__VA_ARGS__)
+#define _VLOG_TYPES_6(a, ...) _VLOG_ARG_TYPE(a), _VLOG_TYPES_5(__VA_ARGS__)
+#define _VLOG_TYPES_7(a, ...) _VLOG_ARG_TYPE(a), _VLOG_TYPES_6(__VA_ARGS__)
+#define _VLOG_TYPES_8(a, ...) _VLOG_ARG_TYPE(a), _VLOG_TYPES_7(__VA_ARGS__)
+
+#define _VLOG_WRITES(...)                                                      \
+  _VLOG_CONCAT(_VLOG_WRITES_, _VLOG_ARG_COUNT(__VA_ARGS__))(__VA_ARGS__)
+#define _VLOG_WRITES_0()
+#define _VLOG_WRITES_1(a) _VLOG_WRITE_ARG(a)
+#define _VLOG_WRITES_2(a, ...) _VLOG_WRITE_ARG(a) _VLOG_WRITES_1(__VA_ARGS__)
+#define _VLOG_WRITES_3(a, ...) _VLOG_WRITE_ARG(a) _VLOG_WRITES_2(__VA_ARGS__)
+#define _VLOG_WRITES_4(a, ...) _VLOG_WRITE_ARG(a) _VLOG_WRITES_3(__VA_ARGS__)
+#define _VLOG_WRITES_5(a, ...) _VLOG_WRITE_ARG(a) _VLOG_WRITES_4(__VA_ARGS__)
+#define _VLOG_WRITES_6(a, ...) _VLOG_WRITE_ARG(a) _VLOG_WRITES_5(__VA_ARGS__)
+#define _VLOG_WRITES_7(a, ...) _VLOG_WRITE_ARG(a) _VLOG_WRITES_6(__VA_ARGS__)
+#define _VLOG_WRITES_8(a, ...) _VLOG_WRITE_ARG(a) _VLOG_WRITES_7(__VA_ARGS__)
+
+/**
+ * Records a binary log entry. Falls back to regular text logging when binary
+ * logging has not been initialized.
+ */
+#define VLOG_BINARY(level, message, ...)                                       \
+  do {                                                                         \
+    static log_site _vlog_site = {0,                                           \
+                                  level,                                       \
+                                  _VLOG_ARG_COUNT(__VA_ARGS__),                \
+                                  {_VLOG_TYPES(__VA_ARGS__)},                  \
+                                  __LINE__,                                    \
+                                  message,                                     \
+                                  __FILE__};                                   \
+    if (log_binary_begin(&_vlog_site)) {                                       \
+      _VLOG_WRITES(__VA_ARGS__)                                                \
+    } else {                                                                   \
+      log_output(level, message, ##__VA_ARGS__);                               \
+    }                                                                          \
+  } while (0)
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <defines.h>
+
+/**
+ * On-disk layout of the binary log written when LOG_BINARY_ENABLED is set.
+ * This header is shared with the offline decoder, so it must not depend on
+ * any other engine code.
+ *
+ * FILE LAYOUT:
+ *
+ * +-------+---------+---------------------------------------------------
+ * | magic | version | blocks...
+ * | (u32) | (u32)   |
+ * +-------+---------+---------------------------------------------------
+ *
+ * Each block starts with a header { u32 type; u32 size; } followed by size
+ * bytes of payload. All values are little-endian.
+ *
+ * LOG_BLOCK_SITE payload (one per call site, written before its first record):
+ *   u32 id, u8 level, u8 arg_count, u8 arg_types[LOG_BINARY_MAX_ARGS],
+ *   u32 line, u16 format_length, u16 file_length, format bytes, file bytes.
+ *
+ * LOG_BLOCK_RECORDS payload (the contents of one thread's buffer):
+ *   u32 thread_index, then records of
+ *   u32 site_id, f64 timestamp, followed by the arguments in order. Numeric
+ *   and pointer arguments take 8 bytes; strings take a u16 length followed by
+ *   that many bytes (no terminator).
+ */
+
+#define LOG_BINARY_MAGIC 0x474F4C56 // "VLOG"
+#define LOG_BINARY_VERSION 1
+
+// Maximum number of arguments a binary log call site can take.
+#define LOG_BINARY_MAX_ARGS 8
+
+// String arguments longer than this are truncated.
+#define LOG_BINARY_MAX_STRING_LENGTH 1024
+
+typedef enum log_binary_block_type {
+  LOG_BLOCK_SITE = 1,
+  LOG_BLOCK_RECORDS = 2,
+} log_binary_block_type;
+
+typedef enum log_binary_arg_type {
+  LOG_ARG_I64,
+  LOG_ARG_U64,
+  LOG_ARG_F64,
+  LOG_ARG_POINTER,
+  LOG_ARG_STRING,
+} log_binary_arg_type;
+
+typedef struct log_binary_block_header {
+  u32 type;
+  u32 size;
+} log_binary_block_header;
+
+// Size of the fixed part of a record, before its arguments.
+#define LOG_BINARY_RECORD_HEADER_SIZE (sizeof(u32) + sizeof(f64))
+
+// Upper bound on the encoded size of a single record.
+#define LOG_BINARY_MAX_RECORD_SIZE                                             \
+  (LOG_BINARY_RECORD_HEADER_SIZE +                                             \
+   LOG_BINARY_MAX_ARGS * (sizeof(u16) + LOG_BINARY_MAX_STRING_LENGTH))
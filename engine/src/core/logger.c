@@ -1,44 +1,544 @@
 #include <core/logger.h>
 
+#include <core/log_binary.h>
 #include <defines.h>
 #include <platform/platform.h>
 
 // TODO: temporary
 #include <stdarg.h>
+#include <stdatomic.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
-b8 logger_init() {
-  // TODO: create log file.
+// Number of queued log entries. Must be a power of two.
+#define LOG_QUEUE_CAPACITY 1024
+
+// NOTE: This imposes a limit on the length of a single log message, including
+// the level prefix and trailing newline. Longer messages are truncated.
+#define LOG_ENTRY_MAX_LENGTH 1024
+
+// How long the writer sleeps before re-checking the queue on its own.
+#define LOG_WRITER_IDLE_TIMEOUT_MS 100
+
+#define LOG_FILE_PATH "vivid.log"
+// The log file is mapped and grown this much at a time.
+#define LOG_FILE_CHUNK_SIZE (1024 * 1024)
+// Once the log file reaches this size it is rotated out.
+#define LOG_FILE_MAX_SIZE (64 * LOG_FILE_CHUNK_SIZE)
+// Number of rotated log files kept around (vivid.log.1 ... vivid.log.N).
+#define LOG_FILE_MAX_ROTATIONS 3
+
+STATIC_ASSERT((LOG_QUEUE_CAPACITY & (LOG_QUEUE_CAPACITY - 1)) == 0,
+              log_queue_capacity_power_of_two);
+
+typedef struct log_entry {
+  // Sequence number used to hand the slot between producers and the writer.
+  atomic_ullong sequence;
+  u8 level;
+  u16 length;
+  char message[LOG_ENTRY_MAX_LENGTH];
+} log_entry;
+
+/**
+ * Log file written through a memory-mapped window. Only the writer thread
+ * touches it.
+ */
+typedef struct log_file_sink {
+  platform_file file;
+  // Currently mapped chunk of the file.
+  char *chunk;
+  // File offset of the mapped chunk.
+  u64 chunk_offset;
+  // Write position within the mapped chunk.
+  u64 cursor;
+} log_file_sink;
+
+/**
+ * Multi-producer, single-consumer bounded queue. Any thread may log; only the
+ * writer thread consumes. Producer and consumer cursors live on separate cache
+ * lines so logging threads do not contend with the writer.
+ */
+typedef struct logger_system_state {
+  _Alignas(64) atomic_ullong enqueue_position;
+  _Alignas(64) atomic_ullong dequeue_position;
+  atomic_bool writer_sleeping;
+  atomic_bool writer_running;
+  platform_thread writer_thread;
+  platform_semaphore writer_wake;
+  log_file_sink file_sink;
+  log_entry entries[LOG_QUEUE_CAPACITY];
+} logger_system_state;
+
+static const char *level_strings[6] = {"[FATAL]: ", "[ERROR]: ", "[WARN]: ",
+                                       "[INFO]: ",  "[DEBUG]: ", "[TRACE]: "};
+
+// Names used by VIVID_LOG_LEVELS.
+static const char *level_names[6] = {"fatal", "error", "warn",
+                                     "info",  "debug", "trace"};
+static const char *category_names[LOG_CATEGORY_MAX_COUNT] = {
+    "general", "memory", "events", "input", "platform", "game"};
+
+// Everything that is compiled in is logged until configured otherwise. One
+// entry per category, kept in step by the assertion below.
+u8 log_category_levels[LOG_CATEGORY_MAX_COUNT] = {
+    LOG_LEVEL_COMPILED_MAX, LOG_LEVEL_COMPILED_MAX, LOG_LEVEL_COMPILED_MAX,
+    LOG_LEVEL_COMPILED_MAX, LOG_LEVEL_COMPILED_MAX, LOG_LEVEL_COMPILED_MAX};
+
+STATIC_ASSERT(LOG_CATEGORY_MAX_COUNT == 6, log_category_levels_initialized);
+
+/**
+ * Logger internal state.
+ */
+static atomic_bool is_initialized = FALSE;
+static logger_system_state *state;
+
+// Set on the writer thread. Anything it logs itself, such as a failure to
+// reopen the log file, must not wait on the queue only it drains.
+static VTHREAD_LOCAL b8 is_writer_thread = FALSE;
+
+static u32 logger_writer_thread(void *params);
+static void apply_level_overrides(const char *config);
+static b8 log_file_open(log_file_sink *sink);
+static void log_file_close(log_file_sink *sink);
+static void log_file_write(log_file_sink *sink, const char *message,
+                           u64 length);
+
+b8 logger_init(u64 *memory_requirement, void *memory) {
+  *memory_requirement = sizeof(logger_system_state);
+  if (!memory) {
+    return TRUE;
+  }
+
+  if (atomic_load(&is_initialized)) {
+    return FALSE;
+  }
+
+  state = memory;
+  platform_zero_memory(state, sizeof(logger_system_state));
+
+  apply_level_overrides(getenv("VIVID_LOG_LEVELS"));
+
+  atomic_store(&state->enqueue_position, 0);
+  atomic_store(&state->dequeue_position, 0);
+  atomic_store(&state->writer_sleeping, FALSE);
+  for (u64 i = 0; i < LOG_QUEUE_CAPACITY; ++i) {
+    atomic_store_explicit(&state->entries[i].sequence, i,
+                          memory_order_relaxed);
+  }
+
+  if (!platform_semaphore_create(0, &state->writer_wake)) {
+    return FALSE;
+  }
+
+  // Logging to the console still works without a log file.
+  log_file_open(&state->file_sink);
+
+#ifdef LOG_BINARY_ENABLED
+  // Binary call sites fall back to text logging if this fails.
+  log_binary_init(LOG_BINARY_FILE_PATH);
+#endif
+
+  atomic_store(&state->writer_running, TRUE);
+  if (!platform_thread_create("vivid-log", logger_writer_thread, NULL,
+                              &state->writer_thread)) {
+    log_file_close(&state->file_sink);
+    platform_semaphore_destroy(&state->writer_wake);
+    return FALSE;
+  }
+
+  atomic_store_explicit(&is_initialized, TRUE, memory_order_release);
   return TRUE;
 }
+
 void logger_shutdown() {
-  // TODO: cleanup logging/writing queued logs.
+  if (!atomic_load(&is_initialized)) {
+    return;
+  }
+
+#ifdef LOG_BINARY_ENABLED
+  log_binary_shutdown();
+#endif
+
+  // Anything logged from here on is written synchronously.
+  atomic_store_explicit(&is_initialized, FALSE, memory_order_release);
+
+  // The writer drains the queue before it exits.
+  atomic_store(&state->writer_running, FALSE);
+  platform_semaphore_signal(&state->writer_wake);
+  platform_thread_join(&state->writer_thread);
+
+  log_file_close(&state->file_sink);
+  platform_semaphore_destroy(&state->writer_wake);
 }
 
-void log_output(log_level level, const char *message, ...) {
-  const char *level_strings[6] = {"[FATAL]: ", "[ERROR]: ", "[WARN]: ",
-                                  "[INFO]: ",  "[DEBUG]: ", "[TRACE]: "};
-  b8 is_error = level < LOG_LEVEL_WARN;
+void logger_set_category_level(log_category category, log_level level) {
+  if (category >= LOG_CATEGORY_MAX_COUNT) {
+    return;
+  }
+
+  // Levels beyond what was compiled in would never be logged anyway.
+  if (level > LOG_LEVEL_COMPILED_MAX) {
+    level = LOG_LEVEL_COMPILED_MAX;
+  }
+
+  log_category_levels[category] = (u8)level;
+}
+
+log_level logger_get_category_level(log_category category) {
+  if (category >= LOG_CATEGORY_MAX_COUNT) {
+    return LOG_LEVEL_FATAL;
+  }
+
+  return (log_level)log_category_levels[category];
+}
+
+/**
+ * Parses a comma separated list of category=level pairs, where category may
+ * be '*' for all categories. Unrecognised entries are reported and skipped.
+ */
+static void apply_level_overrides(const char *config) {
+  if (!config) {
+    return;
+  }
+
+  while (*config) {
+    u64 entry_length = strcspn(config, ",");
+    const char *separator = memchr(config, '=', entry_length);
+
+    b8 applied = FALSE;
+    if (separator) {
+      u64 name_length = separator - config;
+      u64 value_length = entry_length - name_length - 1;
+
+      for (u32 l = 0; l <= LOG_LEVEL_TRACE && !applied; ++l) {
+        if (strlen(level_names[l]) != value_length ||
+            strncmp(separator + 1, level_names[l], value_length) != 0) {
+          continue;
+        }
+
+        for (u32 c = 0; c < LOG_CATEGORY_MAX_COUNT; ++c) {
+          b8 matches = (name_length == 1 && config[0] == '*') ||
+                       (strlen(category_names[c]) == name_length &&
+                        strncmp(config, category_names[c], name_length) == 0);
+          if (matches) {
+            logger_set_category_level((log_category)c, (log_level)l);
+            applied = TRUE;
+          }
+        }
+      }
+    }
 
-  // NOTE: This imposes a limit on the length of the log message. However, this
-  // has been set to 32000 characters, which should be more than enough for most
-  // log messages.
-  char out_msg[32000];
-  platform_zero_memory(out_msg, sizeof(out_msg));
+    if (!applied && entry_length > 0) {
+      VWARN("Ignoring invalid VIVID_LOG_LEVELS entry '%.*s'.",
+            (i32)entry_length, config);
+    }
 
-  __builtin_va_list args;
+    config += entry_length;
+    if (*config == ',') {
+      ++config;
+    }
+  }
+}
+
+b8 log_rate_limit_check(log_rate_limit *limit, u32 max_per_second,
+                        log_level level, const char *file, i32 line) {
+  // NOTE: Call sites hit from several threads at once may over- or under-count
+  // slightly. That is fine for throttling log output.
+  f64 now = platform_get_absolute_time();
+  if (now - limit->window_start >= 1.0) {
+    u32 suppressed = limit->suppressed;
+    limit->window_start = now;
+    limit->count = 0;
+    limit->suppressed = 0;
+
+    if (suppressed) {
+      log_output(level, "Suppressed %u message(s) from %s:%d.", suppressed,
+                 file, line);
+    }
+  }
+
+  if (limit->count < max_per_second) {
+    limit->count++;
+    return TRUE;
+  }
+
+  limit->suppressed++;
+  return FALSE;
+}
+
+/**
+ * Formats a message with its level prefix and trailing newline into buffer.
+ * Returns the length of the formatted message, excluding the terminator.
+ */
+static u16 format_entry(char *buffer, log_level level, const char *message,
+                        va_list args) {
+  const u64 capacity = LOG_ENTRY_MAX_LENGTH;
+  u64 prefix_length = strlen(level_strings[level]);
+  memcpy(buffer, level_strings[level], prefix_length);
+
+  // Leave room for the newline and terminator.
+  i32 written = vsnprintf(buffer + prefix_length, capacity - prefix_length - 1,
+                          message, args);
+  if (written < 0) {
+    written = 0;
+  }
+
+  u64 length = prefix_length + (u64)written;
+  if (length > capacity - 2) {
+    length = capacity - 2;
+  }
+
+  buffer[length++] = '\n';
+  buffer[length] = '\0';
+  return (u16)length;
+}
+
+static void write_entry(log_level level, const char *message) {
+  if (level < LOG_LEVEL_WARN) {
+    platform_console_write_error(message, level);
+  } else {
+    platform_console_write(message, level);
+  }
+}
+
+static void wake_writer() {
+  if (atomic_exchange(&state->writer_sleeping, FALSE)) {
+    platform_semaphore_signal(&state->writer_wake);
+  }
+}
+
+void logger_flush() {
+  if (!atomic_load_explicit(&is_initialized, memory_order_acquire) ||
+      is_writer_thread) {
+    return;
+  }
+
+  u64 target = atomic_load(&state->enqueue_position);
+  while (atomic_load_explicit(&state->dequeue_position, memory_order_acquire) <
+         target) {
+    wake_writer();
+    platform_sleep(0);
+  }
+}
+
+void log_output(log_level level, const char *message, ...) {
+  va_list args;
   va_start(args, message);
-  vsnprintf(out_msg, sizeof(out_msg), message, args);
+
+  if (!atomic_load_explicit(&is_initialized, memory_order_acquire) ||
+      is_writer_thread) {
+    // No writer thread yet (or anymore), or this is the writer itself, so
+    // write on the calling thread. Console only: the file sink may be what
+    // failed.
+    char output[LOG_ENTRY_MAX_LENGTH];
+    format_entry(output, level, message, args);
+    va_end(args);
+    write_entry(level, output);
+    return;
+  }
+
+  // Claim a slot.
+  u64 position =
+      atomic_load_explicit(&state->enqueue_position, memory_order_relaxed);
+  log_entry *entry;
+  for (;;) {
+    entry = &state->entries[position & (LOG_QUEUE_CAPACITY - 1)];
+    u64 sequence =
+        atomic_load_explicit(&entry->sequence, memory_order_acquire);
+    i64 difference = (i64)sequence - (i64)position;
+
+    if (difference == 0) {
+      if (atomic_compare_exchange_weak_explicit(
+              &state->enqueue_position, &position, position + 1,
+              memory_order_relaxed, memory_order_relaxed)) {
+        break;
+      }
+    } else if (difference < 0) {
+      // Queue is full. Losing log lines is worse than a stall, so wait for the
+      // writer to free up a slot.
+      wake_writer();
+      platform_sleep(0);
+      position =
+          atomic_load_explicit(&state->enqueue_position, memory_order_relaxed);
+    } else {
+      position =
+          atomic_load_explicit(&state->enqueue_position, memory_order_relaxed);
+    }
+  }
+
+  entry->level = (u8)level;
+  entry->length = format_entry(entry->message, level, message, args);
   va_end(args);
 
-  char output[32000];
-  platform_zero_memory(output, sizeof(output));
-  sprintf(output, "%s%s\n", level_strings[level], out_msg);
+  // Publish the slot to the writer.
+  atomic_store_explicit(&entry->sequence, position + 1, memory_order_release);
+  wake_writer();
 
-  if (is_error) {
-    platform_console_write_error(output, level);
-  } else {
-    platform_console_write(output, level);
+  // Errors are rare and fatal messages usually precede a crash, so make sure
+  // they have reached the console before returning.
+  if (level <= LOG_LEVEL_ERROR) {
+    logger_flush();
+  }
+}
+
+/**
+ * Writes out every published entry. Returns the number of entries written.
+ */
+static u64 drain_queue() {
+  u64 count = 0;
+  u64 position =
+      atomic_load_explicit(&state->dequeue_position, memory_order_relaxed);
+
+  for (;;) {
+    log_entry *entry = &state->entries[position & (LOG_QUEUE_CAPACITY - 1)];
+    u64 sequence =
+        atomic_load_explicit(&entry->sequence, memory_order_acquire);
+    if (sequence != position + 1) {
+      break;
+    }
+
+    write_entry((log_level)entry->level, entry->message);
+    log_file_write(&state->file_sink, entry->message, entry->length);
+
+    // Hand the slot back to producers for the next lap around the ring.
+    atomic_store_explicit(&entry->sequence, position + LOG_QUEUE_CAPACITY,
+                          memory_order_release);
+    ++position;
+    atomic_store_explicit(&state->dequeue_position, position,
+                          memory_order_release);
+    ++count;
+  }
+
+  return count;
+}
+
+static u32 logger_writer_thread(void *params) {
+  is_writer_thread = TRUE;
+
+  for (;;) {
+    if (drain_queue()) {
+      continue;
+    }
+
+    if (!atomic_load(&state->writer_running)) {
+      // Pick up anything published between the last drain and shutdown.
+      drain_queue();
+      break;
+    }
+
+    // Announce that a wake-up is needed, then re-check so a message published
+    // in between is not left waiting for the idle timeout.
+    atomic_store(&state->writer_sleeping, TRUE);
+    u64 enqueued = atomic_load(&state->enqueue_position);
+    u64 dequeued = atomic_load(&state->dequeue_position);
+    if (enqueued == dequeued) {
+      platform_semaphore_wait(&state->writer_wake, LOG_WRITER_IDLE_TIMEOUT_MS);
+    }
+    atomic_store(&state->writer_sleeping, FALSE);
+  }
+
+  return 0;
+}
+
+/**
+ * Grows the file by a chunk and maps it at the given offset.
+ */
+static b8 log_file_map_chunk(log_file_sink *sink, u64 offset) {
+  if (!platform_file_set_size(&sink->file, offset + LOG_FILE_CHUNK_SIZE)) {
+    return FALSE;
+  }
+
+  char *chunk =
+      platform_file_map_write(&sink->file, offset, LOG_FILE_CHUNK_SIZE);
+  if (!chunk) {
+    return FALSE;
+  }
+
+  sink->chunk = chunk;
+  sink->chunk_offset = offset;
+  sink->cursor = 0;
+  return TRUE;
+}
+
+static b8 log_file_open(log_file_sink *sink) {
+  sink->chunk = NULL;
+  sink->chunk_offset = 0;
+  sink->cursor = 0;
+  if (!platform_file_open_write(LOG_FILE_PATH, &sink->file)) {
+    return FALSE;
+  }
+
+  if (!log_file_map_chunk(sink, 0)) {
+    platform_file_close(&sink->file);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static void log_file_close(log_file_sink *sink) {
+  if (!sink->file.is_valid) {
+    return;
+  }
+
+  platform_file_unmap(sink->chunk, LOG_FILE_CHUNK_SIZE);
+  sink->chunk = NULL;
+
+  // Trim the unused tail of the last chunk.
+  platform_file_set_size(&sink->file, sink->chunk_offset + sink->cursor);
+  platform_file_close(&sink->file);
+}
+
+/**
+ * Shifts vivid.log -> vivid.log.1 -> ... -> vivid.log.N, discarding the
+ * oldest, and starts a fresh log file.
+ */
+static b8 log_file_rotate(log_file_sink *sink) {
+  log_file_close(sink);
+
+  char old_path[256];
+  char new_path[256];
+  snprintf(old_path, sizeof(old_path), "%s.%d", LOG_FILE_PATH,
+           LOG_FILE_MAX_ROTATIONS);
+  platform_file_remove(old_path);
+
+  for (i32 i = LOG_FILE_MAX_ROTATIONS - 1; i > 0; --i) {
+    snprintf(old_path, sizeof(old_path), "%s.%d", LOG_FILE_PATH, i);
+    snprintf(new_path, sizeof(new_path), "%s.%d", LOG_FILE_PATH, i + 1);
+    platform_file_rename(old_path, new_path);
+  }
+
+  snprintf(new_path, sizeof(new_path), "%s.1", LOG_FILE_PATH);
+  platform_file_rename(LOG_FILE_PATH, new_path);
+
+  return log_file_open(sink);
+}
+
+static void log_file_write(log_file_sink *sink, const char *message,
+                           u64 length) {
+  while (length > 0 && sink->chunk) {
+    u64 available = LOG_FILE_CHUNK_SIZE - sink->cursor;
+    if (available == 0) {
+      u64 next_offset = sink->chunk_offset + LOG_FILE_CHUNK_SIZE;
+      platform_file_unmap(sink->chunk, LOG_FILE_CHUNK_SIZE);
+      sink->chunk = NULL;
+
+      b8 result = next_offset >= LOG_FILE_MAX_SIZE
+                      ? log_file_rotate(sink)
+                      : log_file_map_chunk(sink, next_offset);
+      if (!result) {
+        // Keep the bytes already written, and carry on console-only.
+        log_file_close(sink);
+        return;
+      }
+      continue;
+    }
+
+    u64 count = length < available ? length : available;
+    memcpy(sink->chunk + sink->cursor, message, count);
+    sink->cursor += count;
+    message += count;
+    length -= count;
   }
 }
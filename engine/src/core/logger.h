@@ -10,6 +10,12 @@
 #define LOG_TRACE_ENABLED 1
 #endif
 
+// When LOG_BINARY_ENABLED is defined (see the VIVID_BINARY_LOGGING CMake
+// option), info, debug and trace messages are recorded in binary form to
+// LOG_BINARY_FILE_PATH and formatted offline by the vlog_decode tool. Warnings
+// and errors are always formatted immediately.
+#define LOG_BINARY_FILE_PATH "vivid.vlog"
+
 typedef enum log_level {
   LOG_LEVEL_FATAL,
   LOG_LEVEL_ERROR,
@@ -19,30 +25,158 @@ typedef enum log_level {
   LOG_LEVEL_TRACE,
 } log_level;
 
-b8 logger_init();
+// Subsystem a message belongs to. Each category has its own runtime level.
+typedef enum log_category {
+  LOG_CATEGORY_GENERAL,
+  LOG_CATEGORY_MEMORY,
+  LOG_CATEGORY_EVENTS,
+  LOG_CATEGORY_INPUT,
+  LOG_CATEGORY_PLATFORM,
+  LOG_CATEGORY_GAME,
+
+  LOG_CATEGORY_MAX_COUNT
+} log_category;
+
+// Most verbose level compiled into this build.
+#if LOG_TRACE_ENABLED
+#define LOG_LEVEL_COMPILED_MAX LOG_LEVEL_TRACE
+#elif LOG_DEBUG_ENABLED
+#define LOG_LEVEL_COMPILED_MAX LOG_LEVEL_DEBUG
+#else
+#define LOG_LEVEL_COMPILED_MAX LOG_LEVEL_INFO
+#endif
+
+/**
+ * Most verbose level currently logged for each category, indexed by
+ * log_category. Read directly by the logging macros so that a disabled
+ * message costs a single load and compare, before any of its arguments are
+ * evaluated. Change it through logger_set_category_level.
+ */
+VAPI extern u8 log_category_levels[LOG_CATEGORY_MAX_COUNT];
+
+#define LOG_CATEGORY_ENABLED(category, level)                                  \
+  ((level) <= log_category_levels[category])
+
+// Per-call-site state used by VLOG_RATE_LIMITED.
+typedef struct log_rate_limit {
+  f64 window_start;
+  u32 count;
+  u32 suppressed;
+} log_rate_limit;
+
+/**
+ * Initializes the logger in two passes, like events_init. Messages logged
+ * before initialization or after shutdown are written synchronously.
+ *
+ * @param memory_requirement Receives the size of the state in bytes.
+ * @param state Cache line aligned memory for the state, which must stay valid
+ * until after logger_shutdown. NULL to only query the size.
+ * @return TRUE on success or after a size query, FALSE otherwise.
+ */
+b8 logger_init(u64 *memory_requirement, void *state);
 void logger_shutdown();
 
+// Blocks until every message queued so far has been written out.
+VAPI void logger_flush();
+
+/**
+ * Sets the most verbose level logged for the given category. Levels can also
+ * be set at startup through the VIVID_LOG_LEVELS environment variable, e.g.
+ * VIVID_LOG_LEVELS="input=warn,memory=trace" or "*=info".
+ */
+VAPI void logger_set_category_level(log_category category, log_level level);
+VAPI log_level logger_get_category_level(log_category category);
+
 VAPI void log_output(log_level level, const char *message, ...);
 
-#define VFATAL(message, ...) log_output(LOG_LEVEL_FATAL, message, ##__VA_ARGS__)
-#define VERROR(message, ...) log_output(LOG_LEVEL_ERROR, message, ##__VA_ARGS__)
+/**
+ * Counts a message against its call site's limit for the current one second
+ * window. Returns TRUE if the message should be logged. When a new window
+ * starts, the number of messages suppressed during the previous one is logged
+ * on behalf of the call site.
+ */
+VAPI b8 log_rate_limit_check(log_rate_limit *limit, u32 max_per_second,
+                             log_level level, const char *file, i32 line);
+
+#ifdef LOG_BINARY_ENABLED
+#include <core/log_binary.h>
+#define _VLOG_EMIT(level, message, ...)                                        \
+  if ((level) >= LOG_LEVEL_INFO) {                                             \
+    VLOG_BINARY(level, message, ##__VA_ARGS__);                                \
+  } else {                                                                     \
+    log_output(level, message, ##__VA_ARGS__);                                 \
+  }
+#else
+#define _VLOG_EMIT(level, message, ...)                                        \
+  log_output(level, message, ##__VA_ARGS__);
+#endif
+
+/**
+ * Logs a message in the given category if both the build and the category's
+ * runtime level allow it. The arguments are only evaluated if it is logged.
+ */
+#define VLOG(category, level, message, ...)                                    \
+  do {                                                                         \
+    if ((level) <= LOG_LEVEL_COMPILED_MAX &&                                   \
+        LOG_CATEGORY_ENABLED(category, level)) {                               \
+      _VLOG_EMIT(level, message, ##__VA_ARGS__)                                \
+    }                                                                          \
+  } while (0)
+
+/**
+ * Like VLOG, but logs at most max_per_second messages per second from this
+ * call site. Intended for messages on hot paths such as per-event input.
+ */
+#define VLOG_RATE_LIMITED(category, level, max_per_second, message, ...)       \
+  do {                                                                         \
+    if ((level) <= LOG_LEVEL_COMPILED_MAX &&                                   \
+        LOG_CATEGORY_ENABLED(category, level)) {                               \
+      static log_rate_limit _vlog_limit;                                       \
+      if (log_rate_limit_check(&_vlog_limit, max_per_second, level, __FILE__,  \
+                               __LINE__)) {                                    \
+        _VLOG_EMIT(level, message, ##__VA_ARGS__)                              \
+      }                                                                        \
+    }                                                                          \
+  } while (0)
+
+#define VFATAL_CAT(category, message, ...)                                     \
+  VLOG(category, LOG_LEVEL_FATAL, message, ##__VA_ARGS__)
+#define VERROR_CAT(category, message, ...)                                     \
+  VLOG(category, LOG_LEVEL_ERROR, message, ##__VA_ARGS__)
 #if LOG_WARN_ENABLED
-#define VWARN(message, ...) log_output(LOG_LEVEL_WARN, message, ##__VA_ARGS__)
+#define VWARN_CAT(category, message, ...)                                      \
+  VLOG(category, LOG_LEVEL_WARN, message, ##__VA_ARGS__)
 #else
-#define VWARN(message, ...)
+#define VWARN_CAT(category, message, ...)
 #endif
 #if LOG_INFO_ENABLED
-#define VINFO(message, ...) log_output(LOG_LEVEL_INFO, message, ##__VA_ARGS__)
+#define VINFO_CAT(category, message, ...)                                      \
+  VLOG(category, LOG_LEVEL_INFO, message, ##__VA_ARGS__)
 #else
-#define VINFO(message, ...)
+#define VINFO_CAT(category, message, ...)
 #endif
 #if LOG_DEBUG_ENABLED
-#define VDEBUG(message, ...) log_output(LOG_LEVEL_DEBUG, message, ##__VA_ARGS__)
+#define VDEBUG_CAT(category, message, ...)                                     \
+  VLOG(category, LOG_LEVEL_DEBUG, message, ##__VA_ARGS__)
 #else
-#define VDEBUG(message, ...)
+#define VDEBUG_CAT(category, message, ...)
 #endif
 #if LOG_TRACE_ENABLED
-#define VTRACE(message, ...) log_output(LOG_LEVEL_TRACE, message, ##__VA_ARGS__)
+#define VTRACE_CAT(category, message, ...)                                     \
+  VLOG(category, LOG_LEVEL_TRACE, message, ##__VA_ARGS__)
 #else
-#define VTRACE(message, ...)
+#define VTRACE_CAT(category, message, ...)
 #endif
+
+#define VFATAL(message, ...)                                                   \
+  VFATAL_CAT(LOG_CATEGORY_GENERAL, message, ##__VA_ARGS__)
+#define VERROR(message, ...)                                                   \
+  VERROR_CAT(LOG_CATEGORY_GENERAL, message, ##__VA_ARGS__)
+#define VWARN(message, ...)                                                    \
+  VWARN_CAT(LOG_CATEGORY_GENERAL, message, ##__VA_ARGS__)
+#define VINFO(message, ...)                                                    \
+  VINFO_CAT(LOG_CATEGORY_GENERAL, message, ##__VA_ARGS__)
+#define VDEBUG(message, ...)                                                   \
+  VDEBUG_CAT(LOG_CATEGORY_GENERAL, message, ##__VA_ARGS__)
+#define VTRACE(message, ...)                                                   \
+  VTRACE_CAT(LOG_CATEGORY_GENERAL, message, ##__VA_ARGS__)
@@ -0,0 +1,215 @@
+#include <core/snapshot.h>
+
+#include <core/logger.h>
+#include <core/vmemory.h>
+#include <platform/atomic.h>
+
+typedef struct snapshot_region {
+  const char *name;
+  void *memory;
+  u64 size;
+  // Where the region starts within each snapshot.
+  u64 offset;
+} snapshot_region;
+
+typedef struct snapshot_system_state {
+  snapshot_region regions[SNAPSHOT_MAX_REGIONS];
+  u32 region_count;
+  // Bytes per snapshot, with each region starting on a cache line.
+  u64 stride;
+
+  u32 capacity;
+  // capacity snapshots of stride bytes. Allocated on the first capture after
+  // the regions change, so registering does not reallocate repeatedly.
+  u8 *ring;
+  u64 ring_size;
+  // Slot the next capture goes to.
+  u32 head;
+  u32 count;
+  // Frame number of each slot. Lives right after this struct.
+  u64 *frames;
+
+  // Age of the requested rewind plus one, or 0 when none is pending.
+  atomic_u32 pending_rewind;
+} snapshot_system_state;
+
+static b8 is_initialized = FALSE;
+static snapshot_system_state *state;
+
+b8 snapshot_system_init(u64 *memory_requirement, void *memory, u32 capacity) {
+  *memory_requirement =
+      sizeof(snapshot_system_state) + sizeof(u64) * (u64)capacity;
+  if (!memory) {
+    return TRUE;
+  }
+
+  if (is_initialized) {
+    return FALSE;
+  }
+
+  state = memory;
+  vzero_memory(state, *memory_requirement);
+  state->capacity = capacity;
+  state->frames = (u64 *)(state + 1);
+
+  is_initialized = TRUE;
+  return TRUE;
+}
+
+// Drops the ring and every snapshot in it, e.g. when the regions change.
+static void release_ring() {
+  if (state->ring) {
+    vfree_aligned(state->ring, state->ring_size, MEMORY_TAG_SNAPSHOT);
+    state->ring = NULL;
+    state->ring_size = 0;
+  }
+
+  state->head = 0;
+  state->count = 0;
+}
+
+void snapshot_system_shutdown() {
+  if (!is_initialized) {
+    return;
+  }
+
+  release_ring();
+  state = NULL;
+  is_initialized = FALSE;
+}
+
+static void layout_regions() {
+  state->stride = 0;
+  for (u32 i = 0; i < state->region_count; ++i) {
+    state->regions[i].offset = state->stride;
+    state->stride += VALIGN_UP(state->regions[i].size, VCACHE_LINE_SIZE);
+  }
+}
+
+b8 snapshot_register(const char *name, void *memory, u64 size) {
+  if (!is_initialized || !memory || size == 0) {
+    return FALSE;
+  }
+
+  for (u32 i = 0; i < state->region_count; ++i) {
+    if (state->regions[i].memory == memory) {
+      VWARN("Snapshot region '%s' is already registered.", name);
+      return FALSE;
+    }
+  }
+
+  if (state->region_count == SNAPSHOT_MAX_REGIONS) {
+    VERROR("Snapshot region limit reached adding '%s'.", name);
+    return FALSE;
+  }
+
+  state->regions[state->region_count++] =
+      (snapshot_region){name, memory, size, 0};
+  layout_regions();
+  release_ring();
+  return TRUE;
+}
+
+b8 snapshot_unregister(void *memory) {
+  if (!is_initialized) {
+    return FALSE;
+  }
+
+  for (u32 i = 0; i < state->region_count; ++i) {
+    if (state->regions[i].memory == memory) {
+      state->regions[i] = state->regions[--state->region_count];
+      layout_regions();
+      release_ring();
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+b8 snapshot_capture(u64 frame) {
+  if (!is_initialized || state->capacity == 0 || state->region_count == 0) {
+    return FALSE;
+  }
+
+  if (!state->ring) {
+    state->ring_size = state->stride * state->capacity;
+    state->ring = vallocate_aligned(state->ring_size, MEMORY_TAG_SNAPSHOT);
+    if (!state->ring) {
+      VERROR("Failed to allocate %llu bytes of snapshots.", state->ring_size);
+      state->ring_size = 0;
+      return FALSE;
+    }
+    VDEBUG("Snapshot ring: %u snapshots of %llu bytes in %u regions.",
+           state->capacity, state->stride, state->region_count);
+  }
+
+  u8 *snapshot = state->ring + state->stride * state->head;
+  for (u32 i = 0; i < state->region_count; ++i) {
+    snapshot_region *region = &state->regions[i];
+    vcopy_memory(snapshot + region->offset, region->memory, region->size);
+  }
+
+  state->frames[state->head] = frame;
+  state->head = (state->head + 1) % state->capacity;
+  if (state->count < state->capacity) {
+    state->count++;
+  }
+
+  return TRUE;
+}
+
+b8 snapshot_restore(u32 age, u64 *out_frame) {
+  if (!is_initialized || age >= state->count) {
+    return FALSE;
+  }
+
+  u32 slot = (state->head + state->capacity - 1 - age) % state->capacity;
+  u8 *snapshot = state->ring + state->stride * slot;
+  for (u32 i = 0; i < state->region_count; ++i) {
+    snapshot_region *region = &state->regions[i];
+    vcopy_memory(region->memory, snapshot + region->offset, region->size);
+  }
+
+  // The restored snapshot becomes the latest; the ones after it describe a
+  // future that no longer happens.
+  state->head = (slot + 1) % state->capacity;
+  state->count -= age;
+
+  if (out_frame) {
+    *out_frame = state->frames[slot];
+  }
+  return TRUE;
+}
+
+u32 snapshot_count() { return is_initialized ? state->count : 0; }
+
+void snapshot_request_rewind(u32 age) {
+  if (!is_initialized) {
+    return;
+  }
+
+  vatomic_store_u32(&state->pending_rewind, age + 1, VMEMORY_ORDER_RELEASE);
+}
+
+void snapshot_frame(u64 frame) {
+  if (!is_initialized) {
+    return;
+  }
+
+  u32 pending =
+      vatomic_exchange_u32(&state->pending_rewind, 0, VMEMORY_ORDER_ACQUIRE);
+  if (pending) {
+    u64 restored_frame = 0;
+    if (snapshot_restore(pending - 1, &restored_frame)) {
+      VINFO("Rewound from frame %llu to frame %llu.", frame, restored_frame);
+      // The latest snapshot already holds this state.
+      return;
+    } else {
+      VWARN("Cannot rewind %u frames, only %u snapshots are held.",
+            pending - 1, state->count);
+    }
+  }
+
+  snapshot_capture(frame);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <defines.h>
+
+/**
+ * Whole-state snapshots for rollback and quick save/restore. Memory regions
+ * holding plain state (no pointers to memory outside the snapshot, no thread
+ * or OS handles) are registered once; every frame the engine copies all of
+ * them into the next slot of a preallocated ring, overwriting the oldest.
+ * Restoring copies a slot back over the regions, so both cost about one
+ * memcpy of the registered state.
+ *
+ * The engine registers the game state and the input state. Games register
+ * anything else they keep, such as the memory of an arena their data lives
+ * in.
+ */
+
+#define SNAPSHOT_MAX_REGIONS 32
+
+/**
+ * Initializes the snapshot system in two passes, like events_init.
+ *
+ * @param memory_requirement Receives the size of the state in bytes.
+ * @param state Memory for the state, which must stay valid until after
+ * snapshot_system_shutdown. NULL to only query the size.
+ * @param capacity Number of snapshots kept. 0 disables capturing.
+ * @return TRUE on success or after a size query, FALSE otherwise.
+ */
+b8 snapshot_system_init(u64 *memory_requirement, void *state, u32 capacity);
+void snapshot_system_shutdown();
+
+/**
+ * Adds a memory region to every snapshot from the next capture on. Snapshots
+ * taken so far are discarded, since they do not cover the new region.
+ *
+ * @param name Identifies the region in logs. Must outlive the registration.
+ * @param memory The region. Must stay valid until unregistered.
+ * @param size The size of the region in bytes.
+ * @return TRUE if the region was added, FALSE if it already was or the limit
+ * was reached.
+ */
+VAPI b8 snapshot_register(const char *name, void *memory, u64 size);
+
+// Removes a region, discarding the snapshots taken so far.
+VAPI b8 snapshot_unregister(void *memory);
+
+/**
+ * Copies every region into the ring. Must not run while anything modifies
+ * the regions.
+ *
+ * @param frame Frame number stored with the snapshot.
+ * @return TRUE if a snapshot was taken.
+ */
+VAPI b8 snapshot_capture(u64 frame);
+
+/**
+ * Copies a snapshot back over the regions and discards every snapshot taken
+ * after it. Must not run while anything reads or modifies the regions; from
+ * game code use snapshot_request_rewind instead.
+ *
+ * @param age Which snapshot: 0 is the latest, 1 the one before and so on.
+ * @param out_frame Receives the frame number of the snapshot. Can be NULL.
+ * @return TRUE if the snapshot existed and was restored.
+ */
+VAPI b8 snapshot_restore(u32 age, u64 *out_frame);
+
+// Number of snapshots currently held.
+VAPI u32 snapshot_count();
+
+// Restores the given snapshot, as snapshot_restore, at the next frame start.
+VAPI void snapshot_request_rewind(u32 age);
+
+/**
+ * Called by the application at the start of every frame, before anything
+ * runs: applies a requested rewind, then captures the frame.
+ */
+void snapshot_frame(u64 frame);
@@ -0,0 +1,289 @@
+#include <core/task_graph.h>
+
+#include <core/job.h>
+#include <core/logger.h>
+#include <core/vmemory.h>
+#include <core/vstring.h>
+#include <platform/atomic.h>
+
+STATIC_ASSERT(TASK_GRAPH_MAX_TASKS <= 64, task_graph_tasks_fit_ready_mask);
+STATIC_ASSERT(TASK_GRAPH_MAX_RESOURCES <= 64,
+              task_graph_resources_fit_access_mask);
+
+typedef struct task_node {
+  task_desc desc;
+  // Bit i set if the task reads or writes resource i.
+  u64 read_mask;
+  u64 write_mask;
+  u32 predecessor_count;
+  u32 successor_count;
+  u8 successors[TASK_GRAPH_MAX_TASKS];
+  // Predecessors that have not finished yet this frame.
+  atomic_u32 remaining;
+} task_node;
+
+typedef struct task_graph_state {
+  // In registration order, which decides the order of conflicting tasks.
+  task_node tasks[TASK_GRAPH_MAX_TASKS];
+  u32 task_count;
+  const char *resources[TASK_GRAPH_MAX_RESOURCES];
+  u32 resource_count;
+  // Set when tasks change, so edges are rebuilt before the next frame.
+  b8 is_dirty;
+
+  f64 delta_time;
+  atomic_u32 unfinished_count;
+  // Main thread only tasks whose predecessors have all finished.
+  atomic_u64 main_thread_ready;
+  atomic_b8 has_failed;
+} task_graph_state;
+
+static b8 is_initialized = FALSE;
+static task_graph_state *state;
+
+b8 task_graph_init(u64 *memory_requirement, void *memory) {
+  *memory_requirement = sizeof(task_graph_state);
+  if (!memory) {
+    return TRUE;
+  }
+
+  if (is_initialized) {
+    return FALSE;
+  }
+
+  state = memory;
+  vzero_memory(state, sizeof(task_graph_state));
+
+  is_initialized = TRUE;
+  return TRUE;
+}
+
+void task_graph_shutdown() {
+  if (!is_initialized) {
+    return;
+  }
+
+  for (u32 i = 0; i < state->resource_count; ++i) {
+    vfree((char *)state->resources[i], vstrlen(state->resources[i]) + 1,
+          MEMORY_TAG_STRING);
+  }
+
+  state = NULL;
+  is_initialized = FALSE;
+}
+
+// Maps resource names to mask bits, adding names not seen before.
+static b8 resource_mask(const char *const *names, u64 *out_mask) {
+  *out_mask = 0;
+
+  for (u32 i = 0; i < TASK_MAX_ACCESSES && names[i]; ++i) {
+    u32 index = 0;
+    while (index < state->resource_count &&
+           !strings_equal(state->resources[index], names[i])) {
+      index++;
+    }
+
+    if (index == state->resource_count) {
+      if (state->resource_count == TASK_GRAPH_MAX_RESOURCES) {
+        VERROR("Task graph resource limit reached adding '%s'.", names[i]);
+        return FALSE;
+      }
+      state->resources[state->resource_count++] = vstrdup(names[i]);
+    }
+
+    *out_mask |= 1ULL << index;
+  }
+
+  return TRUE;
+}
+
+static i32 find_task(const char *name) {
+  for (u32 i = 0; i < state->task_count; ++i) {
+    if (strings_equal(state->tasks[i].desc.name, name)) {
+      return (i32)i;
+    }
+  }
+
+  return -1;
+}
+
+b8 task_graph_add(const task_desc *desc) {
+  if (!is_initialized || !desc->name || !desc->run) {
+    return FALSE;
+  }
+
+  if (find_task(desc->name) >= 0) {
+    VERROR("A task named '%s' already exists.", desc->name);
+    return FALSE;
+  }
+
+  if (state->task_count == TASK_GRAPH_MAX_TASKS) {
+    VERROR("Task graph is full, cannot add '%s'.", desc->name);
+    return FALSE;
+  }
+
+  task_node *node = &state->tasks[state->task_count];
+  vzero_memory(node, sizeof(task_node));
+  node->desc = *desc;
+  if (!resource_mask(desc->reads, &node->read_mask) ||
+      !resource_mask(desc->writes, &node->write_mask)) {
+    return FALSE;
+  }
+
+  state->task_count++;
+  state->is_dirty = TRUE;
+  return TRUE;
+}
+
+b8 task_graph_remove(const char *name) {
+  if (!is_initialized) {
+    return FALSE;
+  }
+
+  i32 index = find_task(name);
+  if (index < 0) {
+    return FALSE;
+  }
+
+  // Shift down rather than swap, to keep the registration order.
+  state->task_count--;
+  for (u32 i = (u32)index; i < state->task_count; ++i) {
+    state->tasks[i].desc = state->tasks[i + 1].desc;
+    state->tasks[i].read_mask = state->tasks[i + 1].read_mask;
+    state->tasks[i].write_mask = state->tasks[i + 1].write_mask;
+  }
+
+  state->is_dirty = TRUE;
+  return TRUE;
+}
+
+/**
+ * Derives the edges: a task depends on every earlier task it conflicts with,
+ * that is, where either one writes a resource the other reads or writes.
+ */
+static void rebuild() {
+  u32 depth[TASK_GRAPH_MAX_TASKS];
+  u32 max_depth = 0;
+  u32 edge_count = 0;
+
+  for (u32 i = 0; i < state->task_count; ++i) {
+    state->tasks[i].predecessor_count = 0;
+    state->tasks[i].successor_count = 0;
+  }
+
+  for (u32 i = 0; i < state->task_count; ++i) {
+    task_node *task = &state->tasks[i];
+    depth[i] = 1;
+
+    for (u32 j = 0; j < i; ++j) {
+      task_node *earlier = &state->tasks[j];
+      b8 conflicts =
+          (task->write_mask & (earlier->read_mask | earlier->write_mask)) ||
+          (task->read_mask & earlier->write_mask);
+      if (!conflicts) {
+        continue;
+      }
+
+      earlier->successors[earlier->successor_count++] = (u8)i;
+      task->predecessor_count++;
+      edge_count++;
+      if (depth[j] + 1 > depth[i]) {
+        depth[i] = depth[j] + 1;
+      }
+    }
+
+    if (depth[i] > max_depth) {
+      max_depth = depth[i];
+    }
+  }
+
+  VDEBUG("Task graph rebuilt: %u tasks, %u dependencies, %u levels deep.",
+         state->task_count, edge_count, max_depth);
+  state->is_dirty = FALSE;
+}
+
+static void run_task(u32 index);
+
+static void task_job(void *params) { run_task((u32)(u64)params); }
+
+// Hands a task whose predecessors have all finished to whoever runs it.
+static void dispatch(u32 index) {
+  if (state->tasks[index].desc.main_thread_only) {
+    vatomic_fetch_or_u64(&state->main_thread_ready, 1ULL << index,
+                         VMEMORY_ORDER_RELEASE);
+    return;
+  }
+
+  job_desc job = {task_job, (void *)(u64)index, JOB_PRIORITY_HIGH};
+  job_submit(&job, NULL);
+}
+
+static void run_task(u32 index) {
+  task_node *task = &state->tasks[index];
+
+  if (!vatomic_load_b8(&state->has_failed, VMEMORY_ORDER_ACQUIRE)) {
+    if (!task->desc.run(task->desc.params, state->delta_time)) {
+      VERROR("Task '%s' failed.", task->desc.name);
+      vatomic_store_b8(&state->has_failed, TRUE, VMEMORY_ORDER_RELEASE);
+    }
+  }
+
+  for (u32 i = 0; i < task->successor_count; ++i) {
+    u32 successor = task->successors[i];
+    if (vatomic_fetch_sub_u32(&state->tasks[successor].remaining, 1,
+                              VMEMORY_ORDER_ACQ_REL) == 1) {
+      dispatch(successor);
+    }
+  }
+
+  vatomic_fetch_sub_u32(&state->unfinished_count, 1, VMEMORY_ORDER_RELEASE);
+}
+
+b8 task_graph_execute(f64 delta_time) {
+  if (!is_initialized) {
+    return FALSE;
+  }
+
+  if (state->is_dirty) {
+    rebuild();
+  }
+
+  if (state->task_count == 0) {
+    return TRUE;
+  }
+
+  state->delta_time = delta_time;
+  vatomic_store_b8(&state->has_failed, FALSE, VMEMORY_ORDER_RELAXED);
+  vatomic_store_u64(&state->main_thread_ready, 0, VMEMORY_ORDER_RELAXED);
+  vatomic_store_u32(&state->unfinished_count, state->task_count,
+                    VMEMORY_ORDER_RELAXED);
+  for (u32 i = 0; i < state->task_count; ++i) {
+    vatomic_store_u32(&state->tasks[i].remaining,
+                      state->tasks[i].predecessor_count,
+                      VMEMORY_ORDER_RELAXED);
+  }
+
+  for (u32 i = 0; i < state->task_count; ++i) {
+    if (state->tasks[i].predecessor_count == 0) {
+      dispatch(i);
+    }
+  }
+
+  // Run main thread tasks as they become ready, and help with the others
+  // in between.
+  while (vatomic_load_u32(&state->unfinished_count, VMEMORY_ORDER_ACQUIRE)) {
+    u64 ready = vatomic_exchange_u64(&state->main_thread_ready, 0,
+                                     VMEMORY_ORDER_ACQUIRE);
+    if (ready) {
+      for (u32 i = 0; i < state->task_count; ++i) {
+        if (ready & (1ULL << i)) {
+          run_task(i);
+        }
+      }
+    } else if (!job_try_run()) {
+      vatomic_pause();
+    }
+  }
+
+  return !vatomic_load_b8(&state->has_failed, VMEMORY_ORDER_ACQUIRE);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <defines.h>
+
+/**
+ * Per-frame task graph. Subsystems and the game register named tasks that
+ * declare which resources they read and write. Each frame the graph runs every
+ * task once on the job system, in parallel wherever their accesses do not
+ * conflict, so frame time approaches the critical path rather than the sum of
+ * all tasks.
+ *
+ * Resources are just names, such as "game_state" or "input". Between two
+ * tasks that touch the same resource and at least one writes it, the task
+ * registered first runs first. Tasks with no such conflict may run in any
+ * order or concurrently.
+ */
+
+#define TASK_GRAPH_MAX_TASKS 64
+#define TASK_GRAPH_MAX_RESOURCES 64
+#define TASK_MAX_ACCESSES 8
+
+// Resources accessed by the engine's own tasks, which run in this order:
+//   game_update:  reads input, writes game_state
+//   game_render:  reads input and game_state, writes render
+//   input_update: writes input
+#define TASK_RESOURCE_INPUT "input"
+#define TASK_RESOURCE_GAME_STATE "game_state"
+#define TASK_RESOURCE_RENDER "render"
+
+// Runs the task for the current frame. Returning FALSE fails the frame.
+typedef b8 (*pfn_task_run)(void *params, f64 delta_time);
+
+typedef struct task_desc {
+  // Unique name of the task. The string must outlive the registration.
+  const char *name;
+  pfn_task_run run;
+  // Passed to run. Can be NULL.
+  void *params;
+  // Names of the resources the task reads and writes.
+  const char *reads[TASK_MAX_ACCESSES];
+  const char *writes[TASK_MAX_ACCESSES];
+  // Run on the thread that executes the graph, for work that is not thread
+  // safe, such as talking to the window system.
+  b8 main_thread_only;
+} task_desc;
+
+/**
+ * Initializes the task graph in two passes, like events_init.
+ *
+ * @param memory_requirement Receives the size of the state in bytes.
+ * @param state Memory for the state, which must stay valid until after
+ * task_graph_shutdown. NULL to only query the size.
+ * @return TRUE on success or after a size query, FALSE otherwise.
+ */
+b8 task_graph_init(u64 *memory_requirement, void *state);
+void task_graph_shutdown();
+
+/**
+ * Adds a task to the per-frame graph. The change takes effect on the next
+ * task_graph_execute.
+ *
+ * @param desc The task. Unused access entries must be NULL.
+ * @return TRUE if the task was added, FALSE if the name is taken or a limit
+ * was reached.
+ */
+VAPI b8 task_graph_add(const task_desc *desc);
+
+// Removes the task with the given name. Returns FALSE if there is none.
+VAPI b8 task_graph_remove(const char *name);
+
+/**
+ * Runs every task once, respecting their dependencies, and returns when all
+ * have finished. Must be called from the main thread.
+ *
+ * @param delta_time Passed to every task.
+ * @return TRUE if every task succeeded. After a failure, tasks that have not
+ * started yet are skipped.
+ */
+b8 task_graph_execute(f64 delta_time);
@@ -2,13 +2,15 @@
 
 #include <core/logger.h>
 #include <core/vstring.h>
+#include <platform/atomic.h>
 #include <platform/platform.h>
 
 #include <stdio.h>
 
+// Atomic since jobs allocate from worker threads.
 typedef struct memory_stats {
-  u64 total_allocated;
-  u64 tagged_allocations[MEMORY_TAG_MAX_COUNT];
+  atomic_u64 total_allocated;
+  atomic_u64 tagged_allocations[MEMORY_TAG_MAX_COUNT];
 } memory_stats;
 
 static memory_stats stats;
@@ -18,39 +20,57 @@ static const char *memory_tag_strings[MEMORY_TAG_MAX_COUNT] = {
     "RING_QUEUE  ", "BST         ", "STRING      ", "APPLICATION ",
     "JOB         ", "TEXTURE     ", "MAT_INST    ", "RENDERER    ",
     "GAME        ", "TRANSFORM   ", "ENTITY      ", "ENTITY_NODE ",
-    "SCENE       ",
+    "SCENE       ", "LINEAR_ALLOC", "SNAPSHOT    ", "FILE        ",
 };
 
 void memory_init() { platform_zero_memory(&stats, sizeof(stats)); }
 
 void memory_shutdown() {}
 
-void *vallocate(u64 size, memory_tag tag) {
+static void *allocate(u64 size, memory_tag tag, b8 aligned) {
   if (tag == MEMORY_TAG_UNKNOWN) {
-    VWARN("vallocate called with MEMORY_TAG_UNKNOWN. Re-classify this "
-          "allocation.");
+    VWARN_CAT(LOG_CATEGORY_MEMORY,
+              "vallocate called with MEMORY_TAG_UNKNOWN. Re-classify this "
+              "allocation.");
   }
 
-  stats.total_allocated += size;
-  stats.tagged_allocations[tag] += size;
+  vatomic_fetch_add_u64(&stats.total_allocated, size, VMEMORY_ORDER_RELAXED);
+  vatomic_fetch_add_u64(&stats.tagged_allocations[tag], size,
+                        VMEMORY_ORDER_RELAXED);
 
-  // TODO: Memory alignment.
-  void *block = platform_allocate(size, FALSE);
+  void *block = platform_allocate(size, aligned);
   platform_zero_memory(block, size);
 
   return block;
 }
 
-void vfree(void *block, u64 size, memory_tag tag) {
+static void free_block(void *block, u64 size, memory_tag tag, b8 aligned) {
   if (tag == MEMORY_TAG_UNKNOWN) {
-    VWARN("vfree called with MEMORY_TAG_UNKNOWN. Re-classify this allocation.");
+    VWARN_CAT(LOG_CATEGORY_MEMORY, "vfree called with MEMORY_TAG_UNKNOWN. "
+                                   "Re-classify this allocation.");
   }
 
-  stats.total_allocated -= size;
-  stats.tagged_allocations[tag] -= size;
+  vatomic_fetch_sub_u64(&stats.total_allocated, size, VMEMORY_ORDER_RELAXED);
+  vatomic_fetch_sub_u64(&stats.tagged_allocations[tag], size,
+                        VMEMORY_ORDER_RELAXED);
+
+  platform_free(block, aligned);
+}
+
+void *vallocate(u64 size, memory_tag tag) {
+  return allocate(size, tag, FALSE);
+}
+
+void vfree(void *block, u64 size, memory_tag tag) {
+  free_block(block, size, tag, FALSE);
+}
+
+void *vallocate_aligned(u64 size, memory_tag tag) {
+  return allocate(size, tag, TRUE);
+}
 
-  // TODO: Memory alignment.
-  platform_free(block, FALSE);
+void vfree_aligned(void *block, u64 size, memory_tag tag) {
+  free_block(block, size, tag, TRUE);
 }
 
 void *vzero_memory(void *block, u64 size) {
@@ -76,18 +96,20 @@ char *get_memory_usage_string() {
   for (u32 i = 0; i < MEMORY_TAG_MAX_COUNT; ++i) {
     char unit[4] = "xiB";
     float amount = 1.0f;
+    u64 allocated =
+        vatomic_load_u64(&stats.tagged_allocations[i], VMEMORY_ORDER_RELAXED);
 
-    if (stats.tagged_allocations[i] >= gib) {
-      amount = (float)stats.tagged_allocations[i] / (float)gib;
+    if (allocated >= gib) {
+      amount = (float)allocated / (float)gib;
       unit[0] = 'G';
-    } else if (stats.tagged_allocations[i] >= mib) {
-      amount = (float)stats.tagged_allocations[i] / (float)mib;
+    } else if (allocated >= mib) {
+      amount = (float)allocated / (float)mib;
       unit[0] = 'M';
-    } else if (stats.tagged_allocations[i] >= kib) {
-      amount = (float)stats.tagged_allocations[i] / (float)kib;
+    } else if (allocated >= kib) {
+      amount = (float)allocated / (float)kib;
       unit[0] = 'K';
     } else {
-      amount = (float)stats.tagged_allocations[i];
+      amount = (float)allocated;
       unit[0] = 'B';
       unit[1] = '\0';
     }
@@ -21,6 +21,9 @@ typedef enum memory_tag {
   MEMORY_TAG_ENTITY,
   MEMORY_TAG_ENTITIY_NODE,
   MEMORY_TAG_SCENE,
+  MEMORY_TAG_LINEAR_ALLOCATOR,
+  MEMORY_TAG_SNAPSHOT,
+  MEMORY_TAG_FILE,
 
   MEMORY_TAG_MAX_COUNT
 } memory_tag;
@@ -35,6 +38,12 @@ VAPI void *vallocate(u64 size, memory_tag tag);
 // Frees the memory block with the given tag.
 VAPI void vfree(void *block, u64 size, memory_tag tag);
 
+// Allocates memory of the given size and tag, starting on a cache line.
+VAPI void *vallocate_aligned(u64 size, memory_tag tag);
+
+// Frees a memory block from vallocate_aligned with the given tag.
+VAPI void vfree_aligned(void *block, u64 size, memory_tag tag);
+
 // Sets the memory block to zero.
 VAPI void *vzero_memory(void *block, u64 size);
 
@@ -13,3 +13,7 @@ char *vstrdup(const char *str) {
 }
 
 u64 vstrlen(const char *str) { return strlen(str); }
+
+b8 strings_equal(const char *str0, const char *str1) {
+  return strcmp(str0, str1) == 0;
+}
@@ -4,3 +4,6 @@
 
 VAPI char *vstrdup(const char *str);
 VAPI u64 vstrlen(const char *str);
+
+// Case-sensitive string comparison. TRUE if the same, otherwise FALSE.
+VAPI b8 strings_equal(const char *str0, const char *str1);
@@ -34,6 +34,10 @@ typedef int b32;
 #define TRUE 1
 #define FALSE 0
 
+// Rounds value up to a multiple of alignment, which must be a power of two.
+#define VALIGN_UP(value, alignment)                                            \
+  (((value) + ((alignment) - 1)) & ~((u64)(alignment) - 1))
+
 // platform detection
 #if defined(WIN32) || defined(_WIN32) || defined(__WIN32__)
 #define VPLATFORM_WINDOWS 1
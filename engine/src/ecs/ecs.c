@@ -0,0 +1,511 @@
+#include <ecs/ecs.h>
+
+#include <core/job.h>
+#include <core/logger.h>
+#include <core/vmemory.h>
+
+#define ECS_INITIAL_CAPACITY 64
+
+typedef struct ecs_archetype {
+  u64 mask;
+  // The components in ascending order.
+  ecs_component components[ECS_MAX_COMPONENTS];
+  u32 component_count;
+
+  // Entities per chunk.
+  u32 chunk_capacity;
+  // Where each component's array starts within a chunk. The entity ids come
+  // first, at offset 0.
+  u32 column_offsets[ECS_MAX_COMPONENTS];
+
+  u8 **chunks;
+  u32 chunk_count;
+  u32 chunk_array_capacity;
+  // Row r lives in chunk r / chunk_capacity, slot r % chunk_capacity.
+  u32 entity_count;
+} ecs_archetype;
+
+typedef struct parallel_query {
+  const ecs_chunk_view *views;
+  pfn_ecs_chunk_callback callback;
+  void *params;
+} parallel_query;
+
+// Moves an array into a larger allocation.
+static void grow(void **array, u64 stride, u32 old_capacity,
+                 u32 new_capacity) {
+  void *grown = vallocate(stride * new_capacity, MEMORY_TAG_ENTITY);
+  if (*array) {
+    vcopy_memory(grown, *array, stride * old_capacity);
+    vfree(*array, stride * old_capacity, MEMORY_TAG_ENTITY);
+  }
+  *array = grown;
+}
+
+static inline u32 entity_index(ecs_entity entity) { return (u32)entity; }
+
+static inline u32 entity_generation(ecs_entity entity) {
+  return (u32)(entity >> 32);
+}
+
+static inline ecs_entity make_entity(u32 index, u32 generation) {
+  return ((u64)generation << 32) | index;
+}
+
+static inline u8 *chunk_of(const ecs_archetype *archetype, u32 row) {
+  return archetype->chunks[row / archetype->chunk_capacity];
+}
+
+static inline u8 *column_slot(const ecs_world *world,
+                              const ecs_archetype *archetype, u32 row,
+                              ecs_component component) {
+  return chunk_of(archetype, row) + archetype->column_offsets[component] +
+         (u64)(row % archetype->chunk_capacity) *
+             world->components[component].size;
+}
+
+void ecs_world_create(ecs_world *out_world) {
+  vzero_memory(out_world, sizeof(ecs_world));
+}
+
+void ecs_world_destroy(ecs_world *world) {
+  for (u32 i = 0; i < world->archetype_count; ++i) {
+    ecs_archetype *archetype = world->archetypes[i];
+    for (u32 c = 0; c < archetype->chunk_count; ++c) {
+      vfree_aligned(archetype->chunks[c], ECS_CHUNK_SIZE, MEMORY_TAG_ENTITY);
+    }
+    if (archetype->chunks) {
+      vfree(archetype->chunks, sizeof(u8 *) * archetype->chunk_array_capacity,
+            MEMORY_TAG_ENTITY);
+    }
+    vfree(archetype, sizeof(ecs_archetype), MEMORY_TAG_ENTITY);
+  }
+
+  if (world->archetypes) {
+    vfree(world->archetypes,
+          sizeof(ecs_archetype *) * world->archetype_capacity,
+          MEMORY_TAG_ENTITY);
+  }
+  if (world->records) {
+    vfree(world->records, sizeof(ecs_entity_record) * world->record_capacity,
+          MEMORY_TAG_ENTITY);
+    vfree(world->free_indices, sizeof(u32) * world->record_capacity,
+          MEMORY_TAG_ENTITY);
+  }
+  if (world->views) {
+    vfree(world->views, sizeof(ecs_chunk_view) * world->view_capacity,
+          MEMORY_TAG_ENTITY);
+  }
+
+  vzero_memory(world, sizeof(ecs_world));
+}
+
+/**
+ * Lays out a chunk for chunk_capacity entities: the entity ids, then each
+ * component's array on a cache line.
+ *
+ * @return The bytes used.
+ */
+static u64 layout_columns(const ecs_world *world, ecs_archetype *archetype) {
+  u64 offset = sizeof(ecs_entity) * (u64)archetype->chunk_capacity;
+  for (u32 i = 0; i < archetype->component_count; ++i) {
+    ecs_component component = archetype->components[i];
+    offset = VALIGN_UP(offset, ECS_COLUMN_ALIGNMENT);
+    archetype->column_offsets[component] = (u32)offset;
+    offset += (u64)world->components[component].size *
+              archetype->chunk_capacity;
+  }
+  return offset;
+}
+
+ecs_component ecs_component_register(ecs_world *world, const char *name,
+                                     u32 size, u32 alignment) {
+  if (world->component_count == ECS_MAX_COMPONENTS) {
+    VERROR("Cannot register component '%s': limit of %u reached.", name,
+           ECS_MAX_COMPONENTS);
+    return ECS_COMPONENT_INVALID;
+  }
+
+  if (alignment > ECS_COLUMN_ALIGNMENT ||
+      sizeof(ecs_entity) + size + ECS_COLUMN_ALIGNMENT > ECS_CHUNK_SIZE) {
+    VERROR("Component '%s' does not fit a chunk.", name);
+    return ECS_COMPONENT_INVALID;
+  }
+
+  ecs_component component = world->component_count++;
+  world->components[component].name = name;
+  world->components[component].size = size;
+  world->components[component].alignment = alignment;
+  return component;
+}
+
+static ecs_archetype *find_archetype(ecs_world *world, u64 mask) {
+  for (u32 i = 0; i < world->archetype_count; ++i) {
+    if (world->archetypes[i]->mask == mask) {
+      return world->archetypes[i];
+    }
+  }
+
+  // Only registered components.
+  if (world->component_count < ECS_MAX_COMPONENTS &&
+      (mask >> world->component_count)) {
+    VERROR("Unknown component in mask 0x%llx.", mask);
+    return NULL;
+  }
+
+  ecs_archetype *archetype =
+      vallocate(sizeof(ecs_archetype), MEMORY_TAG_ENTITY);
+  archetype->mask = mask;
+  u64 entity_size = sizeof(ecs_entity);
+  for (u32 c = 0; c < world->component_count; ++c) {
+    if (mask & ECS_MASK(c)) {
+      archetype->components[archetype->component_count++] = c;
+      entity_size += world->components[c].size;
+    }
+  }
+
+  // Start from the unpadded fit and back off until the padding fits too.
+  archetype->chunk_capacity = (u32)(ECS_CHUNK_SIZE / entity_size);
+  while (layout_columns(world, archetype) > ECS_CHUNK_SIZE) {
+    archetype->chunk_capacity--;
+  }
+
+  if (archetype->chunk_capacity == 0) {
+    VERROR("Components of mask 0x%llx do not fit a chunk together.", mask);
+    vfree(archetype, sizeof(ecs_archetype), MEMORY_TAG_ENTITY);
+    return NULL;
+  }
+
+  if (world->archetype_count == world->archetype_capacity) {
+    u32 capacity = world->archetype_capacity ? world->archetype_capacity * 2
+                                             : ECS_INITIAL_CAPACITY;
+    grow((void **)&world->archetypes, sizeof(ecs_archetype *),
+         world->archetype_capacity, capacity);
+    world->archetype_capacity = capacity;
+  }
+  world->archetypes[world->archetype_count++] = archetype;
+
+  VDEBUG("Created archetype 0x%llx: %u components, %u entities per chunk.",
+         mask, archetype->component_count, archetype->chunk_capacity);
+  return archetype;
+}
+
+// Appends an entity with zeroed components and returns its row.
+static u32 archetype_push(const ecs_world *world, ecs_archetype *archetype,
+                          ecs_entity entity) {
+  u32 row = archetype->entity_count;
+  if (row == archetype->chunk_count * archetype->chunk_capacity) {
+    if (archetype->chunk_count == archetype->chunk_array_capacity) {
+      u32 capacity = archetype->chunk_array_capacity
+                         ? archetype->chunk_array_capacity * 2
+                         : ECS_INITIAL_CAPACITY;
+      grow((void **)&archetype->chunks, sizeof(u8 *),
+           archetype->chunk_array_capacity, capacity);
+      archetype->chunk_array_capacity = capacity;
+    }
+    archetype->chunks[archetype->chunk_count++] =
+        vallocate_aligned(ECS_CHUNK_SIZE, MEMORY_TAG_ENTITY);
+  }
+
+  u8 *chunk = chunk_of(archetype, row);
+  ((ecs_entity *)chunk)[row % archetype->chunk_capacity] = entity;
+
+  // The slot may hold the data of an entity removed earlier.
+  for (u32 i = 0; i < archetype->component_count; ++i) {
+    ecs_component component = archetype->components[i];
+    vzero_memory(column_slot(world, archetype, row, component),
+                 world->components[component].size);
+  }
+
+  archetype->entity_count++;
+  return row;
+}
+
+// Removes a row by moving the last entity into it.
+static void archetype_remove(ecs_world *world, ecs_archetype *archetype,
+                             u32 row) {
+  u32 last = archetype->entity_count - 1;
+  if (row != last) {
+    ecs_entity *last_ids = (ecs_entity *)chunk_of(archetype, last);
+    ecs_entity *row_ids = (ecs_entity *)chunk_of(archetype, row);
+    ecs_entity moved = last_ids[last % archetype->chunk_capacity];
+    row_ids[row % archetype->chunk_capacity] = moved;
+
+    for (u32 i = 0; i < archetype->component_count; ++i) {
+      ecs_component component = archetype->components[i];
+      vcopy_memory(column_slot(world, archetype, row, component),
+                   column_slot(world, archetype, last, component),
+                   world->components[component].size);
+    }
+    world->records[entity_index(moved)].row = row;
+  }
+  archetype->entity_count--;
+
+  // Keep at most one empty chunk, so an entity moving back and forth at a
+  // chunk boundary does not allocate every time.
+  while (archetype->chunk_count >= 2 &&
+         archetype->entity_count <=
+             (archetype->chunk_count - 2) * archetype->chunk_capacity) {
+    vfree_aligned(archetype->chunks[--archetype->chunk_count], ECS_CHUNK_SIZE,
+                  MEMORY_TAG_ENTITY);
+  }
+}
+
+static ecs_entity allocate_entity(ecs_world *world) {
+  u32 index;
+  if (world->free_count) {
+    index = world->free_indices[--world->free_count];
+  } else {
+    if (world->record_count == world->record_capacity) {
+      u32 capacity = world->record_capacity ? world->record_capacity * 2
+                                            : ECS_INITIAL_CAPACITY;
+      grow((void **)&world->records, sizeof(ecs_entity_record),
+           world->record_capacity, capacity);
+      grow((void **)&world->free_indices, sizeof(u32), world->record_capacity,
+           capacity);
+      world->record_capacity = capacity;
+    }
+    index = world->record_count++;
+    world->records[index].generation = 1;
+  }
+
+  world->entity_count++;
+  return make_entity(index, world->records[index].generation);
+}
+
+ecs_entity ecs_entity_create(ecs_world *world, u64 components) {
+  ecs_archetype *archetype = find_archetype(world, components);
+  if (!archetype) {
+    return ECS_ENTITY_INVALID;
+  }
+
+  ecs_entity entity = allocate_entity(world);
+  ecs_entity_record *record = &world->records[entity_index(entity)];
+  record->archetype = archetype;
+  record->row = archetype_push(world, archetype, entity);
+  return entity;
+}
+
+b8 ecs_entity_create_batch(ecs_world *world, u64 components, u32 count,
+                           ecs_entity *out_entities) {
+  ecs_archetype *archetype = find_archetype(world, components);
+  if (!archetype) {
+    return FALSE;
+  }
+
+  for (u32 i = 0; i < count; ++i) {
+    ecs_entity entity = allocate_entity(world);
+    ecs_entity_record *record = &world->records[entity_index(entity)];
+    record->archetype = archetype;
+    record->row = archetype_push(world, archetype, entity);
+    if (out_entities) {
+      out_entities[i] = entity;
+    }
+  }
+
+  return TRUE;
+}
+
+b8 ecs_entity_is_alive(const ecs_world *world, ecs_entity entity) {
+  u32 index = entity_index(entity);
+  return index < world->record_count &&
+         world->records[index].archetype != NULL &&
+         world->records[index].generation == entity_generation(entity);
+}
+
+void ecs_entity_destroy(ecs_world *world, ecs_entity entity) {
+  if (!ecs_entity_is_alive(world, entity)) {
+    return;
+  }
+
+  u32 index = entity_index(entity);
+  ecs_entity_record *record = &world->records[index];
+  archetype_remove(world, record->archetype, record->row);
+
+  record->archetype = NULL;
+  // Generation 0 would make entity 0 valid.
+  if (++record->generation == 0) {
+    record->generation = 1;
+  }
+  world->free_indices[world->free_count++] = index;
+  world->entity_count--;
+}
+
+u64 ecs_entity_components(const ecs_world *world, ecs_entity entity) {
+  if (!ecs_entity_is_alive(world, entity)) {
+    return 0;
+  }
+
+  return world->records[entity_index(entity)].archetype->mask;
+}
+
+// Moves an entity to the archetype of mask, keeping the shared components.
+static b8 move_entity(ecs_world *world, ecs_entity entity, u64 mask) {
+  ecs_entity_record *record = &world->records[entity_index(entity)];
+  ecs_archetype *source = record->archetype;
+  ecs_archetype *destination = find_archetype(world, mask);
+  if (!destination) {
+    return FALSE;
+  }
+
+  u32 source_row = record->row;
+  u32 row = archetype_push(world, destination, entity);
+  for (u32 i = 0; i < destination->component_count; ++i) {
+    ecs_component component = destination->components[i];
+    if (source->mask & ECS_MASK(component)) {
+      vcopy_memory(column_slot(world, destination, row, component),
+                   column_slot(world, source, source_row, component),
+                   world->components[component].size);
+    }
+  }
+
+  record->archetype = destination;
+  record->row = row;
+  archetype_remove(world, source, source_row);
+  return TRUE;
+}
+
+b8 ecs_entity_add(ecs_world *world, ecs_entity entity,
+                  ecs_component component) {
+  if (!ecs_entity_is_alive(world, entity) ||
+      component >= world->component_count) {
+    return FALSE;
+  }
+
+  u64 mask = world->records[entity_index(entity)].archetype->mask;
+  if (mask & ECS_MASK(component)) {
+    return TRUE;
+  }
+
+  return move_entity(world, entity, mask | ECS_MASK(component));
+}
+
+b8 ecs_entity_remove(ecs_world *world, ecs_entity entity,
+                     ecs_component component) {
+  if (!ecs_entity_is_alive(world, entity) ||
+      component >= world->component_count) {
+    return FALSE;
+  }
+
+  u64 mask = world->records[entity_index(entity)].archetype->mask;
+  if (!(mask & ECS_MASK(component))) {
+    return TRUE;
+  }
+
+  return move_entity(world, entity, mask & ~ECS_MASK(component));
+}
+
+void *ecs_entity_get(const ecs_world *world, ecs_entity entity,
+                     ecs_component component) {
+  if (!ecs_entity_is_alive(world, entity) ||
+      component >= world->component_count) {
+    return NULL;
+  }
+
+  const ecs_entity_record *record = &world->records[entity_index(entity)];
+  if (!(record->archetype->mask & ECS_MASK(component))) {
+    return NULL;
+  }
+
+  return column_slot(world, record->archetype, record->row, component);
+}
+
+void *ecs_chunk_column(const ecs_chunk_view *chunk, ecs_component component) {
+  if (component >= ECS_MAX_COMPONENTS ||
+      !(chunk->archetype->mask & ECS_MASK(component))) {
+    return NULL;
+  }
+
+  return chunk->memory + chunk->archetype->column_offsets[component];
+}
+
+static inline b8 query_matches(const ecs_query *query, u64 mask) {
+  return (mask & query->all) == query->all && !(mask & query->none);
+}
+
+static inline ecs_chunk_view chunk_view(ecs_archetype *archetype, u32 chunk) {
+  ecs_chunk_view view;
+  view.archetype = archetype;
+  view.memory = archetype->chunks[chunk];
+  view.entities = (const ecs_entity *)view.memory;
+  // Only the last chunk is partly filled.
+  u32 start = chunk * archetype->chunk_capacity;
+  u32 remaining = archetype->entity_count - start;
+  view.count = remaining < archetype->chunk_capacity
+                   ? remaining
+                   : archetype->chunk_capacity;
+  return view;
+}
+
+// Chunks holding entities. Trailing empty chunks are kept for reuse.
+static inline u32 used_chunk_count(const ecs_archetype *archetype) {
+  return (archetype->entity_count + archetype->chunk_capacity - 1) /
+         archetype->chunk_capacity;
+}
+
+u32 ecs_query_for_each(ecs_world *world, const ecs_query *query,
+                       pfn_ecs_chunk_callback callback, void *params) {
+  u32 visited = 0;
+  for (u32 i = 0; i < world->archetype_count; ++i) {
+    ecs_archetype *archetype = world->archetypes[i];
+    if (!query_matches(query, archetype->mask)) {
+      continue;
+    }
+
+    u32 chunk_count = used_chunk_count(archetype);
+    for (u32 c = 0; c < chunk_count; ++c) {
+      ecs_chunk_view view = chunk_view(archetype, c);
+      callback(&view, params);
+    }
+    visited += archetype->entity_count;
+  }
+
+  return visited;
+}
+
+static void parallel_query_range(void *params, u32 start, u32 end) {
+  parallel_query *query = params;
+  for (u32 i = start; i < end; ++i) {
+    query->callback(&query->views[i], query->params);
+  }
+}
+
+u32 ecs_query_for_each_parallel(ecs_world *world, const ecs_query *query,
+                                pfn_ecs_chunk_callback callback, void *params,
+                                u32 min_chunks_per_job) {
+  // Gather the matching chunks, so they split evenly whatever archetype
+  // they belong to.
+  u32 view_count = 0;
+  u32 visited = 0;
+  for (u32 i = 0; i < world->archetype_count; ++i) {
+    ecs_archetype *archetype = world->archetypes[i];
+    if (!query_matches(query, archetype->mask)) {
+      continue;
+    }
+
+    u32 chunk_count = used_chunk_count(archetype);
+    if (view_count + chunk_count > world->view_capacity) {
+      u32 capacity = world->view_capacity ? world->view_capacity
+                                          : ECS_INITIAL_CAPACITY;
+      while (capacity < view_count + chunk_count) {
+        capacity *= 2;
+      }
+      grow((void **)&world->views, sizeof(ecs_chunk_view),
+           world->view_capacity, capacity);
+      world->view_capacity = capacity;
+    }
+
+    for (u32 c = 0; c < chunk_count; ++c) {
+      world->views[view_count++] = chunk_view(archetype, c);
+    }
+    visited += archetype->entity_count;
+  }
+
+  if (view_count) {
+    parallel_query context = {world->views, callback, params};
+    job_parallel_for(view_count, min_chunks_per_job ? min_chunks_per_job : 1,
+                     parallel_query_range, &context);
+  }
+
+  return visited;
+}
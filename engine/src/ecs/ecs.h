@@ -0,0 +1,201 @@
+#pragma once
+
+#include <defines.h>
+
+/**
+ * Archetype based entity component system. Entities with the same set of
+ * components share an archetype, which stores them in fixed size chunks.
+ * Within a chunk each component has its own contiguous array (structure of
+ * arrays), so a query that reads one component streams through exactly
+ * that memory. All chunks of an archetype but the last are full.
+ *
+ * Components are plain data identified by a small id, and a set of them is
+ * a bit mask. Adding or removing a component moves the entity to another
+ * archetype, which copies its data; batch structural changes where possible.
+ *
+ * Structural changes (creating or destroying entities, adding or removing
+ * components) must not happen while a query runs, and invalidate pointers
+ * returned by ecs_entity_get.
+ */
+
+/**
+ * Every archetype must fit at least one entity in a chunk: its entity id and
+ * components, each component's column padded to ECS_COLUMN_ALIGNMENT. Masks
+ * whose components are too large together are rejected.
+ */
+#define ECS_CHUNK_SIZE (16 * 1024)
+
+// Component ids are bits of a u64 mask.
+#define ECS_MAX_COMPONENTS 64
+
+// Columns start on a cache line. Components cannot be aligned more strictly.
+#define ECS_COLUMN_ALIGNMENT 64
+
+#define ECS_COMPONENT_INVALID 0xFFFFFFFFu
+
+#define ECS_ENTITY_INVALID 0ull
+
+// The mask of a single component.
+#define ECS_MASK(component) (1ull << (component))
+
+// Registers a struct type as a component named after the type.
+#define ECS_COMPONENT(world, type)                                             \
+  ecs_component_register(world, #type, sizeof(type), _Alignof(type))
+
+typedef u32 ecs_component;
+
+// Index in the low 32 bits, generation in the high 32. Never 0.
+typedef u64 ecs_entity;
+
+typedef struct ecs_component_info {
+  const char *name;
+  u32 size;
+  u32 alignment;
+} ecs_component_info;
+
+// Where an entity's components live.
+typedef struct ecs_entity_record {
+  struct ecs_archetype *archetype;
+  u32 row;
+  // Bumped when the index is freed, so stale entity ids can be detected.
+  u32 generation;
+} ecs_entity_record;
+
+typedef struct ecs_world {
+  ecs_component_info components[ECS_MAX_COMPONENTS];
+  u32 component_count;
+
+  struct ecs_archetype **archetypes;
+  u32 archetype_count;
+  u32 archetype_capacity;
+
+  // Indexed by the entity's index.
+  ecs_entity_record *records;
+  u32 record_count;
+  u32 record_capacity;
+  // Free indices, reused last in first out.
+  u32 *free_indices;
+  u32 free_count;
+
+  u32 entity_count;
+
+  // Chunks matched by the running parallel query.
+  struct ecs_chunk_view *views;
+  u32 view_capacity;
+} ecs_world;
+
+/**
+ * Which entities a query visits: those that have every component in all and
+ * none of the components in none.
+ */
+typedef struct ecs_query {
+  u64 all;
+  u64 none;
+} ecs_query;
+
+// One chunk of entities matched by a query.
+typedef struct ecs_chunk_view {
+  struct ecs_archetype *archetype;
+  // Start of the chunk's memory.
+  u8 *memory;
+  u32 count;
+  const ecs_entity *entities;
+} ecs_chunk_view;
+
+/**
+ * Called for each matching chunk. Iterate [0, chunk->count) over the arrays
+ * from ecs_chunk_column.
+ */
+typedef void (*pfn_ecs_chunk_callback)(const ecs_chunk_view *chunk,
+                                       void *params);
+
+VAPI void ecs_world_create(ecs_world *out_world);
+
+// Destroys every entity and frees all memory of the world.
+VAPI void ecs_world_destroy(ecs_world *world);
+
+/**
+ * Registers a component type. Use ECS_COMPONENT for structs.
+ *
+ * @param name Identifies the component in logs. Must outlive the world.
+ * @param size Size in bytes. 0 for a tag without data.
+ * @param alignment Power of two of at most ECS_COLUMN_ALIGNMENT.
+ * @return The component, or ECS_COMPONENT_INVALID if the limit was reached
+ * or the type does not fit a chunk.
+ */
+VAPI ecs_component ecs_component_register(ecs_world *world, const char *name,
+                                          u32 size, u32 alignment);
+
+/**
+ * Creates an entity with zeroed components.
+ *
+ * @param components Mask of the entity's components.
+ * @return The entity, or ECS_ENTITY_INVALID if a component is unknown or
+ * the components do not fit a chunk together.
+ */
+VAPI ecs_entity ecs_entity_create(ecs_world *world, u64 components);
+
+/**
+ * Creates count entities with the same components, filling chunks in order.
+ *
+ * @param out_entities Receives the entities. Can be NULL.
+ * @return FALSE if a component is unknown or the components do not fit a
+ * chunk together.
+ */
+VAPI b8 ecs_entity_create_batch(ecs_world *world, u64 components, u32 count,
+                                ecs_entity *out_entities);
+
+VAPI void ecs_entity_destroy(ecs_world *world, ecs_entity entity);
+
+VAPI b8 ecs_entity_is_alive(const ecs_world *world, ecs_entity entity);
+
+// Mask of the entity's components, or 0 if it is not alive.
+VAPI u64 ecs_entity_components(const ecs_world *world, ecs_entity entity);
+
+/**
+ * Adds a zeroed component. Does nothing if the entity already has it.
+ *
+ * @return FALSE if the entity is not alive, the component is unknown, or the
+ * entity's components would no longer fit a chunk together.
+ */
+VAPI b8 ecs_entity_add(ecs_world *world, ecs_entity entity,
+                       ecs_component component);
+
+VAPI b8 ecs_entity_remove(ecs_world *world, ecs_entity entity,
+                          ecs_component component);
+
+/**
+ * The entity's component data, valid until the next structural change.
+ *
+ * @return The data, or NULL if the entity is not alive or lacks it.
+ */
+VAPI void *ecs_entity_get(const ecs_world *world, ecs_entity entity,
+                          ecs_component component);
+
+/**
+ * The array of a component in a chunk, or NULL if the chunk's archetype
+ * lacks it.
+ */
+VAPI void *ecs_chunk_column(const ecs_chunk_view *chunk,
+                            ecs_component component);
+
+/**
+ * Runs callback for each chunk matching the query, in archetype and then
+ * chunk order.
+ *
+ * @return The number of entities visited.
+ */
+VAPI u32 ecs_query_for_each(ecs_world *world, const ecs_query *query,
+                            pfn_ecs_chunk_callback callback, void *params);
+
+/**
+ * Like ecs_query_for_each, but spreads the chunks over the job system and
+ * returns once all have been processed. Callbacks for different chunks run
+ * concurrently and must only write to their own chunk.
+ *
+ * @param min_chunks_per_job Fewest chunks handed to one job.
+ * @return The number of entities visited.
+ */
+VAPI u32 ecs_query_for_each_parallel(ecs_world *world, const ecs_query *query,
+                                     pfn_ecs_chunk_callback callback,
+                                     void *params, u32 min_chunks_per_job);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <core/application.h>
+#include <core/game_module.h>
 #include <core/logger.h>
 #include <core/vmemory.h>
 #include <game_types.h>
@@ -15,8 +16,9 @@ int main(void) {
 
   memory_init();
 
-  // Request the game instance from the application.
-  game game_instance;
+  // Request the game instance from the application. Config fields the game
+  // does not set keep their zero defaults.
+  game game_instance = {0};
   if (!create_game(&game_instance)) {
     VFATAL("Failed to create the game instance.");
     return -1;
@@ -41,9 +43,13 @@ int main(void) {
     return -4;
   }
 
-  memory_shutdown();
+  // Nothing references the game's code past this point. Does nothing unless
+  // the game was loaded with game_module_load.
+  game_module_unload();
+
+  vfree(game_instance.state, game_instance.state_size, MEMORY_TAG_GAME);
 
-  vfree(game_instance.state, );
+  memory_shutdown();
 
   return 0;
 }
@@ -9,15 +9,32 @@ typedef struct game {
   // Function pointer to the game's initialization function.
   b8 (*initialize)(struct game *game_instance);
 
-  // Function pointer to the game's update function.
+  // Function pointer to the game's update function. With a fixed update rate
+  // configured, delta_time is always the fixed step and update may run zero
+  // or several times per frame. A key or button press or release is then
+  // seen by the first update after it and by no other: input_was_* compares
+  // against the input as of the last frame that ran an update, and later
+  // updates in the same frame see no edges and no mouse motion.
   b8 (*update)(struct game *game_instance, f64 delta_time);
 
-  // Function pointer to the game's render function.
-  b8 (*render)(struct game *game_instance, f64 delta_time);
+  // Function pointer to the game's render function. delta_time is the real
+  // time since the previous frame. alpha, in [0, 1), is how far the frame lies
+  // between the last fixed update and the next one, for interpolating state.
+  // It is always 1 without a fixed update rate. With pipelined rendering this
+  // runs on the render thread, against a copy of the state from the previous
+  // update. Input read there is that of the frame being updated, which does
+  // not change while render runs. Its input_was_* also compare against the
+  // input as of the last frame that ran an update.
+  b8 (*render)(struct game *game_instance, f64 delta_time, f64 alpha);
 
   // Function pointer to handle resizing the game window. If applicable.
   b8 (*on_resize)(struct game *game_instance, u32 width, u32 height);
 
-  // Game-specific state. Created and managed by the game.
+  // Size of the game state in bytes. Required for pipelined rendering,
+  // which keeps a second copy of the state for render.
+  u64 state_size;
+
+  // Game-specific state. Created by the game, allocated with
+  // MEMORY_TAG_GAME, and freed by the engine on exit.
   void *state;
 } game;
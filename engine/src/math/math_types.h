@@ -0,0 +1,119 @@
+#pragma once
+
+#include <defines.h>
+
+/**
+ * Vector, quaternion and matrix types. The layout never depends on which
+ * SIMD code paths are compiled in, so code built with different instruction
+ * sets can share them. vec4, quat and mat4 are 16 byte aligned so they load
+ * straight into SSE registers.
+ */
+
+typedef union vec2_u {
+  f32 elements[2];
+  struct {
+    union {
+      f32 x, r, s, u;
+    };
+    union {
+      f32 y, g, t, v;
+    };
+  };
+} vec2;
+
+typedef union vec3_u {
+  f32 elements[3];
+  struct {
+    union {
+      f32 x, r, s, u;
+    };
+    union {
+      f32 y, g, t, v;
+    };
+    union {
+      f32 z, b, p, w;
+    };
+  };
+} vec3;
+
+typedef union vec4_u {
+  _Alignas(16) f32 elements[4];
+  struct {
+    union {
+      f32 x, r, s;
+    };
+    union {
+      f32 y, g, t;
+    };
+    union {
+      f32 z, b, p;
+    };
+    union {
+      f32 w, a, q;
+    };
+  };
+} vec4;
+
+// Rotation as a unit quaternion, (x, y, z) the vector part and w the scalar.
+typedef vec4 quat;
+
+/**
+ * Column-major 4x4 matrix, as GLSL and Vulkan expect. data[column * 4 + row]
+ * is the element at (row, column). Vectors are columns and multiply on the
+ * right, so the translation is in data[12..14].
+ */
+typedef union mat4_u {
+  _Alignas(16) f32 data[16];
+  vec4 columns[4];
+} mat4;
+
+/**
+ * Points or directions stored as structure of arrays, one array per
+ * component, for the batch functions. Arrays aligned to 32 bytes are
+ * processed fastest but any alignment works.
+ */
+typedef struct vec3_soa {
+  f32 *x;
+  f32 *y;
+  f32 *z;
+} vec3_soa;
+
+/**
+ * Axis-aligned boxes stored as structure of arrays, for the batch functions.
+ * Box i spans [min_x[i], max_x[i]] and likewise on y and z.
+ */
+typedef struct aabb_soa {
+  f32 *min_x;
+  f32 *min_y;
+  f32 *min_z;
+  f32 *max_x;
+  f32 *max_y;
+  f32 *max_z;
+} aabb_soa;
+
+// Axis-aligned bounding box. Empty when min exceeds max on any axis.
+typedef struct aabb {
+  vec3 min;
+  vec3 max;
+} aabb;
+
+// The points origin + t * direction for t >= 0.
+typedef struct ray {
+  vec3 origin;
+  vec3 direction;
+} ray;
+
+/**
+ * The plane dot(normal, p) + distance = 0, stored as (normal, distance) with
+ * the unit normal pointing into the half space in front of it.
+ */
+typedef vec4 plane;
+
+// Six planes facing inwards: left, right, bottom, top, near, far.
+typedef struct frustum {
+  plane planes[6];
+} frustum;
+
+STATIC_ASSERT(sizeof(vec3) == 12, vec3_is_packed);
+STATIC_ASSERT(sizeof(vec4) == 16, vec4_fits_a_register);
+STATIC_ASSERT(sizeof(mat4) == 64, mat4_fits_a_cache_line);
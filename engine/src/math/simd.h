@@ -0,0 +1,64 @@
+#pragma once
+
+/**
+ * Chooses the SIMD code paths of the math library at compile time from the
+ * instruction sets the compiler targets:
+ *   VSIMD_SSE  SSE2 and later, always on for x64.
+ *   VSIMD_AVX  AVX, with -mavx or /arch:AVX and up.
+ *   VSIMD_AVX2 AVX2, with -mavx2 or /arch:AVX2 and up.
+ *   VSIMD_FMA  Fused multiply-add, with -mfma or /arch:AVX2.
+ * Everything else uses the scalar code. Define VMATH_SCALAR to force the
+ * scalar code, e.g. to compare results against it.
+ */
+
+#ifndef VMATH_SCALAR
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VSIMD_SSE 1
+#endif
+
+#if defined(__AVX__)
+#define VSIMD_AVX 1
+#endif
+
+#if defined(__AVX2__)
+#define VSIMD_AVX2 1
+#endif
+
+// MSVC has no FMA macro but /arch:AVX2 implies it.
+#if defined(__FMA__) || (defined(_MSC_VER) && defined(__AVX2__))
+#define VSIMD_FMA 1
+#endif
+
+#endif
+
+#if defined(VSIMD_AVX)
+#include <immintrin.h>
+#elif defined(VSIMD_SSE)
+#include <emmintrin.h>
+#endif
+
+#ifdef VSIMD_SSE
+// Broadcasts element i of v to all four lanes.
+#define VSIMD_SPLAT(v, i) _mm_shuffle_ps((v), (v), _MM_SHUFFLE(i, i, i, i))
+
+// a * b + c, fused where the CPU supports it.
+static inline __m128 vsimd_madd(__m128 a, __m128 b, __m128 c) {
+#ifdef VSIMD_FMA
+  return _mm_fmadd_ps(a, b, c);
+#else
+  return _mm_add_ps(_mm_mul_ps(a, b), c);
+#endif
+}
+#endif
+
+#ifdef VSIMD_AVX
+static inline __m256 vsimd_madd8(__m256 a, __m256 b, __m256 c) {
+#ifdef VSIMD_FMA
+  return _mm256_fmadd_ps(a, b, c);
+#else
+  return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+}
+#endif
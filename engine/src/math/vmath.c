@@ -0,0 +1,230 @@
+#include <math/vmath.h>
+
+quat quat_slerp(quat a, quat b, f32 t) {
+  f32 cos_theta = vec4_dot(a, b);
+
+  // q and -q are the same rotation. Flip one to take the shorter arc.
+  if (cos_theta < 0.0f) {
+    b = vec4_scale(b, -1.0f);
+    cos_theta = -cos_theta;
+  }
+
+  // Nearly parallel: the sine below loses precision, and a normalized lerp
+  // is indistinguishable.
+  if (cos_theta > 0.9995f) {
+    return quat_normalized(vec4_lerp(a, b, t));
+  }
+
+  f32 theta = vacos(cos_theta);
+  f32 sin_theta = vsqrt(1.0f - cos_theta * cos_theta);
+  f32 weight_a = vsin((1.0f - t) * theta) / sin_theta;
+  f32 weight_b = vsin(t * theta) / sin_theta;
+  return vec4_add(vec4_scale(a, weight_a), vec4_scale(b, weight_b));
+}
+
+mat4 mat4_inverse(mat4 matrix) {
+  const f32 *m = matrix.data;
+  mat4 result;
+  f32 *o = result.data;
+
+  // Cofactors, transposed into the adjugate.
+  o[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] +
+         m[9] * m[7] * m[14] + m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+  o[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] -
+         m[8] * m[7] * m[14] - m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+  o[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] +
+         m[8] * m[7] * m[13] + m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+  o[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] -
+          m[8] * m[6] * m[13] - m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+  o[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] -
+         m[9] * m[3] * m[14] - m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+  o[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] +
+         m[8] * m[3] * m[14] + m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+  o[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] -
+         m[8] * m[3] * m[13] - m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+  o[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] +
+          m[8] * m[2] * m[13] + m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+  o[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] +
+         m[5] * m[3] * m[14] + m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+  o[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] -
+         m[4] * m[3] * m[14] - m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+  o[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] +
+          m[4] * m[3] * m[13] + m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+  o[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] + m[4] * m[1] * m[14] -
+          m[4] * m[2] * m[13] - m[12] * m[1] * m[6] + m[12] * m[2] * m[5];
+  o[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] -
+         m[5] * m[3] * m[10] - m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+  o[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] +
+         m[4] * m[3] * m[10] + m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+  o[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] -
+          m[4] * m[3] * m[9] - m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+  o[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] +
+          m[4] * m[2] * m[9] + m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+
+  f32 determinant = m[0] * o[0] + m[1] * o[4] + m[2] * o[8] + m[3] * o[12];
+  if (determinant == 0.0f) {
+    return mat4_identity();
+  }
+
+  f32 inverse_determinant = 1.0f / determinant;
+  for (u32 i = 0; i < 16; ++i) {
+    o[i] *= inverse_determinant;
+  }
+
+  return result;
+}
+
+mat4 mat4_perspective(f32 fov_radians, f32 aspect_ratio, f32 near_clip,
+                      f32 far_clip) {
+  f32 focal_length = 1.0f / vtan(fov_radians * 0.5f);
+
+  mat4 result = {0};
+  result.data[0] = focal_length / aspect_ratio;
+  result.data[5] = -focal_length;
+  result.data[10] = far_clip / (near_clip - far_clip);
+  result.data[11] = -1.0f;
+  result.data[14] = near_clip * far_clip / (near_clip - far_clip);
+  return result;
+}
+
+mat4 mat4_orthographic(f32 left, f32 right, f32 bottom, f32 top,
+                       f32 near_clip, f32 far_clip) {
+  mat4 result = mat4_identity();
+  result.data[0] = 2.0f / (right - left);
+  result.data[5] = -2.0f / (top - bottom);
+  result.data[10] = 1.0f / (near_clip - far_clip);
+  result.data[12] = -(right + left) / (right - left);
+  result.data[13] = (top + bottom) / (top - bottom);
+  result.data[14] = near_clip / (near_clip - far_clip);
+  return result;
+}
+
+mat4 mat4_look_at(vec3 position, vec3 target, vec3 up) {
+  vec3 forward = vec3_normalized(vec3_sub(target, position));
+  vec3 right = vec3_normalized(vec3_cross(forward, up));
+  vec3 camera_up = vec3_cross(right, forward);
+
+  mat4 result = mat4_identity();
+  result.data[0] = right.x;
+  result.data[4] = right.y;
+  result.data[8] = right.z;
+  result.data[1] = camera_up.x;
+  result.data[5] = camera_up.y;
+  result.data[9] = camera_up.z;
+  result.data[2] = -forward.x;
+  result.data[6] = -forward.y;
+  result.data[10] = -forward.z;
+  result.data[12] = -vec3_dot(right, position);
+  result.data[13] = -vec3_dot(camera_up, position);
+  result.data[14] = vec3_dot(forward, position);
+  return result;
+}
+
+void mat4_transform_points(const mat4 *m, vec3_soa points,
+                           vec3_soa out_points, u32 count) {
+  const f32 *d = m->data;
+  u32 i = 0;
+
+#ifdef VSIMD_AVX
+  __m256 m0 = _mm256_set1_ps(d[0]), m1 = _mm256_set1_ps(d[1]);
+  __m256 m2 = _mm256_set1_ps(d[2]), m4 = _mm256_set1_ps(d[4]);
+  __m256 m5 = _mm256_set1_ps(d[5]), m6 = _mm256_set1_ps(d[6]);
+  __m256 m8 = _mm256_set1_ps(d[8]), m9 = _mm256_set1_ps(d[9]);
+  __m256 m10 = _mm256_set1_ps(d[10]), m12 = _mm256_set1_ps(d[12]);
+  __m256 m13 = _mm256_set1_ps(d[13]), m14 = _mm256_set1_ps(d[14]);
+
+  for (; i + 8 <= count; i += 8) {
+    __m256 x = _mm256_loadu_ps(&points.x[i]);
+    __m256 y = _mm256_loadu_ps(&points.y[i]);
+    __m256 z = _mm256_loadu_ps(&points.z[i]);
+
+    __m256 out_x = vsimd_madd8(m0, x, vsimd_madd8(m4, y, m12));
+    __m256 out_y = vsimd_madd8(m1, x, vsimd_madd8(m5, y, m13));
+    __m256 out_z = vsimd_madd8(m2, x, vsimd_madd8(m6, y, m14));
+    _mm256_storeu_ps(&out_points.x[i], vsimd_madd8(m8, z, out_x));
+    _mm256_storeu_ps(&out_points.y[i], vsimd_madd8(m9, z, out_y));
+    _mm256_storeu_ps(&out_points.z[i], vsimd_madd8(m10, z, out_z));
+  }
+#endif
+
+#ifdef VSIMD_SSE
+  __m128 s0 = _mm_set1_ps(d[0]), s1 = _mm_set1_ps(d[1]);
+  __m128 s2 = _mm_set1_ps(d[2]), s4 = _mm_set1_ps(d[4]);
+  __m128 s5 = _mm_set1_ps(d[5]), s6 = _mm_set1_ps(d[6]);
+  __m128 s8 = _mm_set1_ps(d[8]), s9 = _mm_set1_ps(d[9]);
+  __m128 s10 = _mm_set1_ps(d[10]), s12 = _mm_set1_ps(d[12]);
+  __m128 s13 = _mm_set1_ps(d[13]), s14 = _mm_set1_ps(d[14]);
+
+  for (; i + 4 <= count; i += 4) {
+    __m128 x = _mm_loadu_ps(&points.x[i]);
+    __m128 y = _mm_loadu_ps(&points.y[i]);
+    __m128 z = _mm_loadu_ps(&points.z[i]);
+
+    __m128 out_x = vsimd_madd(s0, x, vsimd_madd(s4, y, s12));
+    __m128 out_y = vsimd_madd(s1, x, vsimd_madd(s5, y, s13));
+    __m128 out_z = vsimd_madd(s2, x, vsimd_madd(s6, y, s14));
+    _mm_storeu_ps(&out_points.x[i], vsimd_madd(s8, z, out_x));
+    _mm_storeu_ps(&out_points.y[i], vsimd_madd(s9, z, out_y));
+    _mm_storeu_ps(&out_points.z[i], vsimd_madd(s10, z, out_z));
+  }
+#endif
+
+  for (; i < count; ++i) {
+    f32 x = points.x[i], y = points.y[i], z = points.z[i];
+    out_points.x[i] = d[0] * x + d[4] * y + d[8] * z + d[12];
+    out_points.y[i] = d[1] * x + d[5] * y + d[9] * z + d[13];
+    out_points.z[i] = d[2] * x + d[6] * y + d[10] * z + d[14];
+  }
+}
+
+void mat4_mul_batch(const mat4 *a, const mat4 *b, mat4 *out, u32 count) {
+#ifdef VSIMD_AVX
+  for (u32 i = 0; i < count; ++i) {
+    // Each column of a in both halves, so one product covers two columns of
+    // the result.
+    __m256 a0 = _mm256_broadcast_ps((const __m128 *)&a[i].data[0]);
+    __m256 a1 = _mm256_broadcast_ps((const __m128 *)&a[i].data[4]);
+    __m256 a2 = _mm256_broadcast_ps((const __m128 *)&a[i].data[8]);
+    __m256 a3 = _mm256_broadcast_ps((const __m128 *)&a[i].data[12]);
+
+    // Columns 0 and 1, then 2 and 3. Storing the first pair before loading
+    // the second is safe even when out aliases b.
+    for (u32 half = 0; half < 2; ++half) {
+      __m256 pair = _mm256_loadu_ps(&b[i].data[half * 8]);
+      __m256 r = _mm256_mul_ps(a0, _mm256_shuffle_ps(pair, pair, 0x00));
+      r = vsimd_madd8(a1, _mm256_shuffle_ps(pair, pair, 0x55), r);
+      r = vsimd_madd8(a2, _mm256_shuffle_ps(pair, pair, 0xAA), r);
+      r = vsimd_madd8(a3, _mm256_shuffle_ps(pair, pair, 0xFF), r);
+      _mm256_storeu_ps(&out[i].data[half * 8], r);
+    }
+  }
+#else
+  for (u32 i = 0; i < count; ++i) {
+    out[i] = mat4_mul(a[i], b[i]);
+  }
+#endif
+}
+
+frustum frustum_from_matrix(const mat4 *view_projection) {
+  // Each plane combines rows of the matrix (Gribb and Hartmann): a clip
+  // space bound like x <= w becomes (row3 - row0) . p >= 0 in world space.
+  const f32 *m = view_projection->data;
+  vec4 rows[4];
+  for (u32 i = 0; i < 4; ++i) {
+    rows[i] = (vec4){{m[i], m[4 + i], m[8 + i], m[12 + i]}};
+  }
+
+  frustum result;
+  result.planes[0] = vec4_add(rows[3], rows[0]);
+  result.planes[1] = vec4_sub(rows[3], rows[0]);
+  result.planes[2] = vec4_add(rows[3], rows[1]);
+  result.planes[3] = vec4_sub(rows[3], rows[1]);
+  result.planes[4] = rows[2];
+  result.planes[5] = vec4_sub(rows[3], rows[2]);
+  for (u32 i = 0; i < 6; ++i) {
+    plane *p = &result.planes[i];
+    f32 length = vsqrt(p->x * p->x + p->y * p->y + p->z * p->z);
+    *p = vec4_scale(*p, 1.0f / length);
+  }
+  return result;
+}
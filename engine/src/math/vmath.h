@@ -0,0 +1,584 @@
+#pragma once
+
+#include <defines.h>
+#include <math/math_types.h>
+#include <math/simd.h>
+
+#include <math.h>
+
+/**
+ * Math library. Small functions are inline and take and return their
+ * arguments by value. Matrix products and vec4 arithmetic use SSE where it
+ * is compiled in (see math/simd.h); the batch functions at the end also use
+ * AVX. Angles are in radians. Matrices follow the conventions in
+ * math_types.h: column-major, column vectors, and mat4_mul(a, b) applies b
+ * first.
+ */
+
+#define V_PI 3.14159265358979323846f
+#define V_2PI (2.0f * V_PI)
+#define V_HALF_PI (0.5f * V_PI)
+#define V_DEG2RAD_MULTIPLIER (V_PI / 180.0f)
+#define V_RAD2DEG_MULTIPLIER (180.0f / V_PI)
+
+// Smallest positive difference between 1.0 and the next float.
+#define V_FLOAT_EPSILON 1.192092896e-07f
+
+// Largest finite float.
+#define V_FLOAT_MAX 3.402823466e+38f
+
+// ---------------------------------------------------------------------------
+// Scalars
+// ---------------------------------------------------------------------------
+
+static inline f32 vsqrt(f32 x) { return sqrtf(x); }
+static inline f32 vabs(f32 x) { return fabsf(x); }
+static inline f32 vsin(f32 x) { return sinf(x); }
+static inline f32 vcos(f32 x) { return cosf(x); }
+static inline f32 vtan(f32 x) { return tanf(x); }
+static inline f32 vacos(f32 x) { return acosf(x); }
+static inline f32 vmin(f32 a, f32 b) { return a < b ? a : b; }
+static inline f32 vmax(f32 a, f32 b) { return a > b ? a : b; }
+
+static inline f32 vclamp(f32 x, f32 low, f32 high) {
+  return x < low ? low : (x > high ? high : x);
+}
+
+static inline f32 vlerp(f32 a, f32 b, f32 t) { return a + (b - a) * t; }
+
+static inline f32 deg_to_rad(f32 degrees) {
+  return degrees * V_DEG2RAD_MULTIPLIER;
+}
+
+static inline f32 rad_to_deg(f32 radians) {
+  return radians * V_RAD2DEG_MULTIPLIER;
+}
+
+// ---------------------------------------------------------------------------
+// vec2
+// ---------------------------------------------------------------------------
+
+static inline vec2 vec2_create(f32 x, f32 y) { return (vec2){{x, y}}; }
+static inline vec2 vec2_zero() { return (vec2){{0.0f, 0.0f}}; }
+static inline vec2 vec2_one() { return (vec2){{1.0f, 1.0f}}; }
+
+static inline vec2 vec2_add(vec2 a, vec2 b) {
+  return (vec2){{a.x + b.x, a.y + b.y}};
+}
+
+static inline vec2 vec2_sub(vec2 a, vec2 b) {
+  return (vec2){{a.x - b.x, a.y - b.y}};
+}
+
+static inline vec2 vec2_mul(vec2 a, vec2 b) {
+  return (vec2){{a.x * b.x, a.y * b.y}};
+}
+
+static inline vec2 vec2_scale(vec2 v, f32 s) {
+  return (vec2){{v.x * s, v.y * s}};
+}
+
+static inline f32 vec2_dot(vec2 a, vec2 b) { return a.x * b.x + a.y * b.y; }
+static inline f32 vec2_length_squared(vec2 v) { return vec2_dot(v, v); }
+static inline f32 vec2_length(vec2 v) { return vsqrt(vec2_dot(v, v)); }
+
+// Returns v scaled to unit length. v must not be zero.
+static inline vec2 vec2_normalized(vec2 v) {
+  return vec2_scale(v, 1.0f / vec2_length(v));
+}
+
+static inline f32 vec2_distance(vec2 a, vec2 b) {
+  return vec2_length(vec2_sub(a, b));
+}
+
+// ---------------------------------------------------------------------------
+// vec3
+// ---------------------------------------------------------------------------
+
+static inline vec3 vec3_create(f32 x, f32 y, f32 z) {
+  return (vec3){{x, y, z}};
+}
+
+static inline vec3 vec3_zero() { return (vec3){{0.0f, 0.0f, 0.0f}}; }
+static inline vec3 vec3_one() { return (vec3){{1.0f, 1.0f, 1.0f}}; }
+static inline vec3 vec3_up() { return (vec3){{0.0f, 1.0f, 0.0f}}; }
+static inline vec3 vec3_right() { return (vec3){{1.0f, 0.0f, 0.0f}}; }
+
+// Right handed, so forward looks down -Z.
+static inline vec3 vec3_forward() { return (vec3){{0.0f, 0.0f, -1.0f}}; }
+
+static inline vec3 vec3_add(vec3 a, vec3 b) {
+  return (vec3){{a.x + b.x, a.y + b.y, a.z + b.z}};
+}
+
+static inline vec3 vec3_sub(vec3 a, vec3 b) {
+  return (vec3){{a.x - b.x, a.y - b.y, a.z - b.z}};
+}
+
+static inline vec3 vec3_mul(vec3 a, vec3 b) {
+  return (vec3){{a.x * b.x, a.y * b.y, a.z * b.z}};
+}
+
+static inline vec3 vec3_scale(vec3 v, f32 s) {
+  return (vec3){{v.x * s, v.y * s, v.z * s}};
+}
+
+static inline f32 vec3_dot(vec3 a, vec3 b) {
+  return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static inline vec3 vec3_cross(vec3 a, vec3 b) {
+  return (vec3){{a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z,
+                 a.x * b.y - a.y * b.x}};
+}
+
+static inline f32 vec3_length_squared(vec3 v) { return vec3_dot(v, v); }
+static inline f32 vec3_length(vec3 v) { return vsqrt(vec3_dot(v, v)); }
+
+// Returns v scaled to unit length. v must not be zero.
+static inline vec3 vec3_normalized(vec3 v) {
+  return vec3_scale(v, 1.0f / vec3_length(v));
+}
+
+static inline f32 vec3_distance(vec3 a, vec3 b) {
+  return vec3_length(vec3_sub(a, b));
+}
+
+static inline vec3 vec3_lerp(vec3 a, vec3 b, f32 t) {
+  return (vec3){{vlerp(a.x, b.x, t), vlerp(a.y, b.y, t), vlerp(a.z, b.z, t)}};
+}
+
+static inline vec3 vec3_min(vec3 a, vec3 b) {
+  return (vec3){{vmin(a.x, b.x), vmin(a.y, b.y), vmin(a.z, b.z)}};
+}
+
+static inline vec3 vec3_max(vec3 a, vec3 b) {
+  return (vec3){{vmax(a.x, b.x), vmax(a.y, b.y), vmax(a.z, b.z)}};
+}
+
+// TRUE if every component differs by at most tolerance.
+static inline b8 vec3_compare(vec3 a, vec3 b, f32 tolerance) {
+  return vabs(a.x - b.x) <= tolerance && vabs(a.y - b.y) <= tolerance &&
+         vabs(a.z - b.z) <= tolerance;
+}
+
+// ---------------------------------------------------------------------------
+// vec4
+// ---------------------------------------------------------------------------
+
+static inline vec4 vec4_create(f32 x, f32 y, f32 z, f32 w) {
+  return (vec4){{x, y, z, w}};
+}
+
+static inline vec4 vec4_zero() { return (vec4){{0.0f, 0.0f, 0.0f, 0.0f}}; }
+
+static inline vec4 vec4_from_vec3(vec3 v, f32 w) {
+  return (vec4){{v.x, v.y, v.z, w}};
+}
+
+static inline vec3 vec4_to_vec3(vec4 v) { return (vec3){{v.x, v.y, v.z}}; }
+
+static inline vec4 vec4_add(vec4 a, vec4 b) {
+  vec4 result;
+#ifdef VSIMD_SSE
+  _mm_store_ps(result.elements, _mm_add_ps(_mm_load_ps(a.elements),
+                                           _mm_load_ps(b.elements)));
+#else
+  for (u32 i = 0; i < 4; ++i) {
+    result.elements[i] = a.elements[i] + b.elements[i];
+  }
+#endif
+  return result;
+}
+
+static inline vec4 vec4_sub(vec4 a, vec4 b) {
+  vec4 result;
+#ifdef VSIMD_SSE
+  _mm_store_ps(result.elements, _mm_sub_ps(_mm_load_ps(a.elements),
+                                           _mm_load_ps(b.elements)));
+#else
+  for (u32 i = 0; i < 4; ++i) {
+    result.elements[i] = a.elements[i] - b.elements[i];
+  }
+#endif
+  return result;
+}
+
+static inline vec4 vec4_mul(vec4 a, vec4 b) {
+  vec4 result;
+#ifdef VSIMD_SSE
+  _mm_store_ps(result.elements, _mm_mul_ps(_mm_load_ps(a.elements),
+                                           _mm_load_ps(b.elements)));
+#else
+  for (u32 i = 0; i < 4; ++i) {
+    result.elements[i] = a.elements[i] * b.elements[i];
+  }
+#endif
+  return result;
+}
+
+static inline vec4 vec4_scale(vec4 v, f32 s) {
+  vec4 result;
+#ifdef VSIMD_SSE
+  _mm_store_ps(result.elements,
+               _mm_mul_ps(_mm_load_ps(v.elements), _mm_set1_ps(s)));
+#else
+  for (u32 i = 0; i < 4; ++i) {
+    result.elements[i] = v.elements[i] * s;
+  }
+#endif
+  return result;
+}
+
+static inline f32 vec4_dot(vec4 a, vec4 b) {
+  return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+}
+
+static inline f32 vec4_length(vec4 v) { return vsqrt(vec4_dot(v, v)); }
+
+// Returns v scaled to unit length. v must not be zero.
+static inline vec4 vec4_normalized(vec4 v) {
+  return vec4_scale(v, 1.0f / vec4_length(v));
+}
+
+static inline vec4 vec4_lerp(vec4 a, vec4 b, f32 t) {
+  return vec4_add(a, vec4_scale(vec4_sub(b, a), t));
+}
+
+// ---------------------------------------------------------------------------
+// quat
+// ---------------------------------------------------------------------------
+
+static inline quat quat_identity() { return (quat){{0.0f, 0.0f, 0.0f, 1.0f}}; }
+
+// Rotation by angle around axis, which must be unit length.
+static inline quat quat_from_axis_angle(vec3 axis, f32 angle) {
+  f32 s = vsin(angle * 0.5f);
+  return (quat){{axis.x * s, axis.y * s, axis.z * s, vcos(angle * 0.5f)}};
+}
+
+// The rotation b followed by a.
+static inline quat quat_mul(quat a, quat b) {
+  return (quat){{
+      a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+      a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+      a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+      a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z,
+  }};
+}
+
+static inline quat quat_normalized(quat q) { return vec4_normalized(q); }
+
+// The inverse of a unit quaternion.
+static inline quat quat_conjugate(quat q) {
+  return (quat){{-q.x, -q.y, -q.z, q.w}};
+}
+
+// Rotates v by the unit quaternion q.
+static inline vec3 quat_rotate(quat q, vec3 v) {
+  // v + 2w(u x v) + 2u x (u x v), with u the vector part.
+  vec3 u = {{q.x, q.y, q.z}};
+  vec3 t = vec3_scale(vec3_cross(u, v), 2.0f);
+  return vec3_add(vec3_add(v, vec3_scale(t, q.w)), vec3_cross(u, t));
+}
+
+/**
+ * Interpolates between two unit quaternions along the shorter arc at
+ * constant angular speed.
+ */
+VAPI quat quat_slerp(quat a, quat b, f32 t);
+
+// ---------------------------------------------------------------------------
+// mat4
+// ---------------------------------------------------------------------------
+
+static inline mat4 mat4_identity() {
+  mat4 result = {0};
+  result.data[0] = 1.0f;
+  result.data[5] = 1.0f;
+  result.data[10] = 1.0f;
+  result.data[15] = 1.0f;
+  return result;
+}
+
+// The transform b followed by a, a * b.
+static inline mat4 mat4_mul(mat4 a, mat4 b) {
+  mat4 result;
+#ifdef VSIMD_SSE
+  __m128 a0 = _mm_load_ps(&a.data[0]);
+  __m128 a1 = _mm_load_ps(&a.data[4]);
+  __m128 a2 = _mm_load_ps(&a.data[8]);
+  __m128 a3 = _mm_load_ps(&a.data[12]);
+  for (u32 column = 0; column < 4; ++column) {
+    __m128 b_column = _mm_load_ps(&b.data[column * 4]);
+    __m128 r = _mm_mul_ps(a0, VSIMD_SPLAT(b_column, 0));
+    r = vsimd_madd(a1, VSIMD_SPLAT(b_column, 1), r);
+    r = vsimd_madd(a2, VSIMD_SPLAT(b_column, 2), r);
+    r = vsimd_madd(a3, VSIMD_SPLAT(b_column, 3), r);
+    _mm_store_ps(&result.data[column * 4], r);
+  }
+#else
+  for (u32 column = 0; column < 4; ++column) {
+    for (u32 row = 0; row < 4; ++row) {
+      f32 sum = 0.0f;
+      for (u32 k = 0; k < 4; ++k) {
+        sum += a.data[k * 4 + row] * b.data[column * 4 + k];
+      }
+      result.data[column * 4 + row] = sum;
+    }
+  }
+#endif
+  return result;
+}
+
+static inline vec4 mat4_mul_vec4(mat4 m, vec4 v) {
+  vec4 result;
+#ifdef VSIMD_SSE
+  __m128 x = _mm_set1_ps(v.x);
+  __m128 r = _mm_mul_ps(_mm_load_ps(&m.data[0]), x);
+  r = vsimd_madd(_mm_load_ps(&m.data[4]), _mm_set1_ps(v.y), r);
+  r = vsimd_madd(_mm_load_ps(&m.data[8]), _mm_set1_ps(v.z), r);
+  r = vsimd_madd(_mm_load_ps(&m.data[12]), _mm_set1_ps(v.w), r);
+  _mm_store_ps(result.elements, r);
+#else
+  for (u32 row = 0; row < 4; ++row) {
+    result.elements[row] = m.data[row] * v.x + m.data[4 + row] * v.y +
+                           m.data[8 + row] * v.z + m.data[12 + row] * v.w;
+  }
+#endif
+  return result;
+}
+
+// Transforms a position, w = 1, without a perspective divide.
+static inline vec3 mat4_transform_point(mat4 m, vec3 p) {
+  return vec4_to_vec3(mat4_mul_vec4(m, vec4_from_vec3(p, 1.0f)));
+}
+
+// Transforms a direction, w = 0, which ignores the translation.
+static inline vec3 mat4_transform_direction(mat4 m, vec3 d) {
+  return vec4_to_vec3(mat4_mul_vec4(m, vec4_from_vec3(d, 0.0f)));
+}
+
+static inline mat4 mat4_transposed(mat4 m) {
+  mat4 result;
+#ifdef VSIMD_SSE
+  __m128 c0 = _mm_load_ps(&m.data[0]);
+  __m128 c1 = _mm_load_ps(&m.data[4]);
+  __m128 c2 = _mm_load_ps(&m.data[8]);
+  __m128 c3 = _mm_load_ps(&m.data[12]);
+  _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+  _mm_store_ps(&result.data[0], c0);
+  _mm_store_ps(&result.data[4], c1);
+  _mm_store_ps(&result.data[8], c2);
+  _mm_store_ps(&result.data[12], c3);
+#else
+  for (u32 column = 0; column < 4; ++column) {
+    for (u32 row = 0; row < 4; ++row) {
+      result.data[column * 4 + row] = m.data[row * 4 + column];
+    }
+  }
+#endif
+  return result;
+}
+
+static inline mat4 mat4_translation(vec3 t) {
+  mat4 result = mat4_identity();
+  result.data[12] = t.x;
+  result.data[13] = t.y;
+  result.data[14] = t.z;
+  return result;
+}
+
+static inline mat4 mat4_scale(vec3 s) {
+  mat4 result = {0};
+  result.data[0] = s.x;
+  result.data[5] = s.y;
+  result.data[10] = s.z;
+  result.data[15] = 1.0f;
+  return result;
+}
+
+// Rotation matrix of a unit quaternion.
+static inline mat4 quat_to_mat4(quat q) {
+  f32 xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+  f32 xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+  f32 wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+  mat4 result = mat4_identity();
+  result.data[0] = 1.0f - 2.0f * (yy + zz);
+  result.data[1] = 2.0f * (xy + wz);
+  result.data[2] = 2.0f * (xz - wy);
+  result.data[4] = 2.0f * (xy - wz);
+  result.data[5] = 1.0f - 2.0f * (xx + zz);
+  result.data[6] = 2.0f * (yz + wx);
+  result.data[8] = 2.0f * (xz + wy);
+  result.data[9] = 2.0f * (yz - wx);
+  result.data[10] = 1.0f - 2.0f * (xx + yy);
+  return result;
+}
+
+/**
+ * Scales, then rotates, then translates: the same as
+ * translation * rotation * scale, without the products.
+ */
+static inline mat4 mat4_from_trs(vec3 translation, quat rotation, vec3 scale) {
+  f32 xx = rotation.x * rotation.x, yy = rotation.y * rotation.y;
+  f32 zz = rotation.z * rotation.z, xy = rotation.x * rotation.y;
+  f32 xz = rotation.x * rotation.z, yz = rotation.y * rotation.z;
+  f32 wx = rotation.w * rotation.x, wy = rotation.w * rotation.y;
+  f32 wz = rotation.w * rotation.z;
+
+  // Written in one go: scaling the elements of quat_to_mat4's result in
+  // place makes the SSE loads that follow wait on scalar stores.
+  mat4 result = {{
+      (1.0f - 2.0f * (yy + zz)) * scale.x,
+      2.0f * (xy + wz) * scale.x,
+      2.0f * (xz - wy) * scale.x,
+      0.0f,
+      2.0f * (xy - wz) * scale.y,
+      (1.0f - 2.0f * (xx + zz)) * scale.y,
+      2.0f * (yz + wx) * scale.y,
+      0.0f,
+      2.0f * (xz + wy) * scale.z,
+      2.0f * (yz - wx) * scale.z,
+      (1.0f - 2.0f * (xx + yy)) * scale.z,
+      0.0f,
+      translation.x,
+      translation.y,
+      translation.z,
+      1.0f,
+  }};
+  return result;
+}
+
+/**
+ * General inverse. Returns the identity if m is singular.
+ */
+VAPI mat4 mat4_inverse(mat4 m);
+
+/**
+ * Right handed perspective projection for Vulkan: clip space depth runs from
+ * 0 at near_clip to 1 at far_clip and Y points down.
+ *
+ * @param fov_radians Vertical field of view.
+ */
+VAPI mat4 mat4_perspective(f32 fov_radians, f32 aspect_ratio, f32 near_clip,
+                           f32 far_clip);
+
+// Orthographic projection with the same clip space as mat4_perspective.
+VAPI mat4 mat4_orthographic(f32 left, f32 right, f32 bottom, f32 top,
+                            f32 near_clip, f32 far_clip);
+
+// View matrix of a camera at position looking at target.
+VAPI mat4 mat4_look_at(vec3 position, vec3 target, vec3 up);
+
+// ---------------------------------------------------------------------------
+// Bounds
+// ---------------------------------------------------------------------------
+
+// Contains nothing, and anything merged into it.
+static inline aabb aabb_empty(void) {
+  return (aabb){{{V_FLOAT_MAX, V_FLOAT_MAX, V_FLOAT_MAX}},
+                {{-V_FLOAT_MAX, -V_FLOAT_MAX, -V_FLOAT_MAX}}};
+}
+
+static inline aabb aabb_union(aabb a, aabb b) {
+  return (aabb){vec3_min(a.min, b.min), vec3_max(a.max, b.max)};
+}
+
+static inline vec3 aabb_center(aabb box) {
+  return vec3_scale(vec3_add(box.min, box.max), 0.5f);
+}
+
+// Surface area, 0 for an empty box.
+static inline f32 aabb_surface_area(aabb box) {
+  vec3 size = vec3_sub(box.max, box.min);
+  if (size.x < 0.0f || size.y < 0.0f || size.z < 0.0f) {
+    return 0.0f;
+  }
+  return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+// TRUE if the boxes overlap or touch.
+static inline b8 aabb_overlaps(aabb a, aabb b) {
+  return a.min.x <= b.max.x && a.max.x >= b.min.x && a.min.y <= b.max.y &&
+         a.max.y >= b.min.y && a.min.z <= b.max.z && a.max.z >= b.min.z;
+}
+
+/**
+ * Distance along the ray to where it enters the box, 0 if it starts inside,
+ * or a negative value if it misses the box or enters past max_distance.
+ */
+static inline f32 aabb_ray_distance(aabb box, ray r, f32 max_distance) {
+  f32 t_near = 0.0f;
+  f32 t_far = max_distance;
+  for (u32 axis = 0; axis < 3; ++axis) {
+    f32 origin = r.origin.elements[axis];
+    f32 direction = r.direction.elements[axis];
+    if (direction == 0.0f) {
+      // Parallel to the slab: inside it all along or never.
+      if (origin < box.min.elements[axis] || origin > box.max.elements[axis]) {
+        return -1.0f;
+      }
+      continue;
+    }
+    f32 t0 = (box.min.elements[axis] - origin) / direction;
+    f32 t1 = (box.max.elements[axis] - origin) / direction;
+    t_near = vmax(t_near, vmin(t0, t1));
+    t_far = vmin(t_far, vmax(t0, t1));
+  }
+  return t_near <= t_far ? t_near : -1.0f;
+}
+
+/**
+ * The planes of a view-projection matrix's clip volume, with the clip space
+ * of mat4_perspective: -w <= x, y <= w and 0 <= z <= w.
+ */
+VAPI frustum frustum_from_matrix(const mat4 *view_projection);
+
+// Signed distance from the plane, positive in front.
+static inline f32 plane_distance(plane p, vec3 point) {
+  return p.x * point.x + p.y * point.y + p.z * point.z + p.w;
+}
+
+/**
+ * TRUE unless the box is entirely behind one of the planes. Boxes near a
+ * corner of the frustum can pass while outside it.
+ */
+static inline b8 frustum_intersects_aabb(const frustum *f, aabb box) {
+  for (u32 i = 0; i < 6; ++i) {
+    plane p = f->planes[i];
+    // The corner furthest along the normal.
+    vec3 corner = {{p.x >= 0.0f ? box.max.x : box.min.x,
+                    p.y >= 0.0f ? box.max.y : box.min.y,
+                    p.z >= 0.0f ? box.max.z : box.min.z}};
+    if (plane_distance(p, corner) < 0.0f) {
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+// ---------------------------------------------------------------------------
+// Batches
+// ---------------------------------------------------------------------------
+
+/**
+ * Transforms count points, w = 1, by one matrix. Processes 8 points per
+ * iteration with AVX and 4 with SSE.
+ *
+ * @param m The matrix.
+ * @param points The input points.
+ * @param out_points Receives the results. May be the same arrays as points.
+ * @param count Number of points.
+ */
+VAPI void mat4_transform_points(const mat4 *m, vec3_soa points,
+                                vec3_soa out_points, u32 count);
+
+/**
+ * Computes out[i] = a[i] * b[i] for count pairs of matrices. Computes two
+ * columns per instruction with AVX.
+ *
+ * @param out May alias a or b.
+ */
+VAPI void mat4_mul_batch(const mat4 *a, const mat4 *b, mat4 *out, u32 count);
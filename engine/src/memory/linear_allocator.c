@@ -0,0 +1,53 @@
+#include <memory/linear_allocator.h>
+
+#include <core/logger.h>
+#include <core/vmemory.h>
+
+void linear_allocator_create(u64 total_size, void *memory,
+                             linear_allocator *out_allocator) {
+  out_allocator->total_size = total_size;
+  out_allocator->allocated = 0;
+  out_allocator->owns_memory = memory == NULL;
+  out_allocator->memory =
+      memory ? memory
+             : vallocate_aligned(total_size, MEMORY_TAG_LINEAR_ALLOCATOR);
+}
+
+void linear_allocator_destroy(linear_allocator *allocator) {
+  if (allocator->owns_memory && allocator->memory) {
+    vfree_aligned(allocator->memory, allocator->total_size,
+                  MEMORY_TAG_LINEAR_ALLOCATOR);
+  }
+
+  allocator->memory = NULL;
+  allocator->total_size = 0;
+  allocator->allocated = 0;
+  allocator->owns_memory = FALSE;
+}
+
+void *linear_allocator_allocate(linear_allocator *allocator, u64 size,
+                                u64 alignment) {
+  if (!allocator->memory) {
+    VERROR("linear_allocator_allocate called on an allocator without memory.");
+    return NULL;
+  }
+
+  u64 offset = VALIGN_UP(allocator->allocated, alignment);
+  if (offset + size > allocator->total_size) {
+    VERROR("Linear allocator out of space: %llu of %llu bytes used, %llu "
+           "requested.",
+           allocator->allocated, allocator->total_size, size);
+    return NULL;
+  }
+
+  void *block = (u8 *)allocator->memory + offset;
+  allocator->allocated = offset + size;
+  return block;
+}
+
+void linear_allocator_free_all(linear_allocator *allocator) {
+  if (allocator->memory) {
+    vzero_memory(allocator->memory, allocator->allocated);
+    allocator->allocated = 0;
+  }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <defines.h>
+
+/**
+ * Hands out memory from one block by bumping an offset. Allocations cannot be
+ * freed individually; linear_allocator_free_all releases all of them at once.
+ */
+typedef struct linear_allocator {
+  u64 total_size;
+  u64 allocated;
+  void *memory;
+  // Set when the allocator allocated the block itself.
+  b8 owns_memory;
+} linear_allocator;
+
+/**
+ * Creates a linear allocator.
+ *
+ * @param total_size Size of the block in bytes.
+ * @param memory The block to allocate from. If NULL the allocator allocates a
+ * cache line aligned block itself and frees it on destroy.
+ * @param out_allocator Receives the allocator.
+ */
+VAPI void linear_allocator_create(u64 total_size, void *memory,
+                                  linear_allocator *out_allocator);
+
+VAPI void linear_allocator_destroy(linear_allocator *allocator);
+
+/**
+ * Allocates memory from the block. It is zeroed only if the block was when
+ * the allocator was created or last freed.
+ *
+ * @param size The size in bytes.
+ * @param alignment Power of two the address is a multiple of, relative to an
+ * address aligned at least as strictly.
+ * @return The memory, or NULL if the block has no room left.
+ */
+VAPI void *linear_allocator_allocate(linear_allocator *allocator, u64 size,
+                                     u64 alignment);
+
+// Releases every allocation and zeroes the memory, keeping the block.
+VAPI void linear_allocator_free_all(linear_allocator *allocator);
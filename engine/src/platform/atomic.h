@@ -0,0 +1,109 @@
+#pragma once
+
+#include <defines.h>
+
+/**
+ * Thin wrappers over C11 atomics with engine types. Every operation takes an
+ * explicit memory order so the required ordering is visible at the call site.
+ *
+ * NOTE: MSVC only provides <stdatomic.h> with /experimental:c11atomics.
+ */
+
+#include <stdatomic.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+typedef _Atomic u32 atomic_u32;
+typedef _Atomic u64 atomic_u64;
+typedef _Atomic i32 atomic_i32;
+typedef _Atomic i64 atomic_i64;
+typedef _Atomic b8 atomic_b8;
+typedef void *_Atomic atomic_ptr;
+
+typedef enum vmemory_order {
+  VMEMORY_ORDER_RELAXED = memory_order_relaxed,
+  VMEMORY_ORDER_ACQUIRE = memory_order_acquire,
+  VMEMORY_ORDER_RELEASE = memory_order_release,
+  VMEMORY_ORDER_ACQ_REL = memory_order_acq_rel,
+  VMEMORY_ORDER_SEQ_CST = memory_order_seq_cst,
+} vmemory_order;
+
+// Size of a cache line. Align independently contended atomics to this to
+// avoid false sharing.
+#define VCACHE_LINE_SIZE 64
+
+#define _VATOMIC_DEFINE_COMMON(suffix, type)                                   \
+  static inline type vatomic_load_##suffix(atomic_##suffix *object,            \
+                                           vmemory_order order) {              \
+    return atomic_load_explicit(object, (memory_order)order);                  \
+  }                                                                            \
+  static inline void vatomic_store_##suffix(                                   \
+      atomic_##suffix *object, type value, vmemory_order order) {              \
+    atomic_store_explicit(object, value, (memory_order)order);                 \
+  }                                                                            \
+  static inline type vatomic_exchange_##suffix(                                \
+      atomic_##suffix *object, type value, vmemory_order order) {              \
+    return atomic_exchange_explicit(object, value, (memory_order)order);       \
+  }                                                                            \
+  /* On failure, expected receives the current value. */                      \
+  static inline b8 vatomic_compare_exchange_##suffix(                          \
+      atomic_##suffix *object, type *expected, type desired,                   \
+      vmemory_order success, vmemory_order failure) {                          \
+    return atomic_compare_exchange_strong_explicit(                            \
+        object, expected, desired, (memory_order)success,                      \
+        (memory_order)failure);                                                \
+  }                                                                            \
+  /* May fail spuriously. Use in retry loops. */                               \
+  static inline b8 vatomic_compare_exchange_weak_##suffix(                     \
+      atomic_##suffix *object, type *expected, type desired,                   \
+      vmemory_order success, vmemory_order failure) {                          \
+    return atomic_compare_exchange_weak_explicit(                              \
+        object, expected, desired, (memory_order)success,                      \
+        (memory_order)failure);                                                \
+  }
+
+#define _VATOMIC_DEFINE_ARITHMETIC(suffix, type)                               \
+  _VATOMIC_DEFINE_COMMON(suffix, type)                                         \
+  /* The fetch operations return the value from before the operation. */      \
+  static inline type vatomic_fetch_add_##suffix(                               \
+      atomic_##suffix *object, type value, vmemory_order order) {              \
+    return atomic_fetch_add_explicit(object, value, (memory_order)order);      \
+  }                                                                            \
+  static inline type vatomic_fetch_sub_##suffix(                               \
+      atomic_##suffix *object, type value, vmemory_order order) {              \
+    return atomic_fetch_sub_explicit(object, value, (memory_order)order);      \
+  }                                                                            \
+  static inline type vatomic_fetch_or_##suffix(                                \
+      atomic_##suffix *object, type value, vmemory_order order) {              \
+    return atomic_fetch_or_explicit(object, value, (memory_order)order);       \
+  }                                                                            \
+  static inline type vatomic_fetch_and_##suffix(                               \
+      atomic_##suffix *object, type value, vmemory_order order) {              \
+    return atomic_fetch_and_explicit(object, value, (memory_order)order);      \
+  }
+
+_VATOMIC_DEFINE_ARITHMETIC(u32, u32)
+_VATOMIC_DEFINE_ARITHMETIC(u64, u64)
+_VATOMIC_DEFINE_ARITHMETIC(i32, i32)
+_VATOMIC_DEFINE_ARITHMETIC(i64, i64)
+_VATOMIC_DEFINE_COMMON(b8, b8)
+_VATOMIC_DEFINE_COMMON(ptr, void *)
+
+static inline void vatomic_thread_fence(vmemory_order order) {
+  atomic_thread_fence((memory_order)order);
+}
+
+// Hints to the CPU that the caller is spinning on a shared value.
+static inline void vatomic_pause() {
+#if defined(__x86_64__) || defined(_M_X64)
+#ifdef _MSC_VER
+  _mm_pause();
+#else
+  __builtin_ia32_pause();
+#endif
+#elif defined(__aarch64__)
+  __asm__ __volatile__("yield");
+#endif
+}
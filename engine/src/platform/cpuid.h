@@ -0,0 +1,103 @@
+#pragma once
+
+#include <platform/platform.h>
+
+/**
+ * CPUID based detection shared by the platform layers. Only included by
+ * platform_*.c. Reports nothing on CPUs other than x86.
+ */
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) ||            \
+    defined(_M_IX86)
+#define CPUID_AVAILABLE 1
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+static inline void cpuid(u32 leaf, u32 subleaf, u32 out_registers[4]) {
+#ifdef _MSC_VER
+  __cpuidex((int *)out_registers, (int)leaf, (int)subleaf);
+#else
+  __cpuid_count(leaf, subleaf, out_registers[0], out_registers[1],
+                out_registers[2], out_registers[3]);
+#endif
+}
+
+// Reads XCR0, which tells which register states the OS saves on a switch.
+static inline u64 cpuid_read_xcr0() {
+#ifdef _MSC_VER
+  return _xgetbv(0);
+#else
+  u32 eax, edx;
+  __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return ((u64)edx << 32) | eax;
+#endif
+}
+
+/**
+ * Fills in the instruction set features, the cache line size and the model
+ * name. Wide vector extensions count only if the OS also saves their
+ * registers.
+ */
+static inline void cpuid_detect(platform_cpu_info *info) {
+  u32 registers[4];
+  cpuid(0, 0, registers);
+  u32 max_leaf = registers[0];
+  if (max_leaf < 1) {
+    return;
+  }
+
+  cpuid(1, 0, registers);
+  u32 ecx1 = registers[2];
+  // EBX[15:8] is the CLFLUSH line size in 8 byte units.
+  u32 line_size = ((registers[1] >> 8) & 0xFF) * 8;
+  if (line_size && !info->cache_line_size) {
+    info->cache_line_size = line_size;
+  }
+
+  if (ecx1 & (1u << 20)) {
+    info->features |= PLATFORM_CPU_FEATURE_SSE4_2;
+  }
+
+  // OSXSAVE: XGETBV is usable.
+  u64 xcr0 = (ecx1 & (1u << 27)) ? cpuid_read_xcr0() : 0;
+  // XMM and YMM state.
+  b8 os_saves_avx = (xcr0 & 0x6) == 0x6;
+  // Opmask and ZMM state as well.
+  b8 os_saves_avx512 = (xcr0 & 0xE6) == 0xE6;
+
+  if (os_saves_avx && (ecx1 & (1u << 28))) {
+    info->features |= PLATFORM_CPU_FEATURE_AVX;
+    if (ecx1 & (1u << 12)) {
+      info->features |= PLATFORM_CPU_FEATURE_FMA;
+    }
+  }
+
+  if (max_leaf >= 7) {
+    cpuid(7, 0, registers);
+    u32 ebx7 = registers[1];
+    if (os_saves_avx && (ebx7 & (1u << 5))) {
+      info->features |= PLATFORM_CPU_FEATURE_AVX2;
+    }
+    if (os_saves_avx512 && (ebx7 & (1u << 16))) {
+      info->features |= PLATFORM_CPU_FEATURE_AVX512F;
+    }
+  }
+
+  // The brand string is 48 characters over three extended leaves.
+  cpuid(0x80000000, 0, registers);
+  if (registers[0] >= 0x80000004) {
+    u32 *brand = (u32 *)info->model_name;
+    for (u32 i = 0; i < 3; ++i) {
+      cpuid(0x80000002 + i, 0, brand + i * 4);
+    }
+    info->model_name[48] = '\0';
+  }
+}
+
+#else
+#define CPUID_AVAILABLE 0
+#endif
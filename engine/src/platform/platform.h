@@ -6,13 +6,50 @@ typedef struct platform_state {
   void *internal_state;
 } platform_state;
 
+typedef struct platform_file {
+  // Platform-specific file handle.
+  u64 handle;
+  b8 is_valid;
+} platform_file;
+
+/**
+ * Initializes the platform layer and, unless headless, creates the window.
+ *
+ * @param plat_state Receives the platform state.
+ * @param title The window title.
+ * @param x, y, width, height The window's starting position and size.
+ * @param headless When TRUE no window system is used at all. Message pumping
+ * then only reports termination requests (SIGINT/SIGTERM on Linux).
+ * @return TRUE on success, FALSE otherwise.
+ */
 b8 platform_init(platform_state *plat_state, const char *title, u32 x, u32 y,
-                 u32 width, u32 height);
+                 u32 width, u32 height, b8 headless);
 
 void platform_shutdown(platform_state *plat_state);
 
 b8 platform_pump_messages(platform_state *plat_state);
 
+/**
+ * Blocks until window system messages are available or the timeout expires,
+ * without using any CPU in between. Messages are not processed; call
+ * platform_pump_messages afterwards.
+ *
+ * @param plat_state The platform state.
+ * @param timeout_ms Maximum time to wait, or PLATFORM_WAIT_INFINITE.
+ */
+void platform_wait_messages(platform_state *plat_state, u64 timeout_ms);
+
+// Alignment of aligned allocations, one cache line.
+#define PLATFORM_ALLOCATION_ALIGNMENT 64
+
+/**
+ * Allocates memory.
+ *
+ * @param size The size in bytes.
+ * @param aligned When TRUE the block starts at a multiple of
+ * PLATFORM_ALLOCATION_ALIGNMENT. It must then be freed with aligned set too.
+ * @return The block, or NULL on failure.
+ */
 void *platform_allocate(u64 size, b8 aligned);
 void platform_free(void *block, b8 aligned);
 void *platform_zero_memory(void *block, u64 size);
@@ -22,6 +59,321 @@ void *platform_set_memory(void *dest, u8 value, u64 size);
 void platform_console_write(const char *message, u8 color);
 void platform_console_write_error(const char *message, u8 color);
 
+/**
+ * Opens a file for reading and writing, creating it if needed and discarding
+ * any existing contents. Suitable for memory-mapped writing.
+ *
+ * @param path The path of the file to open.
+ * @param out_file Receives the opened file.
+ * @return TRUE if the file was opened, FALSE otherwise.
+ */
+b8 platform_file_open_write(const char *path, platform_file *out_file);
+void platform_file_close(platform_file *file);
+
+// Grows (reserving disk space) or truncates the file to exactly size bytes.
+b8 platform_file_set_size(platform_file *file, u64 size);
+
+/**
+ * Maps a range of the file into memory for writing. Writes through the
+ * returned pointer go to the page cache and reach the file without a system
+ * call. The range must lie within the current file size.
+ *
+ * @param file The file to map.
+ * @param offset Start of the range. Must be a multiple of the page size.
+ * @param size Size of the range in bytes.
+ * @return A pointer to the mapped range, or NULL on failure.
+ */
+void *platform_file_map_write(platform_file *file, u64 offset, u64 size);
+void platform_file_unmap(void *memory, u64 size);
+
+b8 platform_file_rename(const char *old_path, const char *new_path);
+b8 platform_file_remove(const char *path);
+
+// Modification time of the file, in nanoseconds since an arbitrary epoch.
+b8 platform_file_get_modified_time(const char *path, u64 *out_time);
+
+// Copies a file, replacing the destination if it exists.
+b8 platform_file_copy(const char *source_path, const char *destination_path);
+
+// Opens an existing file for reading.
+b8 platform_file_open_read(const char *path, platform_file *out_file);
+
+b8 platform_file_get_size(platform_file *file, u64 *out_size);
+
+/**
+ * Reads from the given offset without moving any file position, so several
+ * threads can read the same file at once. Blocks until done.
+ *
+ * @return The number of bytes read, less than size at the end of the file,
+ * or -1 on failure.
+ */
+i64 platform_file_read(platform_file *file, u64 offset, void *buffer,
+                       u64 size);
+
+// How a read-only mapping will be accessed, so the OS can read ahead.
+typedef enum platform_file_access {
+  PLATFORM_FILE_ACCESS_NORMAL,
+  // Front to back: read ahead aggressively, drop pages once passed.
+  PLATFORM_FILE_ACCESS_SEQUENTIAL,
+  // Scattered: do not read ahead.
+  PLATFORM_FILE_ACCESS_RANDOM,
+  // All of it, soon: start reading it in now.
+  PLATFORM_FILE_ACCESS_WILL_NEED,
+} platform_file_access;
+
+/**
+ * Maps a range of the file into memory for reading, without copying it. Pages
+ * are read in from disk when first touched, so the first access to each can
+ * still block. Unmap with platform_file_unmap; the mapping stays valid after
+ * the file is closed.
+ *
+ * @param file The file to map.
+ * @param offset Start of the range. Must be a multiple of the page size.
+ * @param size Size of the range in bytes.
+ * @param access How the range will be read.
+ * @return A pointer to the mapped range, or NULL on failure.
+ */
+const void *platform_file_map_read(platform_file *file, u64 offset, u64 size,
+                                   platform_file_access access);
+
+typedef struct platform_dynamic_library {
+  // Platform-specific library handle.
+  void *internal_data;
+} platform_dynamic_library;
+
+/**
+ * Loads a shared library (.so or .dll).
+ *
+ * @param path The path of the library.
+ * @param out_library Receives the library.
+ * @return TRUE if the library was loaded, FALSE otherwise.
+ */
+b8 platform_dynamic_library_load(const char *path,
+                                 platform_dynamic_library *out_library);
+void platform_dynamic_library_unload(platform_dynamic_library *library);
+
+// Looks up an exported function by name. Returns NULL if there is none.
+void *platform_dynamic_library_load_function(platform_dynamic_library *library,
+                                             const char *name);
+
+/**
+ * Queue of asynchronous reads serviced by the kernel (io_uring on Linux),
+ * without any thread blocking on them. Not available everywhere; callers fall
+ * back to reading on threads of their own. Not thread safe.
+ */
+typedef struct platform_io_queue {
+  void *internal_data;
+} platform_io_queue;
+
+typedef struct platform_io_completion {
+  // As passed to platform_io_queue_read.
+  u64 user_data;
+  // Bytes read, or negative on failure.
+  i64 result;
+} platform_io_completion;
+
+/**
+ * Creates an asynchronous read queue.
+ *
+ * @param depth The most reads that can be in flight at once.
+ * @param out_queue Receives the queue.
+ * @return TRUE on success, FALSE if the OS does not support it.
+ */
+b8 platform_io_queue_create(u32 depth, platform_io_queue *out_queue);
+
+// Destroys the queue. Reads still in flight must have completed.
+void platform_io_queue_destroy(platform_io_queue *queue);
+
+/**
+ * Starts reading size bytes at offset into buffer. The file and buffer must
+ * stay valid until the read completes. Like any read, it may complete short,
+ * e.g. for sizes over 2 GiB.
+ *
+ * @return TRUE if the read was queued, FALSE if the queue is full.
+ */
+b8 platform_io_queue_read(platform_io_queue *queue, platform_file *file,
+                          u64 offset, void *buffer, u64 size, u64 user_data);
+
+/**
+ * Collects finished reads without waiting.
+ *
+ * @return The number of completions written to out_completions.
+ */
+u32 platform_io_queue_poll(platform_io_queue *queue,
+                           platform_io_completion *out_completions,
+                           u32 max_count);
+
 f64 platform_get_absolute_time();
 
 void platform_sleep(u64 ms);
+
+// Pass as a timeout to block until the wait is satisfied.
+#define PLATFORM_WAIT_INFINITE 0xFFFFFFFFFFFFFFFFULL
+
+// Entry point of a platform thread. The return value is the exit code.
+typedef u32 (*pfn_thread_start)(void *params);
+
+typedef struct platform_thread {
+  void *internal_data;
+  u64 thread_id;
+} platform_thread;
+
+typedef struct platform_semaphore {
+  void *internal_data;
+} platform_semaphore;
+
+// Size of the inline storage of mutexes and condition variables.
+#define PLATFORM_SYNC_STORAGE_SIZE 64
+
+/**
+ * Mutexes and condition variables keep the native object inline instead of
+ * behind an allocation, so they can be embedded in other structures and
+ * locking does not chase a pointer. They must not be moved once created.
+ */
+typedef struct platform_mutex {
+  _Alignas(8) u8 storage[PLATFORM_SYNC_STORAGE_SIZE];
+} platform_mutex;
+
+typedef struct platform_condition {
+  _Alignas(8) u8 storage[PLATFORM_SYNC_STORAGE_SIZE];
+} platform_condition;
+
+typedef struct platform_tls_key {
+  u64 handle;
+} platform_tls_key;
+
+// Thread-local storage for variables known at compile time. Use
+// platform_tls_key for per-thread values that are created at runtime.
+#ifdef _MSC_VER
+#define VTHREAD_LOCAL __declspec(thread)
+#else
+#define VTHREAD_LOCAL _Thread_local
+#endif
+
+/**
+ * Creates a new thread and immediately starts it running start_function.
+ *
+ * @param name The thread's name, as shown by debuggers and profilers. Can be
+ * NULL. Truncated to 15 characters on Linux.
+ * @param start_function The function to run on the new thread.
+ * @param params Passed through to start_function. can be NULL.
+ * @param out_thread Receives the handle of the created thread.
+ * @return TRUE if the thread was created, FALSE otherwise.
+ */
+b8 platform_thread_create(const char *name, pfn_thread_start start_function,
+                          void *params, platform_thread *out_thread);
+
+// Blocks until the thread exits, then releases its handle.
+void platform_thread_join(platform_thread *thread);
+
+// Gets a handle to the calling thread. It must not be joined.
+void platform_thread_current(platform_thread *out_thread);
+
+// Identifier of the calling thread, unique among running threads.
+u64 platform_thread_current_id();
+
+/**
+ * Restricts the thread to running on the given logical processors.
+ *
+ * @param thread The thread, e.g. from platform_thread_current.
+ * @param cpu_mask Bit i set allows logical processor i.
+ * @return TRUE if the affinity was applied, FALSE otherwise.
+ */
+b8 platform_thread_set_affinity(platform_thread *thread, u64 cpu_mask);
+
+// Gives up the rest of the calling thread's time slice.
+void platform_thread_yield();
+
+// Number of logical processors available to the process.
+u32 platform_get_processor_count();
+
+// Number of physical cores available to the process, not counting SMT
+// siblings.
+u32 platform_get_physical_core_count();
+
+// Instruction set extensions, as bits of platform_cpu_info.features.
+typedef enum platform_cpu_feature {
+  PLATFORM_CPU_FEATURE_SSE4_2 = 1 << 0,
+  PLATFORM_CPU_FEATURE_AVX = 1 << 1,
+  PLATFORM_CPU_FEATURE_AVX2 = 1 << 2,
+  PLATFORM_CPU_FEATURE_FMA = 1 << 3,
+  PLATFORM_CPU_FEATURE_AVX512F = 1 << 4,
+  PLATFORM_CPU_FEATURE_NEON = 1 << 5,
+} platform_cpu_feature;
+
+typedef struct platform_cpu_info {
+  char model_name[64];
+  // Processors and cores available to the process.
+  u32 logical_core_count;
+  u32 physical_core_count;
+  // Hardware threads per physical core, 1 without SMT.
+  u32 threads_per_core;
+  u32 cache_line_size;
+  // Cache sizes in bytes as seen by one core, 0 if unknown. L2 and L3 may be
+  // shared with other cores.
+  u32 l1_data_cache_size;
+  u32 l2_cache_size;
+  u32 l3_cache_size;
+  // Bitwise or of platform_cpu_feature. Only set when the OS supports the
+  // extension too, so code using it can be dispatched to directly.
+  u32 features;
+} platform_cpu_info;
+
+/**
+ * Describes the CPU: topology, caches and instruction set extensions. Reads
+ * the system on every call, so callers should keep the result.
+ *
+ * @param out_info Receives the description.
+ */
+void platform_get_cpu_info(platform_cpu_info *out_info);
+
+b8 platform_mutex_create(platform_mutex *out_mutex);
+void platform_mutex_destroy(platform_mutex *mutex);
+void platform_mutex_lock(platform_mutex *mutex);
+// Returns TRUE if the mutex was acquired without blocking.
+b8 platform_mutex_try_lock(platform_mutex *mutex);
+void platform_mutex_unlock(platform_mutex *mutex);
+
+b8 platform_condition_create(platform_condition *out_condition);
+void platform_condition_destroy(platform_condition *condition);
+
+/**
+ * Atomically releases the mutex and waits for the condition to be signalled,
+ * then reacquires the mutex. Wakeups can be spurious, so callers must recheck
+ * their predicate in a loop.
+ *
+ * @param condition The condition to wait on.
+ * @param mutex The mutex protecting the predicate. Must be held by the caller.
+ * @param timeout_ms Maximum time to wait, or PLATFORM_WAIT_INFINITE.
+ * @return TRUE if woken, FALSE on timeout or error.
+ */
+b8 platform_condition_wait(platform_condition *condition, platform_mutex *mutex,
+                           u64 timeout_ms);
+
+// Wakes one thread waiting on the condition.
+void platform_condition_signal(platform_condition *condition);
+
+// Wakes every thread waiting on the condition.
+void platform_condition_broadcast(platform_condition *condition);
+
+b8 platform_semaphore_create(u32 initial_count,
+                             platform_semaphore *out_semaphore);
+void platform_semaphore_destroy(platform_semaphore *semaphore);
+
+// Increments the semaphore count, waking one waiter if there is any.
+void platform_semaphore_signal(platform_semaphore *semaphore);
+
+/**
+ * Waits for the semaphore count to be non-zero, then decrements it.
+ *
+ * @param semaphore The semaphore to wait on.
+ * @param timeout_ms Maximum time to wait, or PLATFORM_WAIT_INFINITE.
+ * @return TRUE if the semaphore was acquired, FALSE on timeout or error.
+ */
+b8 platform_semaphore_wait(platform_semaphore *semaphore, u64 timeout_ms);
+
+b8 platform_tls_create(platform_tls_key *out_key);
+void platform_tls_destroy(platform_tls_key *key);
+// Gets the calling thread's value for the key. NULL until set.
+void *platform_tls_get(platform_tls_key *key);
+void platform_tls_set(platform_tls_key *key, void *value);
@@ -1,3 +1,6 @@
+// Needed for thread names, affinity and adaptive mutexes.
+#define _GNU_SOURCE
+
 #include <platform/platform.h>
 
 #include <defines.h>
@@ -7,11 +10,27 @@
 #include <core/event.h>
 #include <core/input.h>
 #include <core/logger.h>
-
+#include <platform/atomic.h>
+#include <platform/cpuid.h>
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/time.h>
+#include <unistd.h>
 
 #if _POSIX_C_SOURCE >= 199309L
 #include <time.h>
@@ -24,14 +43,32 @@
 #include <X11/Xlib.h>
 #include <X11/keysym.h>
 #include <xcb/xcb.h>
+#include <xkbcommon/xkbcommon-x11.h>
+#include <xkbcommon/xkbcommon.h>
+
+// X keycodes are 8 bits wide.
+#define KEYCODE_TABLE_SIZE 256
 
 typedef struct internal_state {
+  // No X connection or window exists when running headless.
+  b8 headless;
   Display *display;
   xcb_connection_t *connection;
   xcb_window_t window;
   xcb_screen_t *screen;
   xcb_atom_t wm_protocols;
   xcb_atom_t wm_delete_window;
+  u32 width;
+  u32 height;
+  // Last visibility reported through EVENT_CODE_WINDOW_VISIBILITY_CHANGED.
+  b8 is_mapped;
+  b8 is_obscured;
+  b8 has_focus;
+  struct xkb_context *xkb_context;
+  // Core keyboard device, or -1 when the XKB extension is unavailable.
+  i32 xkb_device_id;
+  // Engine key for each X keycode, rebuilt whenever the keymap changes.
+  keys keycode_table[KEYCODE_TABLE_SIZE];
 } internal_state;
 
 keys translate_keycode(u32 x_keycode);
@@ -39,13 +76,86 @@ keys translate_keycode(u32 x_keycode);
 static const char *color_strings[] = {"0;41", "1;31", "1;33",
                                       "1;32", "1;34", "1;30"};
 
+/**
+ * Fills the keycode table from the base (unshifted) keysym of every key in
+ * the first layout, so that translating a key event is a single lookup.
+ */
+static void build_keycode_table(internal_state *state) {
+  platform_zero_memory(state->keycode_table, sizeof(state->keycode_table));
+
+  struct xkb_keymap *keymap = NULL;
+  if (state->xkb_device_id >= 0) {
+    keymap = xkb_x11_keymap_new_from_device(
+        state->xkb_context, state->connection, state->xkb_device_id,
+        XKB_KEYMAP_COMPILE_NO_FLAGS);
+  }
+
+  if (!keymap) {
+    // Without XKB, ask Xlib once per keycode instead.
+    VWARN_CAT(LOG_CATEGORY_PLATFORM,
+              "Failed to load the XKB keymap, falling back to Xlib.");
+    for (u32 keycode = 8; keycode < KEYCODE_TABLE_SIZE; ++keycode) {
+      KeySym keysym =
+          XkbKeycodeToKeysym(state->display, (KeyCode)keycode, 0, 0);
+      state->keycode_table[keycode] = translate_keycode(keysym);
+    }
+    return;
+  }
+
+  xkb_keycode_t min_keycode = xkb_keymap_min_keycode(keymap);
+  xkb_keycode_t max_keycode = xkb_keymap_max_keycode(keymap);
+  if (max_keycode >= KEYCODE_TABLE_SIZE) {
+    max_keycode = KEYCODE_TABLE_SIZE - 1;
+  }
+
+  for (xkb_keycode_t keycode = min_keycode; keycode <= max_keycode; ++keycode) {
+    const xkb_keysym_t *keysyms = NULL;
+    if (xkb_keymap_key_get_syms_by_level(keymap, keycode, 0, 0, &keysyms) > 0) {
+      // XKB keysyms share their values with X11 keysyms.
+      state->keycode_table[keycode] = translate_keycode(keysyms[0]);
+    }
+  }
+
+  xkb_keymap_unref(keymap);
+}
+
+// Set from a signal handler when running headless.
+static volatile sig_atomic_t quit_requested = 0;
+
+static void handle_termination_signal(i32 signal_number) {
+  quit_requested = 1;
+}
+
 b8 platform_init(platform_state *plat_state, const char *title, u32 x, u32 y,
-                 u32 width, u32 height) {
+                 u32 width, u32 height, b8 headless) {
   plat_state->internal_state = platform_allocate(sizeof(internal_state), FALSE);
   internal_state *state = (internal_state *)plat_state->internal_state;
+  platform_zero_memory(state, sizeof(internal_state));
+  state->headless = headless;
+
+  if (headless) {
+    // Without a window, termination signals are the way to ask for a quit.
+    struct sigaction action;
+    platform_zero_memory(&action, sizeof(action));
+    action.sa_handler = handle_termination_signal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    VINFO_CAT(LOG_CATEGORY_PLATFORM, "Running headless, no window created.");
+    return TRUE;
+  }
 
   // connect to X server
   state->display = XOpenDisplay(NULL);
+  if (!state->display) {
+    VFATAL_CAT(LOG_CATEGORY_PLATFORM,
+               "Failed to open X display. Set VIVID_HEADLESS=1 to run "
+               "without a window.");
+    platform_free(plat_state->internal_state, FALSE);
+    plat_state->internal_state = NULL;
+    return FALSE;
+  }
 
   XAutoRepeatOff(state->display);
 
@@ -53,10 +163,22 @@ b8 platform_init(platform_state *plat_state, const char *title, u32 x, u32 y,
   state->connection = XGetXCBConnection(state->display);
 
   if (xcb_connection_has_error(state->connection)) {
-    VFATAL("Failed to connect to X server via XCB.");
+    VFATAL_CAT(LOG_CATEGORY_PLATFORM, "Failed to connect to X server via XCB.");
     return FALSE;
   }
 
+  state->xkb_context = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
+  state->xkb_device_id = -1;
+  if (state->xkb_context &&
+      xkb_x11_setup_xkb_extension(
+          state->connection, XKB_X11_MIN_MAJOR_XKB_VERSION,
+          XKB_X11_MIN_MINOR_XKB_VERSION, XKB_X11_SETUP_XKB_EXTENSION_NO_FLAGS,
+          NULL, NULL, NULL, NULL)) {
+    state->xkb_device_id =
+        xkb_x11_get_core_keyboard_device_id(state->connection);
+  }
+  build_keycode_table(state);
+
   const xcb_setup_t *setup = xcb_get_setup(state->connection);
   xcb_screen_iterator_t iter = xcb_setup_roots_iterator(setup);
   for (i32 i = 0; i < screen_p; ++i) {
@@ -64,6 +186,8 @@ b8 platform_init(platform_state *plat_state, const char *title, u32 x, u32 y,
   }
 
   state->screen = iter.data;
+  state->width = width;
+  state->height = height;
 
   state->window = xcb_generate_id(state->connection);
 
@@ -73,7 +197,9 @@ b8 platform_init(platform_state *plat_state, const char *title, u32 x, u32 y,
                      XCB_EVENT_MASK_BUTTON_RELEASE | XCB_EVENT_MASK_KEY_PRESS |
                      XCB_EVENT_MASK_KEY_RELEASE | XCB_EVENT_MASK_EXPOSURE |
                      XCB_EVENT_MASK_POINTER_MOTION |
-                     XCB_EVENT_MASK_STRUCTURE_NOTIFY;
+                     XCB_EVENT_MASK_STRUCTURE_NOTIFY |
+                     XCB_EVENT_MASK_VISIBILITY_CHANGE |
+                     XCB_EVENT_MASK_FOCUS_CHANGE;
 
   u32 value_list[] = {state->screen->black_pixel, event_values};
 
@@ -112,7 +238,8 @@ b8 platform_init(platform_state *plat_state, const char *title, u32 x, u32 y,
   // flush the request
   i32 stream_result = xcb_flush(state->connection);
   if (stream_result <= 0) {
-    VFATAL("Failed to flush XCB connection: %d", stream_result);
+    VFATAL_CAT(LOG_CATEGORY_PLATFORM, "Failed to flush XCB connection: %d",
+               stream_result);
     return FALSE;
   }
 
@@ -122,18 +249,39 @@ b8 platform_init(platform_state *plat_state, const char *title, u32 x, u32 y,
 void platform_shutdown(platform_state *plat_state) {
   internal_state *state = (internal_state *)plat_state->internal_state;
 
+  if (state->headless) {
+    platform_free(plat_state->internal_state, FALSE);
+    return;
+  }
+
   xcb_destroy_window(state->connection, state->window);
 
   XAutoRepeatOn(state->display);
 
+  if (state->xkb_context) {
+    xkb_context_unref(state->xkb_context);
+  }
+
   XCloseDisplay(state->display);
 
   platform_free(plat_state->internal_state, FALSE);
 }
 
+// Fires EVENT_CODE_WINDOW_VISIBILITY_CHANGED with the current state.
+static void fire_visibility_changed(internal_state *state) {
+  event_context context = {0};
+  context.data.u8[0] = state->is_mapped && !state->is_obscured;
+  context.data.u8[1] = state->has_focus;
+  event_fire(EVENT_CODE_WINDOW_VISIBILITY_CHANGED, NULL, context);
+}
+
 b8 platform_pump_messages(platform_state *plat_state) {
   internal_state *state = (internal_state *)plat_state->internal_state;
 
+  if (state->headless) {
+    return !quit_requested;
+  }
+
   xcb_generic_event_t *event;
   xcb_client_message_event_t *cm;
 
@@ -145,13 +293,20 @@ b8 platform_pump_messages(platform_state *plat_state) {
     case XCB_KEY_RELEASE: {
       xcb_key_press_event_t *kp = (xcb_key_press_event_t *)event;
       b8 is_down = kp->response_type == XCB_KEY_PRESS;
-      xcb_keycode_t keycode = kp->detail;
-      KeySym keysym = XkbKeycodeToKeysym(state->display, (KeyCode)keycode, 0,
-                                         keycode & ShiftMask ? 1 : 0);
 
-      keys key = translate_keycode(keysym);
+      keys key = state->keycode_table[kp->detail];
+      if (key) {
+        input_process_key(key, is_down);
+      }
+    } break;
 
-      input_process_key(key, is_down);
+    case XCB_MAPPING_NOTIFY: {
+      xcb_mapping_notify_event_t *mapping = (xcb_mapping_notify_event_t *)event;
+      if (mapping->request == XCB_MAPPING_KEYBOARD) {
+        VDEBUG_CAT(LOG_CATEGORY_PLATFORM,
+                   "Keyboard mapping changed, rebuilding keycode table.");
+        build_keycode_table(state);
+      }
     } break;
 
     case XCB_BUTTON_PRESS:
@@ -183,7 +338,56 @@ b8 platform_pump_messages(platform_state *plat_state) {
     } break;
 
     case XCB_CONFIGURE_NOTIFY: {
-      // TODO: window resize
+      xcb_configure_notify_event_t *configure =
+          (xcb_configure_notify_event_t *)event;
+
+      // Also sent for moves, so only report actual size changes.
+      if (configure->width != state->width ||
+          configure->height != state->height) {
+        state->width = configure->width;
+        state->height = configure->height;
+
+        event_context context = {0};
+        context.data.u16[0] = configure->width;
+        context.data.u16[1] = configure->height;
+        event_fire(EVENT_CODE_WINDOW_RESIZED, NULL, context);
+      }
+    } break;
+
+    case XCB_MAP_NOTIFY:
+    case XCB_UNMAP_NOTIFY: {
+      // Unmapped when minimized (iconified) or hidden by the window manager.
+      b8 is_mapped = (event->response_type & ~0x80) == XCB_MAP_NOTIFY;
+      if (is_mapped != state->is_mapped) {
+        state->is_mapped = is_mapped;
+        fire_visibility_changed(state);
+      }
+    } break;
+
+    case XCB_VISIBILITY_NOTIFY: {
+      xcb_visibility_notify_event_t *visibility =
+          (xcb_visibility_notify_event_t *)event;
+      b8 is_obscured = visibility->state == XCB_VISIBILITY_FULLY_OBSCURED;
+      if (is_obscured != state->is_obscured) {
+        state->is_obscured = is_obscured;
+        fire_visibility_changed(state);
+      }
+    } break;
+
+    case XCB_FOCUS_IN:
+    case XCB_FOCUS_OUT: {
+      xcb_focus_in_event_t *focus = (xcb_focus_in_event_t *)event;
+      // Ignore the transient focus changes caused by keyboard grabs.
+      if (focus->mode == XCB_NOTIFY_MODE_GRAB ||
+          focus->mode == XCB_NOTIFY_MODE_UNGRAB) {
+        break;
+      }
+
+      b8 has_focus = (event->response_type & ~0x80) == XCB_FOCUS_IN;
+      if (has_focus != state->has_focus) {
+        state->has_focus = has_focus;
+        fire_visibility_changed(state);
+      }
     } break;
 
     case XCB_CLIENT_MESSAGE: {
@@ -202,7 +406,43 @@ b8 platform_pump_messages(platform_state *plat_state) {
   return !quit;
 }
 
-void *platform_allocate(u64 size, b8 aligned) { return malloc(size); }
+void platform_wait_messages(platform_state *plat_state, u64 timeout_ms) {
+  internal_state *state = (internal_state *)plat_state->internal_state;
+
+  i32 timeout = timeout_ms >= (u64)INT32_MAX ? -1 : (i32)timeout_ms;
+
+  if (state->headless) {
+    // Nothing to wait on but signals, which interrupt the sleep anyway.
+    if (timeout >= 0 && !quit_requested) {
+      platform_sleep(timeout_ms);
+    }
+    return;
+  }
+
+  // platform_pump_messages drains XCB's event queue, so anything new arrives
+  // on the socket. Events XCB happens to read while waiting for a reply in
+  // between are only picked up once the timeout expires.
+  xcb_flush(state->connection);
+
+  struct pollfd descriptor = {
+      .fd = xcb_get_file_descriptor(state->connection),
+      .events = POLLIN,
+  };
+  poll(&descriptor, 1, timeout);
+}
+
+void *platform_allocate(u64 size, b8 aligned) {
+  if (!aligned) {
+    return malloc(size);
+  }
+
+  void *block = NULL;
+  if (posix_memalign(&block, PLATFORM_ALLOCATION_ALIGNMENT, size) != 0) {
+    return NULL;
+  }
+  return block;
+}
+// posix_memalign blocks are released with free as well.
 void platform_free(void *block, b8 aligned) { free(block); }
 void *platform_zero_memory(void *block, u64 size) {
   return platform_set_memory(block, 0, size);
@@ -221,6 +461,424 @@ void platform_console_write_error(const char *message, u8 color) {
   fprintf(stderr, "\033[%sm%s\033[0m", color_strings[color], message);
 }
 
+b8 platform_file_open_write(const char *path, platform_file *out_file) {
+  out_file->is_valid = FALSE;
+
+  i32 fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    VERROR_CAT(LOG_CATEGORY_PLATFORM, "Failed to open file '%s': %s", path,
+               strerror(errno));
+    return FALSE;
+  }
+
+  out_file->handle = (u64)fd;
+  out_file->is_valid = TRUE;
+  return TRUE;
+}
+
+void platform_file_close(platform_file *file) {
+  if (file->is_valid) {
+    close((i32)file->handle);
+    file->is_valid = FALSE;
+  }
+}
+
+b8 platform_file_set_size(platform_file *file, u64 size) {
+  i32 fd = (i32)file->handle;
+
+  struct stat info;
+  if (fstat(fd, &info) != 0) {
+    return FALSE;
+  }
+
+  // Allocate the blocks up front when growing, so that running out of disk
+  // space is reported here rather than as a SIGBUS on a mapped write.
+  if (size > (u64)info.st_size) {
+    return posix_fallocate(fd, info.st_size, size - info.st_size) == 0;
+  }
+
+  return ftruncate(fd, size) == 0;
+}
+
+void *platform_file_map_write(platform_file *file, u64 offset, u64 size) {
+  void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                      (i32)file->handle, offset);
+  if (memory == MAP_FAILED) {
+    return NULL;
+  }
+
+  return memory;
+}
+
+void platform_file_unmap(void *memory, u64 size) {
+  if (memory) {
+    munmap(memory, size);
+  }
+}
+
+b8 platform_file_rename(const char *old_path, const char *new_path) {
+  return rename(old_path, new_path) == 0;
+}
+
+b8 platform_file_remove(const char *path) { return unlink(path) == 0; }
+
+b8 platform_file_get_modified_time(const char *path, u64 *out_time) {
+  struct stat info;
+  if (stat(path, &info) != 0) {
+    return FALSE;
+  }
+
+  *out_time = (u64)info.st_mtim.tv_sec * 1000000000ull + info.st_mtim.tv_nsec;
+  return TRUE;
+}
+
+b8 platform_file_copy(const char *source_path, const char *destination_path) {
+  i32 source = open(source_path, O_RDONLY | O_CLOEXEC);
+  if (source < 0) {
+    return FALSE;
+  }
+
+  struct stat info;
+  if (fstat(source, &info) != 0) {
+    close(source);
+    return FALSE;
+  }
+
+  i32 flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+  i32 destination = open(destination_path, flags, info.st_mode);
+  if (destination < 0) {
+    close(source);
+    return FALSE;
+  }
+
+  // Copies within the kernel, without a user space buffer.
+  off_t offset = 0;
+  b8 result = TRUE;
+  while (offset < info.st_size) {
+    ssize_t copied =
+        sendfile(destination, source, &offset, info.st_size - offset);
+    if (copied <= 0) {
+      if (copied < 0 && errno == EINTR) {
+        continue;
+      }
+      result = FALSE;
+      break;
+    }
+  }
+
+  close(destination);
+  close(source);
+  return result;
+}
+
+b8 platform_file_open_read(const char *path, platform_file *out_file) {
+  out_file->is_valid = FALSE;
+
+  i32 fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    VERROR_CAT(LOG_CATEGORY_PLATFORM, "Failed to open file '%s': %s", path,
+               strerror(errno));
+    return FALSE;
+  }
+
+  out_file->handle = (u64)fd;
+  out_file->is_valid = TRUE;
+  return TRUE;
+}
+
+b8 platform_file_get_size(platform_file *file, u64 *out_size) {
+  struct stat info;
+  if (fstat((i32)file->handle, &info) != 0) {
+    return FALSE;
+  }
+
+  *out_size = (u64)info.st_size;
+  return TRUE;
+}
+
+i64 platform_file_read(platform_file *file, u64 offset, void *buffer,
+                       u64 size) {
+  u64 total = 0;
+  while (total < size) {
+    ssize_t result = pread((i32)file->handle, (u8 *)buffer + total,
+                           size - total, (off_t)(offset + total));
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    if (result == 0) {
+      break;
+    }
+    total += (u64)result;
+  }
+
+  return (i64)total;
+}
+
+const void *platform_file_map_read(platform_file *file, u64 offset, u64 size,
+                                   platform_file_access access) {
+  void *memory =
+      mmap(NULL, size, PROT_READ, MAP_PRIVATE, (i32)file->handle, offset);
+  if (memory == MAP_FAILED) {
+    return NULL;
+  }
+
+  i32 advice = MADV_NORMAL;
+  switch (access) {
+  case PLATFORM_FILE_ACCESS_NORMAL:
+    break;
+  case PLATFORM_FILE_ACCESS_SEQUENTIAL:
+    advice = MADV_SEQUENTIAL;
+    break;
+  case PLATFORM_FILE_ACCESS_RANDOM:
+    advice = MADV_RANDOM;
+    break;
+  case PLATFORM_FILE_ACCESS_WILL_NEED:
+    advice = MADV_WILLNEED;
+    break;
+  }
+  // Only a hint, so failing is harmless.
+  if (advice != MADV_NORMAL) {
+    madvise(memory, size, advice);
+  }
+
+  return memory;
+}
+
+b8 platform_dynamic_library_load(const char *path,
+                                 platform_dynamic_library *out_library) {
+  out_library->internal_data = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+  if (!out_library->internal_data) {
+    VERROR_CAT(LOG_CATEGORY_PLATFORM, "Failed to load library '%s': %s", path,
+               dlerror());
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+void platform_dynamic_library_unload(platform_dynamic_library *library) {
+  if (library->internal_data) {
+    dlclose(library->internal_data);
+    library->internal_data = NULL;
+  }
+}
+
+void *platform_dynamic_library_load_function(platform_dynamic_library *library,
+                                             const char *name) {
+  return dlsym(library->internal_data, name);
+}
+
+/**
+ * An io_uring instance, driven with raw system calls. The submission and
+ * completion rings are shared with the kernel, which consumes submissions
+ * from sq_head and produces completions at cq_tail.
+ */
+typedef struct linux_io_queue {
+  i32 ring_fd;
+  u32 sq_entries;
+
+  atomic_u32 *sq_head;
+  atomic_u32 *sq_tail;
+  u32 sq_mask;
+  u32 *sq_array;
+  struct io_uring_sqe *sqes;
+
+  atomic_u32 *cq_head;
+  atomic_u32 *cq_tail;
+  u32 cq_mask;
+  struct io_uring_cqe *cqes;
+
+  void *sq_ring;
+  u64 sq_ring_size;
+  void *cq_ring;
+  u64 cq_ring_size;
+  u64 sqes_size;
+} linux_io_queue;
+
+// Whether the kernel supports plain reads (5.6 and later) on the ring.
+static b8 io_uring_supports_read(i32 ring_fd) {
+  u64 probe_size =
+      sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+  struct io_uring_probe *probe = platform_allocate(probe_size, FALSE);
+  platform_zero_memory(probe, probe_size);
+
+  b8 supported = syscall(__NR_io_uring_register, ring_fd,
+                         IORING_REGISTER_PROBE, probe, 256) == 0 &&
+                 probe->last_op >= IORING_OP_READ &&
+                 (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED);
+
+  platform_free(probe, FALSE);
+  return supported;
+}
+
+static void io_queue_unmap(linux_io_queue *queue) {
+  if (queue->sqes) {
+    munmap(queue->sqes, queue->sqes_size);
+  }
+  if (queue->cq_ring && queue->cq_ring != queue->sq_ring) {
+    munmap(queue->cq_ring, queue->cq_ring_size);
+  }
+  if (queue->sq_ring) {
+    munmap(queue->sq_ring, queue->sq_ring_size);
+  }
+}
+
+b8 platform_io_queue_create(u32 depth, platform_io_queue *out_queue) {
+  out_queue->internal_data = NULL;
+
+  struct io_uring_params params;
+  platform_zero_memory(&params, sizeof(params));
+  i32 ring_fd = (i32)syscall(__NR_io_uring_setup, depth, &params);
+  if (ring_fd < 0) {
+    // Commonly blocked by container seccomp profiles.
+    VDEBUG_CAT(LOG_CATEGORY_PLATFORM, "io_uring is unavailable: %s",
+               strerror(errno));
+    return FALSE;
+  }
+
+  if (!io_uring_supports_read(ring_fd)) {
+    VDEBUG_CAT(LOG_CATEGORY_PLATFORM, "io_uring does not support reads.");
+    close(ring_fd);
+    return FALSE;
+  }
+
+  linux_io_queue *queue = platform_allocate(sizeof(linux_io_queue), FALSE);
+  platform_zero_memory(queue, sizeof(linux_io_queue));
+  queue->ring_fd = ring_fd;
+  queue->sq_entries = params.sq_entries;
+
+  queue->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(u32);
+  queue->cq_ring_size =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  // Newer kernels map both rings with a single mmap.
+  b8 single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single_mmap && queue->cq_ring_size > queue->sq_ring_size) {
+    queue->sq_ring_size = queue->cq_ring_size;
+  }
+
+  queue->sq_ring =
+      mmap(NULL, queue->sq_ring_size, PROT_READ | PROT_WRITE,
+           MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+  if (queue->sq_ring == MAP_FAILED) {
+    queue->sq_ring = NULL;
+  }
+  if (single_mmap) {
+    queue->cq_ring = queue->sq_ring;
+  } else {
+    queue->cq_ring =
+        mmap(NULL, queue->cq_ring_size, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+    if (queue->cq_ring == MAP_FAILED) {
+      queue->cq_ring = NULL;
+    }
+  }
+  queue->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+  queue->sqes = mmap(NULL, queue->sqes_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+  if (queue->sqes == MAP_FAILED) {
+    queue->sqes = NULL;
+  }
+
+  if (!queue->sq_ring || !queue->cq_ring || !queue->sqes) {
+    VERROR_CAT(LOG_CATEGORY_PLATFORM, "Failed to map the io_uring rings.");
+    io_queue_unmap(queue);
+    close(ring_fd);
+    platform_free(queue, FALSE);
+    return FALSE;
+  }
+
+  u8 *sq_ring = queue->sq_ring;
+  queue->sq_head = (atomic_u32 *)(sq_ring + params.sq_off.head);
+  queue->sq_tail = (atomic_u32 *)(sq_ring + params.sq_off.tail);
+  queue->sq_mask = *(u32 *)(sq_ring + params.sq_off.ring_mask);
+  queue->sq_array = (u32 *)(sq_ring + params.sq_off.array);
+
+  u8 *cq_ring = queue->cq_ring;
+  queue->cq_head = (atomic_u32 *)(cq_ring + params.cq_off.head);
+  queue->cq_tail = (atomic_u32 *)(cq_ring + params.cq_off.tail);
+  queue->cq_mask = *(u32 *)(cq_ring + params.cq_off.ring_mask);
+  queue->cqes = (struct io_uring_cqe *)(cq_ring + params.cq_off.cqes);
+
+  out_queue->internal_data = queue;
+  return TRUE;
+}
+
+void platform_io_queue_destroy(platform_io_queue *queue) {
+  linux_io_queue *io = queue->internal_data;
+  if (!io) {
+    return;
+  }
+
+  io_queue_unmap(io);
+  close(io->ring_fd);
+  platform_free(io, FALSE);
+  queue->internal_data = NULL;
+}
+
+// Hands queued submissions the kernel has not taken yet to the kernel.
+static void io_queue_submit(linux_io_queue *io) {
+  u32 pending = vatomic_load_u32(io->sq_tail, VMEMORY_ORDER_RELAXED) -
+                vatomic_load_u32(io->sq_head, VMEMORY_ORDER_ACQUIRE);
+  if (pending) {
+    // On failure, e.g. EAGAIN, the entries stay queued for the next call.
+    syscall(__NR_io_uring_enter, io->ring_fd, pending, 0, 0, NULL, 0);
+  }
+}
+
+b8 platform_io_queue_read(platform_io_queue *queue, platform_file *file,
+                          u64 offset, void *buffer, u64 size, u64 user_data) {
+  linux_io_queue *io = queue->internal_data;
+
+  u32 tail = vatomic_load_u32(io->sq_tail, VMEMORY_ORDER_RELAXED);
+  u32 head = vatomic_load_u32(io->sq_head, VMEMORY_ORDER_ACQUIRE);
+  if (tail - head >= io->sq_entries) {
+    return FALSE;
+  }
+
+  u32 index = tail & io->sq_mask;
+  struct io_uring_sqe *sqe = &io->sqes[index];
+  platform_zero_memory(sqe, sizeof(struct io_uring_sqe));
+  sqe->opcode = IORING_OP_READ;
+  sqe->fd = (i32)file->handle;
+  sqe->off = offset;
+  sqe->addr = (u64)buffer;
+  // The kernel reads at most this much at once anyway; the caller sees a
+  // short read.
+  sqe->len = size > 0x7FFFF000 ? 0x7FFFF000 : (u32)size;
+  sqe->user_data = user_data;
+  io->sq_array[index] = index;
+
+  // Publishes the entry to the kernel.
+  vatomic_store_u32(io->sq_tail, tail + 1, VMEMORY_ORDER_RELEASE);
+  io_queue_submit(io);
+  return TRUE;
+}
+
+u32 platform_io_queue_poll(platform_io_queue *queue,
+                           platform_io_completion *out_completions,
+                           u32 max_count) {
+  linux_io_queue *io = queue->internal_data;
+  io_queue_submit(io);
+
+  u32 head = vatomic_load_u32(io->cq_head, VMEMORY_ORDER_RELAXED);
+  u32 tail = vatomic_load_u32(io->cq_tail, VMEMORY_ORDER_ACQUIRE);
+  u32 count = 0;
+  while (head != tail && count < max_count) {
+    struct io_uring_cqe *cqe = &io->cqes[head & io->cq_mask];
+    out_completions[count].user_data = cqe->user_data;
+    out_completions[count].result = cqe->res;
+    count++;
+    head++;
+  }
+
+  // Hands the consumed entries back to the kernel.
+  vatomic_store_u32(io->cq_head, head, VMEMORY_ORDER_RELEASE);
+  return count;
+}
+
 f64 platform_get_absolute_time() {
   struct timespec now;
   clock_gettime(CLOCK_MONOTONIC, &now);
@@ -242,6 +900,436 @@ void platform_sleep(u64 ms) {
 #endif
 }
 
+// Linux limits thread names to 16 bytes including the terminator.
+#define THREAD_NAME_MAX_LENGTH 16
+
+STATIC_ASSERT(sizeof(pthread_mutex_t) <= PLATFORM_SYNC_STORAGE_SIZE,
+              pthread_mutex_fits_platform_mutex);
+STATIC_ASSERT(sizeof(pthread_cond_t) <= PLATFORM_SYNC_STORAGE_SIZE,
+              pthread_cond_fits_platform_condition);
+
+typedef struct linux_thread_start {
+  pfn_thread_start start_function;
+  void *params;
+  char name[THREAD_NAME_MAX_LENGTH];
+} linux_thread_start;
+
+// Adapts the engine thread signature to the one pthreads expects.
+static void *linux_thread_trampoline(void *arg) {
+  linux_thread_start start = *(linux_thread_start *)arg;
+  platform_free(arg, FALSE);
+
+  if (start.name[0]) {
+    pthread_setname_np(pthread_self(), start.name);
+  }
+
+  u32 exit_code = start.start_function(start.params);
+  return (void *)(u64)exit_code;
+}
+
+b8 platform_thread_create(const char *name, pfn_thread_start start_function,
+                          void *params, platform_thread *out_thread) {
+  if (!start_function || !out_thread) {
+    return FALSE;
+  }
+
+  linux_thread_start *start =
+      platform_allocate(sizeof(linux_thread_start), FALSE);
+  platform_zero_memory(start, sizeof(linux_thread_start));
+  start->start_function = start_function;
+  start->params = params;
+  if (name) {
+    strncpy(start->name, name, THREAD_NAME_MAX_LENGTH - 1);
+  }
+
+  pthread_t thread;
+  i32 result = pthread_create(&thread, NULL, linux_thread_trampoline, start);
+  if (result != 0) {
+    VERROR_CAT(LOG_CATEGORY_PLATFORM, "Failed to create thread '%s': %s",
+               name ? name : "", strerror(result));
+    platform_free(start, FALSE);
+    return FALSE;
+  }
+
+  out_thread->thread_id = (u64)thread;
+  out_thread->internal_data = NULL;
+  return TRUE;
+}
+
+void platform_thread_join(platform_thread *thread) {
+  if (!thread || !thread->thread_id) {
+    return;
+  }
+
+  pthread_join((pthread_t)thread->thread_id, NULL);
+  thread->thread_id = 0;
+}
+
+void platform_thread_current(platform_thread *out_thread) {
+  out_thread->thread_id = (u64)pthread_self();
+  out_thread->internal_data = NULL;
+}
+
+u64 platform_thread_current_id() { return (u64)pthread_self(); }
+
+b8 platform_thread_set_affinity(platform_thread *thread, u64 cpu_mask) {
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (u32 i = 0; i < 64; ++i) {
+    if (cpu_mask & (1ULL << i)) {
+      CPU_SET(i, &cpu_set);
+    }
+  }
+
+  i32 result = pthread_setaffinity_np((pthread_t)thread->thread_id,
+                                      sizeof(cpu_set_t), &cpu_set);
+  if (result != 0) {
+    VWARN_CAT(LOG_CATEGORY_PLATFORM, "Failed to set thread affinity: %s",
+              strerror(result));
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+void platform_thread_yield() { sched_yield(); }
+
+u32 platform_get_processor_count() {
+  cpu_set_t cpu_set;
+  if (sched_getaffinity(0, sizeof(cpu_set_t), &cpu_set) == 0) {
+    return (u32)CPU_COUNT(&cpu_set);
+  }
+
+  i64 count = sysconf(_SC_NPROCESSORS_ONLN);
+  return count > 0 ? (u32)count : 1;
+}
+
+// Reads a single unsigned integer from a sysfs file.
+static b8 read_sysfs_u32(const char *path, u32 *out_value) {
+  FILE *file = fopen(path, "r");
+  if (!file) {
+    return FALSE;
+  }
+
+  b8 result = fscanf(file, "%u", out_value) == 1;
+  fclose(file);
+  return result;
+}
+
+u32 platform_get_physical_core_count() {
+  cpu_set_t cpu_set;
+  if (sched_getaffinity(0, sizeof(cpu_set_t), &cpu_set) != 0) {
+    return platform_get_processor_count();
+  }
+
+  // SMT siblings share a (package, core) pair, so count the distinct pairs.
+  u64 cores[CPU_SETSIZE];
+  u32 core_count = 0;
+  for (u32 cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (!CPU_ISSET(cpu, &cpu_set)) {
+      continue;
+    }
+
+    char path[128];
+    u32 package_id = 0;
+    u32 core_id = 0;
+    snprintf(path, sizeof(path),
+             "/sys/devices/system/cpu/cpu%u/topology/physical_package_id", cpu);
+    b8 found = read_sysfs_u32(path, &package_id);
+    snprintf(path, sizeof(path),
+             "/sys/devices/system/cpu/cpu%u/topology/core_id", cpu);
+    found = found && read_sysfs_u32(path, &core_id);
+    if (!found) {
+      return platform_get_processor_count();
+    }
+
+    u64 core = ((u64)package_id << 32) | core_id;
+    b8 seen = FALSE;
+    for (u32 i = 0; i < core_count && !seen; ++i) {
+      seen = cores[i] == core;
+    }
+    if (!seen) {
+      cores[core_count++] = core;
+    }
+  }
+
+  return core_count ? core_count : 1;
+}
+
+// Reads a size such as "48K" from a sysfs file, in bytes.
+static b8 read_sysfs_size(const char *path, u32 *out_size) {
+  FILE *file = fopen(path, "r");
+  if (!file) {
+    return FALSE;
+  }
+
+  u32 size = 0;
+  char unit = '\0';
+  i32 matched = fscanf(file, "%u%c", &size, &unit);
+  fclose(file);
+  if (matched < 1) {
+    return FALSE;
+  }
+
+  if (unit == 'K') {
+    size *= 1024;
+  } else if (unit == 'M') {
+    size *= 1024 * 1024;
+  }
+  *out_size = size;
+  return TRUE;
+}
+
+// Fills in the cache sizes from the sysfs description of cpu0's caches.
+static void read_cache_info(platform_cpu_info *info) {
+  for (u32 index = 0;; ++index) {
+    char path[128];
+    u32 level = 0;
+    snprintf(path, sizeof(path),
+             "/sys/devices/system/cpu/cpu0/cache/index%u/level", index);
+    if (!read_sysfs_u32(path, &level)) {
+      break;
+    }
+
+    char type[16] = "";
+    snprintf(path, sizeof(path),
+             "/sys/devices/system/cpu/cpu0/cache/index%u/type", index);
+    FILE *file = fopen(path, "r");
+    if (file) {
+      if (fscanf(file, "%15s", type) != 1) {
+        type[0] = '\0';
+      }
+      fclose(file);
+    }
+    if (strcmp(type, "Instruction") == 0) {
+      continue;
+    }
+
+    u32 size = 0;
+    snprintf(path, sizeof(path),
+             "/sys/devices/system/cpu/cpu0/cache/index%u/size", index);
+    read_sysfs_size(path, &size);
+    if (level == 1) {
+      info->l1_data_cache_size = size;
+      snprintf(path, sizeof(path),
+               "/sys/devices/system/cpu/cpu0/cache/index%u/"
+               "coherency_line_size",
+               index);
+      read_sysfs_u32(path, &info->cache_line_size);
+    } else if (level == 2) {
+      info->l2_cache_size = size;
+    } else if (level == 3) {
+      info->l3_cache_size = size;
+    }
+  }
+
+  // sysfs may be hidden, e.g. in some containers. glibc knows as well.
+#ifdef _SC_LEVEL1_DCACHE_SIZE
+  if (!info->l1_data_cache_size) {
+    i64 size = sysconf(_SC_LEVEL1_DCACHE_SIZE);
+    info->l1_data_cache_size = size > 0 ? (u32)size : 0;
+  }
+  if (!info->l2_cache_size) {
+    i64 size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    info->l2_cache_size = size > 0 ? (u32)size : 0;
+  }
+  if (!info->l3_cache_size) {
+    i64 size = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    info->l3_cache_size = size > 0 ? (u32)size : 0;
+  }
+  if (!info->cache_line_size) {
+    i64 size = sysconf(_SC_LEVEL1_DCACHE_LINESIZE);
+    info->cache_line_size = size > 0 ? (u32)size : 0;
+  }
+#endif
+}
+
+void platform_get_cpu_info(platform_cpu_info *out_info) {
+  platform_zero_memory(out_info, sizeof(platform_cpu_info));
+  out_info->logical_core_count = platform_get_processor_count();
+  out_info->physical_core_count = platform_get_physical_core_count();
+  out_info->threads_per_core =
+      out_info->logical_core_count / out_info->physical_core_count;
+  if (out_info->threads_per_core == 0) {
+    out_info->threads_per_core = 1;
+  }
+
+  read_cache_info(out_info);
+
+#if CPUID_AVAILABLE
+  cpuid_detect(out_info);
+#elif defined(__aarch64__)
+  // Advanced SIMD is mandatory on AArch64.
+  out_info->features |= PLATFORM_CPU_FEATURE_NEON;
+#endif
+
+  if (!out_info->cache_line_size) {
+    out_info->cache_line_size = PLATFORM_ALLOCATION_ALIGNMENT;
+  }
+}
+
+b8 platform_mutex_create(platform_mutex *out_mutex) {
+  pthread_mutexattr_t attributes;
+  pthread_mutexattr_init(&attributes);
+  // Spin briefly before sleeping, since engine critical sections are short.
+  pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_ADAPTIVE_NP);
+
+  i32 result =
+      pthread_mutex_init((pthread_mutex_t *)out_mutex->storage, &attributes);
+  pthread_mutexattr_destroy(&attributes);
+  if (result != 0) {
+    VERROR_CAT(LOG_CATEGORY_PLATFORM, "Failed to create mutex: %s",
+               strerror(result));
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+void platform_mutex_destroy(platform_mutex *mutex) {
+  pthread_mutex_destroy((pthread_mutex_t *)mutex->storage);
+}
+
+void platform_mutex_lock(platform_mutex *mutex) {
+  pthread_mutex_lock((pthread_mutex_t *)mutex->storage);
+}
+
+b8 platform_mutex_try_lock(platform_mutex *mutex) {
+  return pthread_mutex_trylock((pthread_mutex_t *)mutex->storage) == 0;
+}
+
+void platform_mutex_unlock(platform_mutex *mutex) {
+  pthread_mutex_unlock((pthread_mutex_t *)mutex->storage);
+}
+
+// Builds an absolute deadline timeout_ms from now on the given clock.
+static struct timespec deadline_from_now(clockid_t clock, u64 timeout_ms) {
+  struct timespec deadline;
+  clock_gettime(clock, &deadline);
+  deadline.tv_sec += timeout_ms / 1000;
+  deadline.tv_nsec += (timeout_ms % 1000) * 1000 * 1000;
+  if (deadline.tv_nsec >= 1000 * 1000 * 1000) {
+    deadline.tv_sec += 1;
+    deadline.tv_nsec -= 1000 * 1000 * 1000;
+  }
+
+  return deadline;
+}
+
+b8 platform_condition_create(platform_condition *out_condition) {
+  pthread_condattr_t attributes;
+  pthread_condattr_init(&attributes);
+  // Timed waits should not be affected by wall clock changes.
+  pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+
+  i32 result = pthread_cond_init((pthread_cond_t *)out_condition->storage,
+                                 &attributes);
+  pthread_condattr_destroy(&attributes);
+  if (result != 0) {
+    VERROR_CAT(LOG_CATEGORY_PLATFORM, "Failed to create condition: %s",
+               strerror(result));
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+void platform_condition_destroy(platform_condition *condition) {
+  pthread_cond_destroy((pthread_cond_t *)condition->storage);
+}
+
+b8 platform_condition_wait(platform_condition *condition, platform_mutex *mutex,
+                           u64 timeout_ms) {
+  pthread_cond_t *cond = (pthread_cond_t *)condition->storage;
+  pthread_mutex_t *native_mutex = (pthread_mutex_t *)mutex->storage;
+
+  if (timeout_ms == PLATFORM_WAIT_INFINITE) {
+    return pthread_cond_wait(cond, native_mutex) == 0;
+  }
+
+  struct timespec deadline = deadline_from_now(CLOCK_MONOTONIC, timeout_ms);
+  return pthread_cond_timedwait(cond, native_mutex, &deadline) == 0;
+}
+
+void platform_condition_signal(platform_condition *condition) {
+  pthread_cond_signal((pthread_cond_t *)condition->storage);
+}
+
+void platform_condition_broadcast(platform_condition *condition) {
+  pthread_cond_broadcast((pthread_cond_t *)condition->storage);
+}
+
+b8 platform_semaphore_create(u32 initial_count,
+                             platform_semaphore *out_semaphore) {
+  sem_t *semaphore = platform_allocate(sizeof(sem_t), FALSE);
+  if (sem_init(semaphore, 0, initial_count) != 0) {
+    VERROR_CAT(LOG_CATEGORY_PLATFORM, "Failed to create semaphore: %s",
+               strerror(errno));
+    platform_free(semaphore, FALSE);
+    return FALSE;
+  }
+
+  out_semaphore->internal_data = semaphore;
+  return TRUE;
+}
+
+void platform_semaphore_destroy(platform_semaphore *semaphore) {
+  if (!semaphore || !semaphore->internal_data) {
+    return;
+  }
+
+  sem_destroy((sem_t *)semaphore->internal_data);
+  platform_free(semaphore->internal_data, FALSE);
+  semaphore->internal_data = NULL;
+}
+
+void platform_semaphore_signal(platform_semaphore *semaphore) {
+  sem_post((sem_t *)semaphore->internal_data);
+}
+
+b8 platform_semaphore_wait(platform_semaphore *semaphore, u64 timeout_ms) {
+  sem_t *sem = (sem_t *)semaphore->internal_data;
+  i32 result;
+
+  if (timeout_ms == PLATFORM_WAIT_INFINITE) {
+    while ((result = sem_wait(sem)) != 0 && errno == EINTR) {
+    }
+    return result == 0;
+  }
+
+  // sem_timedwait takes an absolute CLOCK_REALTIME deadline.
+  struct timespec deadline = deadline_from_now(CLOCK_REALTIME, timeout_ms);
+
+  while ((result = sem_timedwait(sem, &deadline)) != 0 && errno == EINTR) {
+  }
+  return result == 0;
+}
+
+b8 platform_tls_create(platform_tls_key *out_key) {
+  pthread_key_t key;
+  i32 result = pthread_key_create(&key, NULL);
+  if (result != 0) {
+    VERROR_CAT(LOG_CATEGORY_PLATFORM, "Failed to create TLS key: %s",
+               strerror(result));
+    return FALSE;
+  }
+
+  out_key->handle = (u64)key;
+  return TRUE;
+}
+
+void platform_tls_destroy(platform_tls_key *key) {
+  pthread_key_delete((pthread_key_t)key->handle);
+}
+
+void *platform_tls_get(platform_tls_key *key) {
+  return pthread_getspecific((pthread_key_t)key->handle);
+}
+
+void platform_tls_set(platform_tls_key *key, void *value) {
+  pthread_setspecific((pthread_key_t)key->handle, value);
+}
+
 // Translate X11 keysym to engine key.
 keys translate_keycode(u32 x_keycode) {
   switch (x_keycode) {
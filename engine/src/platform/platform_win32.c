@@ -5,7 +5,9 @@
 
 #include <core/input.h>
 #include <core/logger.h>
+#include <platform/cpuid.h>
 
+#include <malloc.h>
 #include <stdlib.h>
 #include <windows.h>
 #include <windowsx.h> // param input extraction
@@ -15,6 +17,14 @@ typedef struct internal_state {
   HWND hwnd;
 } internal_state;
 
+// Set from the console control handler when running headless.
+static volatile LONG quit_requested = 0;
+
+static BOOL WINAPI win32_console_handler(DWORD control_type) {
+  InterlockedExchange(&quit_requested, 1);
+  return TRUE;
+}
+
 // Clock
 static f64 clock_frequency;
 static LARGE_INTEGER start_time;
@@ -23,12 +33,25 @@ LRESULT CALLBACK win32_process_message(HWND hwnd, u32 msg, WPARAM w_param,
                                        LPARAM l_param);
 
 b8 platform_init(platform_state *plat_state, const char *application_name,
-                 i32 x, i32 y, i32 width, i32 height) {
+                 u32 x, u32 y, u32 width, u32 height, b8 headless) {
   plat_state->internal_state = platform_allocate(sizeof(internal_state), FALSE);
   internal_state *state = (internal_state *)plat_state->internal_state;
+  platform_zero_memory(state, sizeof(internal_state));
 
   state->h_instance = GetModuleHandleA(0);
 
+  // Clock setup
+  LARGE_INTEGER frequency;
+  QueryPerformanceFrequency(&frequency);
+  clock_frequency = 1.0 / (f64)frequency.QuadPart;
+  QueryPerformanceCounter(&start_time);
+
+  if (headless) {
+    SetConsoleCtrlHandler(win32_console_handler, TRUE);
+    VINFO_CAT(LOG_CATEGORY_PLATFORM, "Running headless, no window created.");
+    return TRUE;
+  }
+
   // Setup and register window class.
   HICON icon = LoadIcon(state->h_instance, IDI_APPLICATION);
   WNDCLASSA wc;
@@ -89,7 +112,7 @@ b8 platform_init(platform_state *plat_state, const char *application_name,
     MessageBoxA(NULL, "Window creation failed!", "Error!",
                 MB_ICONEXCLAMATION | MB_OK);
 
-    VFATAL("Window creation failed!");
+    VFATAL_CAT(LOG_CATEGORY_PLATFORM, "Window creation failed!");
     return FALSE;
   } else {
     state->hwnd = handle;
@@ -103,12 +126,6 @@ b8 platform_init(platform_state *plat_state, const char *application_name,
   // If initially maximized, use SW_SHOWMAXIMIZED : SW_MAXIMIZE
   ShowWindow(state->hwnd, show_window_command_flags);
 
-  // Clock setup
-  LARGE_INTEGER frequency;
-  QueryPerformanceFrequency(&frequency);
-  clock_frequency = 1.0 / (f64)frequency.QuadPart;
-  QueryPerformanceCounter(&start_time);
-
   return TRUE;
 }
 
@@ -125,6 +142,11 @@ void platform_shutdown(platform_state *plat_state) {
 }
 
 b8 platform_pump_messages(platform_state *plat_state) {
+  internal_state *state = (internal_state *)plat_state->internal_state;
+  if (!state->hwnd) {
+    return !quit_requested;
+  }
+
   MSG message;
   while (PeekMessageA(&message, NULL, 0, 0, PM_REMOVE)) {
     TranslateMessage(&message);
@@ -134,9 +156,34 @@ b8 platform_pump_messages(platform_state *plat_state) {
   return TRUE;
 }
 
-void *platform_allocate(u64 size, b8 aligned) { return malloc(size); }
+void platform_wait_messages(platform_state *plat_state, u64 timeout_ms) {
+  internal_state *state = (internal_state *)plat_state->internal_state;
+  DWORD timeout = timeout_ms >= (u64)INFINITE ? INFINITE : (DWORD)timeout_ms;
+
+  if (!state->hwnd) {
+    if (timeout != INFINITE && !quit_requested) {
+      Sleep(timeout);
+    }
+    return;
+  }
+
+  MsgWaitForMultipleObjects(0, NULL, FALSE, timeout, QS_ALLINPUT);
+}
+
+void *platform_allocate(u64 size, b8 aligned) {
+  if (aligned) {
+    return _aligned_malloc(size, PLATFORM_ALLOCATION_ALIGNMENT);
+  }
+  return malloc(size);
+}
 
-void platform_free(void *block, b8 aligned) { free(block); }
+void platform_free(void *block, b8 aligned) {
+  if (aligned) {
+    _aligned_free(block);
+  } else {
+    free(block);
+  }
+}
 
 void *platform_zero_memory(void *block, u64 size) {
   return memset(block, 0, size);
@@ -174,6 +221,205 @@ void platform_console_write_error(const char *message, u8 colour) {
                 number_written, 0);
 }
 
+b8 platform_file_open_write(const char *path, platform_file *out_file) {
+  out_file->is_valid = FALSE;
+
+  HANDLE handle =
+      CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL,
+                  CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (handle == INVALID_HANDLE_VALUE) {
+    VERROR_CAT(LOG_CATEGORY_PLATFORM, "Failed to open file '%s': %lu", path,
+               GetLastError());
+    return FALSE;
+  }
+
+  out_file->handle = (u64)handle;
+  out_file->is_valid = TRUE;
+  return TRUE;
+}
+
+void platform_file_close(platform_file *file) {
+  if (file->is_valid) {
+    CloseHandle((HANDLE)file->handle);
+    file->is_valid = FALSE;
+  }
+}
+
+b8 platform_file_set_size(platform_file *file, u64 size) {
+  LARGE_INTEGER position;
+  position.QuadPart = (LONGLONG)size;
+  if (!SetFilePointerEx((HANDLE)file->handle, position, NULL, FILE_BEGIN)) {
+    return FALSE;
+  }
+
+  return SetEndOfFile((HANDLE)file->handle) != 0;
+}
+
+void *platform_file_map_write(platform_file *file, u64 offset, u64 size) {
+  // The view keeps the mapping object alive, so the handle can be closed
+  // straight away.
+  HANDLE mapping = CreateFileMappingA((HANDLE)file->handle, NULL,
+                                      PAGE_READWRITE, 0, 0, NULL);
+  if (!mapping) {
+    return NULL;
+  }
+
+  void *memory = MapViewOfFile(mapping, FILE_MAP_WRITE, (DWORD)(offset >> 32),
+                               (DWORD)(offset & 0xFFFFFFFF), size);
+  CloseHandle(mapping);
+  return memory;
+}
+
+void platform_file_unmap(void *memory, u64 size) {
+  if (memory) {
+    UnmapViewOfFile(memory);
+  }
+}
+
+b8 platform_file_rename(const char *old_path, const char *new_path) {
+  return MoveFileExA(old_path, new_path, MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+b8 platform_file_remove(const char *path) { return DeleteFileA(path) != 0; }
+
+b8 platform_file_get_modified_time(const char *path, u64 *out_time) {
+  WIN32_FILE_ATTRIBUTE_DATA data;
+  if (!GetFileAttributesExA(path, GetFileExInfoStandard, &data)) {
+    return FALSE;
+  }
+
+  // FILETIME counts 100 nanosecond intervals.
+  u64 ticks = ((u64)data.ftLastWriteTime.dwHighDateTime << 32) |
+              data.ftLastWriteTime.dwLowDateTime;
+  *out_time = ticks * 100;
+  return TRUE;
+}
+
+b8 platform_file_copy(const char *source_path, const char *destination_path) {
+  return CopyFileA(source_path, destination_path, FALSE) != 0;
+}
+
+b8 platform_file_open_read(const char *path, platform_file *out_file) {
+  out_file->is_valid = FALSE;
+
+  HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (handle == INVALID_HANDLE_VALUE) {
+    VERROR_CAT(LOG_CATEGORY_PLATFORM, "Failed to open file '%s': %lu", path,
+               GetLastError());
+    return FALSE;
+  }
+
+  out_file->handle = (u64)handle;
+  out_file->is_valid = TRUE;
+  return TRUE;
+}
+
+b8 platform_file_get_size(platform_file *file, u64 *out_size) {
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx((HANDLE)file->handle, &size)) {
+    return FALSE;
+  }
+
+  *out_size = (u64)size.QuadPart;
+  return TRUE;
+}
+
+i64 platform_file_read(platform_file *file, u64 offset, void *buffer,
+                       u64 size) {
+  u64 total = 0;
+  while (total < size) {
+    // The offset in the OVERLAPPED makes the read positional.
+    OVERLAPPED overlapped = {0};
+    overlapped.Offset = (DWORD)((offset + total) & 0xFFFFFFFF);
+    overlapped.OffsetHigh = (DWORD)((offset + total) >> 32);
+    u64 remaining = size - total;
+    DWORD chunk = remaining > 0x80000000u ? 0x80000000u : (DWORD)remaining;
+    DWORD read = 0;
+    if (!ReadFile((HANDLE)file->handle, (u8 *)buffer + total, chunk, &read,
+                  &overlapped)) {
+      if (GetLastError() == ERROR_HANDLE_EOF) {
+        break;
+      }
+      return -1;
+    }
+    if (read == 0) {
+      break;
+    }
+    total += read;
+  }
+
+  return (i64)total;
+}
+
+const void *platform_file_map_read(platform_file *file, u64 offset, u64 size,
+                                   platform_file_access access) {
+  HANDLE mapping = CreateFileMappingA((HANDLE)file->handle, NULL,
+                                      PAGE_READONLY, 0, 0, NULL);
+  if (!mapping) {
+    return NULL;
+  }
+
+  void *memory = MapViewOfFile(mapping, FILE_MAP_READ, (DWORD)(offset >> 32),
+                               (DWORD)(offset & 0xFFFFFFFF), size);
+  CloseHandle(mapping);
+  if (!memory) {
+    return NULL;
+  }
+
+  // Windows reads ahead on its own; only an explicit prefetch is worth
+  // asking for. Only a hint, so failing is harmless.
+  if (access == PLATFORM_FILE_ACCESS_WILL_NEED) {
+    WIN32_MEMORY_RANGE_ENTRY range = {memory, size};
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+  }
+
+  return memory;
+}
+
+b8 platform_dynamic_library_load(const char *path,
+                                 platform_dynamic_library *out_library) {
+  out_library->internal_data = LoadLibraryA(path);
+  if (!out_library->internal_data) {
+    VERROR_CAT(LOG_CATEGORY_PLATFORM, "Failed to load library '%s': %lu", path,
+               GetLastError());
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+void platform_dynamic_library_unload(platform_dynamic_library *library) {
+  if (library->internal_data) {
+    FreeLibrary((HMODULE)library->internal_data);
+    library->internal_data = NULL;
+  }
+}
+
+void *platform_dynamic_library_load_function(platform_dynamic_library *library,
+                                             const char *name) {
+  return (void *)GetProcAddress((HMODULE)library->internal_data, name);
+}
+
+// TODO: I/O rings or completion ports. Callers fall back to threads for now.
+b8 platform_io_queue_create(u32 depth, platform_io_queue *out_queue) {
+  out_queue->internal_data = NULL;
+  return FALSE;
+}
+
+void platform_io_queue_destroy(platform_io_queue *queue) {}
+
+b8 platform_io_queue_read(platform_io_queue *queue, platform_file *file,
+                          u64 offset, void *buffer, u64 size, u64 user_data) {
+  return FALSE;
+}
+
+u32 platform_io_queue_poll(platform_io_queue *queue,
+                           platform_io_completion *out_completions,
+                           u32 max_count) {
+  return 0;
+}
+
 f64 platform_get_absolute_time() {
   LARGE_INTEGER now_time;
   QueryPerformanceCounter(&now_time);
@@ -182,6 +428,281 @@ f64 platform_get_absolute_time() {
 
 void platform_sleep(u64 ms) { Sleep(ms); }
 
+STATIC_ASSERT(sizeof(SRWLOCK) <= PLATFORM_SYNC_STORAGE_SIZE,
+              srwlock_fits_platform_mutex);
+STATIC_ASSERT(sizeof(CONDITION_VARIABLE) <= PLATFORM_SYNC_STORAGE_SIZE,
+              condition_variable_fits_platform_condition);
+
+// Maximum thread name length, including the terminator.
+#define THREAD_NAME_MAX_LENGTH 64
+
+typedef struct win32_thread_start {
+  pfn_thread_start start_function;
+  void *params;
+  wchar_t name[THREAD_NAME_MAX_LENGTH];
+} win32_thread_start;
+
+// Adapts the engine thread signature to the one CreateThread expects.
+static DWORD WINAPI win32_thread_trampoline(LPVOID arg) {
+  win32_thread_start start = *(win32_thread_start *)arg;
+  platform_free(arg, FALSE);
+
+  if (start.name[0]) {
+    SetThreadDescription(GetCurrentThread(), start.name);
+  }
+
+  return (DWORD)start.start_function(start.params);
+}
+
+b8 platform_thread_create(const char *name, pfn_thread_start start_function,
+                          void *params, platform_thread *out_thread) {
+  if (!start_function || !out_thread) {
+    return FALSE;
+  }
+
+  win32_thread_start *start =
+      platform_allocate(sizeof(win32_thread_start), FALSE);
+  platform_zero_memory(start, sizeof(win32_thread_start));
+  start->start_function = start_function;
+  start->params = params;
+  if (name) {
+    MultiByteToWideChar(CP_UTF8, 0, name, -1, start->name,
+                        THREAD_NAME_MAX_LENGTH - 1);
+  }
+
+  DWORD thread_id = 0;
+  HANDLE handle =
+      CreateThread(NULL, 0, win32_thread_trampoline, start, 0, &thread_id);
+  if (!handle) {
+    VERROR_CAT(LOG_CATEGORY_PLATFORM, "Failed to create thread: %lu",
+               GetLastError());
+    platform_free(start, FALSE);
+    return FALSE;
+  }
+
+  out_thread->internal_data = handle;
+  out_thread->thread_id = thread_id;
+  return TRUE;
+}
+
+void platform_thread_join(platform_thread *thread) {
+  if (!thread || !thread->internal_data) {
+    return;
+  }
+
+  WaitForSingleObject((HANDLE)thread->internal_data, INFINITE);
+  CloseHandle((HANDLE)thread->internal_data);
+  thread->internal_data = NULL;
+  thread->thread_id = 0;
+}
+
+void platform_thread_current(platform_thread *out_thread) {
+  // A pseudo handle, only meaningful on the calling thread.
+  out_thread->internal_data = GetCurrentThread();
+  out_thread->thread_id = GetCurrentThreadId();
+}
+
+u64 platform_thread_current_id() { return GetCurrentThreadId(); }
+
+b8 platform_thread_set_affinity(platform_thread *thread, u64 cpu_mask) {
+  if (!SetThreadAffinityMask((HANDLE)thread->internal_data,
+                             (DWORD_PTR)cpu_mask)) {
+    VWARN_CAT(LOG_CATEGORY_PLATFORM, "Failed to set thread affinity: %lu",
+              GetLastError());
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+void platform_thread_yield() { SwitchToThread(); }
+
+u32 platform_get_processor_count() {
+  return GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+}
+
+u32 platform_get_physical_core_count() {
+  DWORD length = 0;
+  GetLogicalProcessorInformationEx(RelationProcessorCore, NULL, &length);
+  u8 *buffer = platform_allocate(length, FALSE);
+  if (!GetLogicalProcessorInformationEx(
+          RelationProcessorCore,
+          (SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX *)buffer, &length)) {
+    platform_free(buffer, FALSE);
+    return platform_get_processor_count();
+  }
+
+  // One entry per physical core.
+  u32 core_count = 0;
+  for (DWORD offset = 0; offset < length;) {
+    SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX *info =
+        (SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX *)(buffer + offset);
+    core_count++;
+    offset += info->Size;
+  }
+
+  platform_free(buffer, FALSE);
+  return core_count ? core_count : 1;
+}
+
+// Fills in the cache sizes from the first cache of each level, core 0's.
+static void read_cache_info(platform_cpu_info *info) {
+  DWORD length = 0;
+  GetLogicalProcessorInformationEx(RelationCache, NULL, &length);
+  u8 *buffer = platform_allocate(length, FALSE);
+  if (!GetLogicalProcessorInformationEx(
+          RelationCache, (SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX *)buffer,
+          &length)) {
+    platform_free(buffer, FALSE);
+    return;
+  }
+
+  for (DWORD offset = 0; offset < length;) {
+    SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX *entry =
+        (SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX *)(buffer + offset);
+    CACHE_RELATIONSHIP *cache = &entry->Cache;
+    offset += entry->Size;
+    if (cache->Type == CacheInstruction) {
+      continue;
+    }
+
+    if (cache->Level == 1 && !info->l1_data_cache_size) {
+      info->l1_data_cache_size = cache->CacheSize;
+      info->cache_line_size = cache->LineSize;
+    } else if (cache->Level == 2 && !info->l2_cache_size) {
+      info->l2_cache_size = cache->CacheSize;
+    } else if (cache->Level == 3 && !info->l3_cache_size) {
+      info->l3_cache_size = cache->CacheSize;
+    }
+  }
+
+  platform_free(buffer, FALSE);
+}
+
+void platform_get_cpu_info(platform_cpu_info *out_info) {
+  platform_zero_memory(out_info, sizeof(platform_cpu_info));
+  out_info->logical_core_count = platform_get_processor_count();
+  out_info->physical_core_count = platform_get_physical_core_count();
+  out_info->threads_per_core =
+      out_info->logical_core_count / out_info->physical_core_count;
+  if (out_info->threads_per_core == 0) {
+    out_info->threads_per_core = 1;
+  }
+
+  read_cache_info(out_info);
+
+#if CPUID_AVAILABLE
+  cpuid_detect(out_info);
+#elif defined(_M_ARM64)
+  // Advanced SIMD is mandatory on AArch64.
+  out_info->features |= PLATFORM_CPU_FEATURE_NEON;
+#endif
+
+  if (!out_info->cache_line_size) {
+    out_info->cache_line_size = PLATFORM_ALLOCATION_ALIGNMENT;
+  }
+}
+
+b8 platform_mutex_create(platform_mutex *out_mutex) {
+  InitializeSRWLock((SRWLOCK *)out_mutex->storage);
+  return TRUE;
+}
+
+// SRW locks need no cleanup.
+void platform_mutex_destroy(platform_mutex *mutex) {}
+
+void platform_mutex_lock(platform_mutex *mutex) {
+  AcquireSRWLockExclusive((SRWLOCK *)mutex->storage);
+}
+
+b8 platform_mutex_try_lock(platform_mutex *mutex) {
+  return TryAcquireSRWLockExclusive((SRWLOCK *)mutex->storage) != 0;
+}
+
+void platform_mutex_unlock(platform_mutex *mutex) {
+  ReleaseSRWLockExclusive((SRWLOCK *)mutex->storage);
+}
+
+b8 platform_condition_create(platform_condition *out_condition) {
+  InitializeConditionVariable((CONDITION_VARIABLE *)out_condition->storage);
+  return TRUE;
+}
+
+// Condition variables need no cleanup.
+void platform_condition_destroy(platform_condition *condition) {}
+
+b8 platform_condition_wait(platform_condition *condition, platform_mutex *mutex,
+                           u64 timeout_ms) {
+  DWORD timeout =
+      timeout_ms == PLATFORM_WAIT_INFINITE ? INFINITE : (DWORD)timeout_ms;
+  return SleepConditionVariableSRW((CONDITION_VARIABLE *)condition->storage,
+                                   (SRWLOCK *)mutex->storage, timeout, 0) != 0;
+}
+
+void platform_condition_signal(platform_condition *condition) {
+  WakeConditionVariable((CONDITION_VARIABLE *)condition->storage);
+}
+
+void platform_condition_broadcast(platform_condition *condition) {
+  WakeAllConditionVariable((CONDITION_VARIABLE *)condition->storage);
+}
+
+b8 platform_semaphore_create(u32 initial_count,
+                             platform_semaphore *out_semaphore) {
+  HANDLE handle = CreateSemaphoreA(NULL, initial_count, 0x7FFFFFFF, NULL);
+  if (!handle) {
+    VERROR_CAT(LOG_CATEGORY_PLATFORM, "Failed to create semaphore: %lu",
+               GetLastError());
+    return FALSE;
+  }
+
+  out_semaphore->internal_data = handle;
+  return TRUE;
+}
+
+void platform_semaphore_destroy(platform_semaphore *semaphore) {
+  if (!semaphore || !semaphore->internal_data) {
+    return;
+  }
+
+  CloseHandle((HANDLE)semaphore->internal_data);
+  semaphore->internal_data = NULL;
+}
+
+void platform_semaphore_signal(platform_semaphore *semaphore) {
+  ReleaseSemaphore((HANDLE)semaphore->internal_data, 1, NULL);
+}
+
+b8 platform_semaphore_wait(platform_semaphore *semaphore, u64 timeout_ms) {
+  DWORD timeout =
+      timeout_ms == PLATFORM_WAIT_INFINITE ? INFINITE : (DWORD)timeout_ms;
+  return WaitForSingleObject((HANDLE)semaphore->internal_data, timeout) ==
+         WAIT_OBJECT_0;
+}
+
+b8 platform_tls_create(platform_tls_key *out_key) {
+  DWORD index = TlsAlloc();
+  if (index == TLS_OUT_OF_INDEXES) {
+    VERROR_CAT(LOG_CATEGORY_PLATFORM, "Failed to create TLS key.");
+    return FALSE;
+  }
+
+  out_key->handle = index;
+  return TRUE;
+}
+
+void platform_tls_destroy(platform_tls_key *key) {
+  TlsFree((DWORD)key->handle);
+}
+
+void *platform_tls_get(platform_tls_key *key) {
+  return TlsGetValue((DWORD)key->handle);
+}
+
+void platform_tls_set(platform_tls_key *key, void *value) {
+  TlsSetValue((DWORD)key->handle, value);
+}
+
 LRESULT CALLBACK win32_process_message(HWND hwnd, u32 msg, WPARAM w_param,
                                        LPARAM l_param) {
   switch (msg) {
@@ -0,0 +1,801 @@
+#include <scene/bvh.h>
+
+#include <core/vmemory.h>
+#include <math/simd.h>
+#include <math/vmath.h>
+
+#define BVH_MIN_CAPACITY 64
+
+// Buckets the centers are sorted into when looking for the cheapest split.
+#define BVH_BINS 16
+
+/**
+ * Below this depth nodes are split in half by count instead, so the depth
+ * stays bounded however badly the objects are spread.
+ */
+#define BVH_MAX_DEPTH 40
+
+// Each level pushes at most three more nodes than it pops.
+#define BVH_STACK_SIZE (3 * (BVH_MAX_DEPTH + 32) + 1)
+
+// Inserted objects tested one by one before the tree is rebuilt.
+#define BVH_MAX_INSERTED 32
+#define BVH_INSERTED_DIVISOR 64
+
+// Share of removed objects in the tree before it is rebuilt.
+#define BVH_REMOVED_DIVISOR 4
+
+// How much worse than built a refit tree may get before it is rebuilt.
+#define BVH_MAX_COST_GROWTH 1.5f
+
+// Marks a frustum query's stack entries for subtrees entirely inside.
+#define INSIDE_BIT 0x80000000u
+
+// Moves an array into a larger allocation.
+static void resize(void **array, u64 stride, u32 old_capacity,
+                   u32 new_capacity) {
+  void *resized = vallocate_aligned(stride * new_capacity, MEMORY_TAG_SCENE);
+  if (*array) {
+    vcopy_memory(resized, *array, stride * old_capacity);
+    vfree_aligned(*array, stride * old_capacity, MEMORY_TAG_SCENE);
+  }
+  *array = resized;
+}
+
+static void set_object_capacity(bvh *b, u32 capacity) {
+  resize((void **)&b->bounds, sizeof(aabb), b->object_capacity, capacity);
+  resize((void **)&b->proxies, sizeof(bvh_proxy), b->object_capacity,
+         capacity);
+  b->object_capacity = capacity;
+}
+
+static void set_proxy_capacity(bvh *b, u32 capacity) {
+  resize((void **)&b->objects, sizeof(u32), b->proxy_capacity, capacity);
+  resize((void **)&b->user_data, sizeof(u64), b->proxy_capacity, capacity);
+  b->proxy_capacity = capacity;
+}
+
+void bvh_create(u32 capacity, bvh *out_bvh) {
+  vzero_memory(out_bvh, sizeof(bvh));
+  out_bvh->free_proxy = BVH_PROXY_INVALID;
+  capacity = capacity > BVH_MIN_CAPACITY ? capacity : BVH_MIN_CAPACITY;
+  set_object_capacity(out_bvh, capacity);
+  set_proxy_capacity(out_bvh, capacity);
+}
+
+void bvh_destroy(bvh *b) {
+  if (b->nodes) {
+    vfree_aligned(b->nodes, sizeof(bvh_node) * b->node_capacity,
+                  MEMORY_TAG_SCENE);
+  }
+  vfree_aligned(b->bounds, sizeof(aabb) * b->object_capacity,
+                MEMORY_TAG_SCENE);
+  vfree_aligned(b->proxies, sizeof(bvh_proxy) * b->object_capacity,
+                MEMORY_TAG_SCENE);
+  vfree_aligned(b->objects, sizeof(u32) * b->proxy_capacity,
+                MEMORY_TAG_SCENE);
+  vfree_aligned(b->user_data, sizeof(u64) * b->proxy_capacity,
+                MEMORY_TAG_SCENE);
+  vzero_memory(b, sizeof(bvh));
+}
+
+bvh_proxy bvh_insert(bvh *b, aabb bounds, u64 user_data) {
+  if (b->object_count == b->object_capacity) {
+    set_object_capacity(b, b->object_capacity * 2);
+  }
+
+  bvh_proxy proxy = b->free_proxy;
+  if (proxy != BVH_PROXY_INVALID) {
+    b->free_proxy = b->objects[proxy];
+  } else {
+    if (b->proxy_count == b->proxy_capacity) {
+      set_proxy_capacity(b, b->proxy_capacity * 2);
+    }
+    proxy = b->proxy_count++;
+  }
+
+  // Appended past the tree until the next build.
+  u32 object = b->object_count++;
+  b->bounds[object] = bounds;
+  b->proxies[object] = proxy;
+  b->objects[proxy] = object;
+  b->user_data[proxy] = user_data;
+  return proxy;
+}
+
+void bvh_remove(bvh *b, bvh_proxy proxy) {
+  u32 object = b->objects[proxy];
+  if (object < b->built_count) {
+    // A leaf refers to the slot. Empty it until the next build.
+    b->bounds[object] = aabb_empty();
+    b->proxies[object] = BVH_PROXY_INVALID;
+    b->removed_count++;
+    b->is_refit_needed = TRUE;
+  } else {
+    u32 last = --b->object_count;
+    b->bounds[object] = b->bounds[last];
+    b->proxies[object] = b->proxies[last];
+    b->objects[b->proxies[object]] = object;
+  }
+
+  b->objects[proxy] = b->free_proxy;
+  b->free_proxy = proxy;
+}
+
+void bvh_move(bvh *b, bvh_proxy proxy, aabb bounds) {
+  u32 object = b->objects[proxy];
+  b->bounds[object] = bounds;
+  if (object < b->built_count) {
+    b->is_refit_needed = TRUE;
+  }
+}
+
+aabb bvh_get_bounds(const bvh *b, bvh_proxy proxy) {
+  return b->bounds[b->objects[proxy]];
+}
+
+u64 bvh_get_user_data(const bvh *b, bvh_proxy proxy) {
+  return b->user_data[proxy];
+}
+
+static void set_child_bounds(bvh_node *node, u32 child, aabb box) {
+  node->bounds[0][child] = box.min.x;
+  node->bounds[1][child] = box.min.y;
+  node->bounds[2][child] = box.min.z;
+  node->bounds[3][child] = box.max.x;
+  node->bounds[4][child] = box.max.y;
+  node->bounds[5][child] = box.max.z;
+}
+
+// Bounds of all of the node's children.
+static aabb node_bounds(const bvh_node *node) {
+  aabb box = aabb_empty();
+  for (u32 c = 0; c < BVH_WIDTH; ++c) {
+    box.min.x = vmin(box.min.x, node->bounds[0][c]);
+    box.min.y = vmin(box.min.y, node->bounds[1][c]);
+    box.min.z = vmin(box.min.z, node->bounds[2][c]);
+    box.max.x = vmax(box.max.x, node->bounds[3][c]);
+    box.max.y = vmax(box.max.y, node->bounds[4][c]);
+    box.max.z = vmax(box.max.z, node->bounds[5][c]);
+  }
+  return box;
+}
+
+static aabb objects_bounds(const bvh *b, u32 start, u32 end) {
+  aabb box = aabb_empty();
+  for (u32 k = start; k < end; ++k) {
+    box = aabb_union(box, b->bounds[k]);
+  }
+  return box;
+}
+
+/**
+ * Recomputes every node's child bounds from the objects up, in one backward
+ * pass since children follow their parents, and measures the tree's cost:
+ * the surface area of each inner child plus that of each leaf times its
+ * objects, relative to the root's.
+ */
+static void refit(bvh *b) {
+  f32 cost = 0.0f;
+  for (u32 i = b->node_count; i-- > 0;) {
+    bvh_node *node = &b->nodes[i];
+    for (u32 c = 0; c < BVH_WIDTH; ++c) {
+      u32 child = node->children[c];
+      u32 count = node->counts[c];
+      if (child == BVH_CHILD_EMPTY) {
+        continue;
+      }
+
+      aabb box = count ? objects_bounds(b, child, child + count)
+                       : node_bounds(&b->nodes[child]);
+      set_child_bounds(node, c, box);
+      cost += aabb_surface_area(box) * (f32)(count ? count : 1);
+    }
+  }
+
+  f32 root_area =
+      b->node_count ? aabb_surface_area(node_bounds(&b->nodes[0])) : 0.0f;
+  b->cost = root_area > 0.0f ? cost / root_area : 0.0f;
+  b->is_refit_needed = FALSE;
+}
+
+static void swap_objects(bvh *b, u32 i, u32 j) {
+  aabb bounds = b->bounds[i];
+  b->bounds[i] = b->bounds[j];
+  b->bounds[j] = bounds;
+  bvh_proxy proxy = b->proxies[i];
+  b->proxies[i] = b->proxies[j];
+  b->proxies[j] = proxy;
+}
+
+static inline u32 bin_of(const aabb *box, u32 axis, f32 axis_min, f32 scale) {
+  f32 center = box->min.elements[axis] + box->max.elements[axis];
+  u32 bin = (u32)((center - axis_min) * scale);
+  return bin < BVH_BINS ? bin : BVH_BINS - 1;
+}
+
+/**
+ * Splits the objects in [start, end) in half by count, leaving their order.
+ *
+ * @param out_areas Receives the surface areas of both halves.
+ * @return Where the second half starts.
+ */
+static u32 split_middle(const bvh *b, u32 start, u32 end, f32 *out_areas) {
+  u32 middle = start + (end - start) / 2;
+  out_areas[0] = aabb_surface_area(objects_bounds(b, start, middle));
+  out_areas[1] = aabb_surface_area(objects_bounds(b, middle, end));
+  return middle;
+}
+
+/**
+ * Splits the objects in [start, end) in two where the surface area
+ * heuristic is lowest, among BVH_BINS buckets of their centers along the
+ * axis the centers spread most on. Reorders the objects.
+ *
+ * @param out_areas Receives the surface areas of both halves.
+ * @return Where the second half starts, strictly between start and end.
+ */
+static u32 split(bvh *b, u32 start, u32 end, u32 depth, f32 *out_areas) {
+  if (depth >= BVH_MAX_DEPTH) {
+    return split_middle(b, start, end, out_areas);
+  }
+
+  // Centers, doubled.
+  aabb centers = aabb_empty();
+  for (u32 k = start; k < end; ++k) {
+    vec3 center = vec3_add(b->bounds[k].min, b->bounds[k].max);
+    centers.min = vec3_min(centers.min, center);
+    centers.max = vec3_max(centers.max, center);
+  }
+  vec3 extent = vec3_sub(centers.max, centers.min);
+  u32 axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2)
+                                 : (extent.y > extent.z ? 1 : 2);
+  f32 axis_min = centers.min.elements[axis];
+  if (!(extent.elements[axis] > 0.0f)) {
+    // All centers coincide. Any split is as good.
+    return split_middle(b, start, end, out_areas);
+  }
+  f32 scale = (f32)BVH_BINS / extent.elements[axis];
+
+  u32 bin_counts[BVH_BINS] = {0};
+  aabb bin_bounds[BVH_BINS];
+  for (u32 i = 0; i < BVH_BINS; ++i) {
+    bin_bounds[i] = aabb_empty();
+  }
+  for (u32 k = start; k < end; ++k) {
+    u32 bin = bin_of(&b->bounds[k], axis, axis_min, scale);
+    bin_counts[bin]++;
+    bin_bounds[bin] = aabb_union(bin_bounds[bin], b->bounds[k]);
+  }
+
+  // Areas and counts of the objects from each bin on, then from the left the
+  // cost of splitting before each bin.
+  f32 right_areas[BVH_BINS];
+  u32 right_counts[BVH_BINS];
+  aabb right = aabb_empty();
+  u32 right_count = 0;
+  for (u32 i = BVH_BINS - 1; i > 0; --i) {
+    right = aabb_union(right, bin_bounds[i]);
+    right_count += bin_counts[i];
+    right_areas[i] = aabb_surface_area(right);
+    right_counts[i] = right_count;
+  }
+
+  aabb left = aabb_empty();
+  u32 left_count = 0;
+  u32 best_bin = 0;
+  f32 best_cost = V_FLOAT_MAX;
+  for (u32 i = 1; i < BVH_BINS; ++i) {
+    left = aabb_union(left, bin_bounds[i - 1]);
+    left_count += bin_counts[i - 1];
+    f32 left_area = aabb_surface_area(left);
+    f32 cost = left_area * (f32)left_count + right_areas[i] * right_counts[i];
+    if (left_count && right_counts[i] && cost < best_cost) {
+      best_cost = cost;
+      best_bin = i;
+      out_areas[0] = left_area;
+      out_areas[1] = right_areas[i];
+    }
+  }
+  if (best_bin == 0) {
+    return split_middle(b, start, end, out_areas);
+  }
+
+  u32 i = start;
+  u32 j = end;
+  while (i < j) {
+    if (bin_of(&b->bounds[i], axis, axis_min, scale) < best_bin) {
+      ++i;
+    } else {
+      swap_objects(b, i, --j);
+    }
+  }
+  return i;
+}
+
+typedef struct build_range {
+  u32 start;
+  u32 end;
+  f32 area;
+} build_range;
+
+/**
+ * Builds the node over the objects in [start, end) and, after it, the nodes
+ * below. Only the structure: refit fills in the bounds.
+ *
+ * @return The node's index.
+ */
+static u32 build_node(bvh *b, u32 start, u32 end, u32 depth) {
+  u32 index = b->node_count++;
+
+  // Split the largest range that does not fit a leaf until there is one per
+  // child.
+  build_range ranges[BVH_WIDTH];
+  ranges[0] = (build_range){start, end, 0.0f};
+  u32 range_count = 1;
+  while (range_count < BVH_WIDTH) {
+    u32 largest = BVH_WIDTH;
+    f32 largest_area = -1.0f;
+    for (u32 r = 0; r < range_count; ++r) {
+      if (ranges[r].end - ranges[r].start > BVH_LEAF_SIZE &&
+          ranges[r].area > largest_area) {
+        largest = r;
+        largest_area = ranges[r].area;
+      }
+    }
+    if (largest == BVH_WIDTH) {
+      break;
+    }
+
+    build_range *range = &ranges[largest];
+    f32 areas[2];
+    u32 middle = split(b, range->start, range->end, depth, areas);
+    ranges[range_count++] = (build_range){middle, range->end, areas[1]};
+    range->end = middle;
+    range->area = areas[0];
+  }
+
+  for (u32 c = 0; c < BVH_WIDTH; ++c) {
+    u32 child = BVH_CHILD_EMPTY;
+    u32 count = 0;
+    if (c < range_count) {
+      child = ranges[c].start;
+      count = ranges[c].end - ranges[c].start;
+      if (count > BVH_LEAF_SIZE) {
+        child = build_node(b, ranges[c].start, ranges[c].end, depth + 1);
+        count = 0;
+      }
+    }
+
+    // Nodes were allocated up front, so the pointer stays valid.
+    bvh_node *node = &b->nodes[index];
+    node->children[c] = child;
+    node->counts[c] = count;
+    set_child_bounds(node, c, aabb_empty());
+  }
+
+  return index;
+}
+
+void bvh_rebuild(bvh *b) {
+  u32 kept = 0;
+  for (u32 k = 0; k < b->object_count; ++k) {
+    if (b->proxies[k] != BVH_PROXY_INVALID) {
+      b->bounds[kept] = b->bounds[k];
+      b->proxies[kept] = b->proxies[k];
+      kept++;
+    }
+  }
+  b->object_count = kept;
+  b->built_count = kept;
+  b->removed_count = 0;
+
+  // Inner nodes have two children or more, so there are fewer nodes than
+  // objects, or one for up to BVH_LEAF_SIZE objects.
+  if (b->node_capacity < kept) {
+    if (b->nodes) {
+      vfree_aligned(b->nodes, sizeof(bvh_node) * b->node_capacity,
+                    MEMORY_TAG_SCENE);
+    }
+    b->node_capacity = kept + kept / 4;
+    b->nodes = vallocate_aligned(sizeof(bvh_node) * b->node_capacity,
+                                 MEMORY_TAG_SCENE);
+  }
+
+  b->node_count = 0;
+  if (kept) {
+    build_node(b, 0, kept, 0);
+  }
+  for (u32 k = 0; k < kept; ++k) {
+    b->objects[b->proxies[k]] = k;
+  }
+
+  refit(b);
+  b->build_cost = b->cost;
+}
+
+b8 bvh_update(bvh *b) {
+  u32 inserted = b->object_count - b->built_count;
+  if (inserted > BVH_MAX_INSERTED + b->built_count / BVH_INSERTED_DIVISOR ||
+      b->removed_count > b->built_count / BVH_REMOVED_DIVISOR) {
+    bvh_rebuild(b);
+    return TRUE;
+  }
+
+  if (b->is_refit_needed) {
+    refit(b);
+    if (b->build_cost > 0.0f &&
+        b->cost > b->build_cost * BVH_MAX_COST_GROWTH) {
+      bvh_rebuild(b);
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+// Counts a found object, keeping it if there is room.
+static inline void emit(bvh_proxy proxy, bvh_proxy *out_proxies,
+                        u32 max_proxies, u32 *found) {
+  if (*found < max_proxies) {
+    out_proxies[*found] = proxy;
+  }
+  (*found)++;
+}
+
+// Children of the node whose bounds overlap the box, one bit each.
+static inline u32 overlap_mask(const bvh_node *node, const aabb *box) {
+#ifdef VSIMD_SSE
+  __m128 hit = _mm_and_ps(
+      _mm_cmple_ps(_mm_load_ps(node->bounds[0]), _mm_set1_ps(box->max.x)),
+      _mm_cmpge_ps(_mm_load_ps(node->bounds[3]), _mm_set1_ps(box->min.x)));
+  hit = _mm_and_ps(
+      hit, _mm_cmple_ps(_mm_load_ps(node->bounds[1]), _mm_set1_ps(box->max.y)));
+  hit = _mm_and_ps(
+      hit, _mm_cmpge_ps(_mm_load_ps(node->bounds[4]), _mm_set1_ps(box->min.y)));
+  hit = _mm_and_ps(
+      hit, _mm_cmple_ps(_mm_load_ps(node->bounds[2]), _mm_set1_ps(box->max.z)));
+  hit = _mm_and_ps(
+      hit, _mm_cmpge_ps(_mm_load_ps(node->bounds[5]), _mm_set1_ps(box->min.z)));
+  return (u32)_mm_movemask_ps(hit);
+#else
+  u32 mask = 0;
+  for (u32 c = 0; c < BVH_WIDTH; ++c) {
+    if (node->bounds[0][c] <= box->max.x && node->bounds[3][c] >= box->min.x &&
+        node->bounds[1][c] <= box->max.y && node->bounds[4][c] >= box->min.y &&
+        node->bounds[2][c] <= box->max.z && node->bounds[5][c] >= box->min.z) {
+      mask |= 1u << c;
+    }
+  }
+  return mask;
+#endif
+}
+
+u32 bvh_query_aabb(const bvh *b, aabb box, bvh_proxy *out_proxies,
+                   u32 max_proxies) {
+  u32 found = 0;
+  u32 stack[BVH_STACK_SIZE];
+  u32 top = 0;
+  if (b->node_count) {
+    stack[top++] = 0;
+  }
+
+  while (top) {
+    const bvh_node *node = &b->nodes[stack[--top]];
+    u32 mask = overlap_mask(node, &box);
+    for (u32 c = 0; c < BVH_WIDTH; ++c) {
+      if (!(mask & (1u << c))) {
+        continue;
+      }
+
+      u32 child = node->children[c];
+      if (!node->counts[c]) {
+        stack[top++] = child;
+        continue;
+      }
+      // Removed objects have empty bounds and never overlap.
+      for (u32 k = child; k < child + node->counts[c]; ++k) {
+        if (aabb_overlaps(b->bounds[k], box)) {
+          emit(b->proxies[k], out_proxies, max_proxies, &found);
+        }
+      }
+    }
+  }
+
+  for (u32 k = b->built_count; k < b->object_count; ++k) {
+    if (aabb_overlaps(b->bounds[k], box)) {
+      emit(b->proxies[k], out_proxies, max_proxies, &found);
+    }
+  }
+
+  return found;
+}
+
+/**
+ * A frustum prepared for testing nodes: per plane, the bounds rows of the
+ * corner furthest along its normal, which decides whether a box is entirely
+ * behind it, and of the opposite corner, which decides whether it is
+ * entirely in front.
+ */
+typedef struct frustum_test {
+  const frustum *frustum;
+  u32 positive_rows[6][3];
+  u32 negative_rows[6][3];
+} frustum_test;
+
+/**
+ * Tests the node's children against the frustum.
+ *
+ * @param out_inside Receives the children entirely inside, one bit each.
+ * @return The children not entirely outside, one bit each.
+ */
+static inline u32 frustum_mask(const bvh_node *node, const frustum_test *test,
+                               u32 *out_inside) {
+#ifdef VSIMD_SSE
+  __m128 zero = _mm_setzero_ps();
+  __m128 outside = zero;
+  __m128 crossing = zero;
+  for (u32 i = 0; i < 6; ++i) {
+    plane p = test->frustum->planes[i];
+    __m128 nx = _mm_set1_ps(p.x);
+    __m128 ny = _mm_set1_ps(p.y);
+    __m128 nz = _mm_set1_ps(p.z);
+    __m128 d = _mm_set1_ps(p.w);
+    const u32 *positive = test->positive_rows[i];
+    const u32 *negative = test->negative_rows[i];
+    __m128 positive_distance = vsimd_madd(
+        nx, _mm_load_ps(node->bounds[positive[0]]),
+        vsimd_madd(ny, _mm_load_ps(node->bounds[positive[1]]),
+                   vsimd_madd(nz, _mm_load_ps(node->bounds[positive[2]]), d)));
+    __m128 negative_distance = vsimd_madd(
+        nx, _mm_load_ps(node->bounds[negative[0]]),
+        vsimd_madd(ny, _mm_load_ps(node->bounds[negative[1]]),
+                   vsimd_madd(nz, _mm_load_ps(node->bounds[negative[2]]), d)));
+    outside = _mm_or_ps(outside, _mm_cmplt_ps(positive_distance, zero));
+    crossing = _mm_or_ps(crossing, _mm_cmplt_ps(negative_distance, zero));
+  }
+  u32 visible = ~(u32)_mm_movemask_ps(outside) & 0xF;
+  *out_inside = visible & ~(u32)_mm_movemask_ps(crossing);
+  return visible;
+#else
+  u32 visible = 0;
+  u32 inside = 0;
+  for (u32 c = 0; c < BVH_WIDTH; ++c) {
+    b8 is_outside = FALSE;
+    b8 is_crossing = FALSE;
+    for (u32 i = 0; i < 6; ++i) {
+      plane p = test->frustum->planes[i];
+      const u32 *positive = test->positive_rows[i];
+      const u32 *negative = test->negative_rows[i];
+      f32 positive_distance = p.x * node->bounds[positive[0]][c] +
+                         p.y * node->bounds[positive[1]][c] +
+                         p.z * node->bounds[positive[2]][c] + p.w;
+      f32 negative_distance = p.x * node->bounds[negative[0]][c] +
+                          p.y * node->bounds[negative[1]][c] +
+                          p.z * node->bounds[negative[2]][c] + p.w;
+      is_outside |= positive_distance < 0.0f;
+      is_crossing |= negative_distance < 0.0f;
+    }
+    if (!is_outside) {
+      visible |= 1u << c;
+      if (!is_crossing) {
+        inside |= 1u << c;
+      }
+    }
+  }
+  *out_inside = inside;
+  return visible;
+#endif
+}
+
+u32 bvh_query_frustum(const bvh *b, const frustum *frustum,
+                      bvh_proxy *out_proxies, u32 max_proxies) {
+  frustum_test test;
+  test.frustum = frustum;
+  for (u32 i = 0; i < 6; ++i) {
+    for (u32 axis = 0; axis < 3; ++axis) {
+      b8 is_positive = frustum->planes[i].elements[axis] >= 0.0f;
+      test.positive_rows[i][axis] = is_positive ? axis + 3 : axis;
+      test.negative_rows[i][axis] = is_positive ? axis : axis + 3;
+    }
+  }
+
+  u32 found = 0;
+  u32 stack[BVH_STACK_SIZE];
+  u32 top = 0;
+  if (b->node_count) {
+    stack[top++] = 0;
+  }
+
+  while (top) {
+    u32 entry = stack[--top];
+    const bvh_node *node = &b->nodes[entry & ~INSIDE_BIT];
+    u32 visible;
+    u32 inside;
+    if (entry & INSIDE_BIT) {
+      visible = inside = 0xF;
+    } else {
+      visible = frustum_mask(node, &test, &inside);
+    }
+
+    for (u32 c = 0; c < BVH_WIDTH; ++c) {
+      u32 child = node->children[c];
+      if (!(visible & (1u << c)) || child == BVH_CHILD_EMPTY) {
+        continue;
+      }
+
+      b8 is_inside = (inside & (1u << c)) != 0;
+      if (!node->counts[c]) {
+        stack[top++] = child | (is_inside ? INSIDE_BIT : 0);
+        continue;
+      }
+      for (u32 k = child; k < child + node->counts[c]; ++k) {
+        if (b->proxies[k] != BVH_PROXY_INVALID &&
+            (is_inside || frustum_intersects_aabb(frustum, b->bounds[k]))) {
+          emit(b->proxies[k], out_proxies, max_proxies, &found);
+        }
+      }
+    }
+  }
+
+  for (u32 k = b->built_count; k < b->object_count; ++k) {
+    if (frustum_intersects_aabb(frustum, b->bounds[k])) {
+      emit(b->proxies[k], out_proxies, max_proxies, &found);
+    }
+  }
+
+  return found;
+}
+
+/**
+ * A ray prepared for slab tests: per axis, the bounds rows the ray enters
+ * and leaves through and its inverse direction. Axes the ray is parallel to
+ * get a huge inverse, which rejects boxes the origin is not between.
+ */
+typedef struct ray_test {
+  f32 origin[3];
+  f32 inverse[3];
+  u32 enter_rows[3];
+  u32 exit_rows[3];
+} ray_test;
+
+/**
+ * Tests the node's children against the ray, up to max_distance.
+ *
+ * @param out_distances Receives where the ray enters each child.
+ * @return The children the ray hits, one bit each.
+ */
+static inline u32 ray_mask(const bvh_node *node, const ray_test *test,
+                           f32 max_distance, f32 *out_distances) {
+#ifdef VSIMD_SSE
+  __m128 t_enter = _mm_setzero_ps();
+  __m128 t_exit = _mm_set1_ps(max_distance);
+  for (u32 axis = 0; axis < 3; ++axis) {
+    __m128 origin = _mm_set1_ps(test->origin[axis]);
+    __m128 inverse = _mm_set1_ps(test->inverse[axis]);
+    __m128 t0 = _mm_mul_ps(
+        _mm_sub_ps(_mm_load_ps(node->bounds[test->enter_rows[axis]]), origin),
+        inverse);
+    __m128 t1 = _mm_mul_ps(
+        _mm_sub_ps(_mm_load_ps(node->bounds[test->exit_rows[axis]]), origin),
+        inverse);
+    t_enter = _mm_max_ps(t_enter, t0);
+    t_exit = _mm_min_ps(t_exit, t1);
+  }
+  _mm_storeu_ps(out_distances, t_enter);
+  return (u32)_mm_movemask_ps(_mm_cmple_ps(t_enter, t_exit));
+#else
+  u32 mask = 0;
+  for (u32 c = 0; c < BVH_WIDTH; ++c) {
+    f32 t_enter = 0.0f;
+    f32 t_exit = max_distance;
+    for (u32 axis = 0; axis < 3; ++axis) {
+      f32 origin = test->origin[axis];
+      f32 inverse = test->inverse[axis];
+      f32 enter_bound = node->bounds[test->enter_rows[axis]][c];
+      f32 exit_bound = node->bounds[test->exit_rows[axis]][c];
+      t_enter = vmax(t_enter, (enter_bound - origin) * inverse);
+      t_exit = vmin(t_exit, (exit_bound - origin) * inverse);
+    }
+    out_distances[c] = t_enter;
+    if (t_enter <= t_exit) {
+      mask |= 1u << c;
+    }
+  }
+  return mask;
+#endif
+}
+
+// Where the ray enters the box, or -1 if it misses or enters past max.
+static f32 ray_box_distance(const aabb *box, const ray_test *test,
+                            f32 max_distance) {
+  f32 t_enter = 0.0f;
+  f32 t_exit = max_distance;
+  for (u32 axis = 0; axis < 3; ++axis) {
+    f32 min = box->min.elements[axis] - test->origin[axis];
+    f32 max = box->max.elements[axis] - test->origin[axis];
+    b8 is_positive = test->enter_rows[axis] == axis;
+    t_enter = vmax(t_enter, (is_positive ? min : max) * test->inverse[axis]);
+    t_exit = vmin(t_exit, (is_positive ? max : min) * test->inverse[axis]);
+  }
+  return t_enter <= t_exit ? t_enter : -1.0f;
+}
+
+b8 bvh_raycast(const bvh *b, ray r, f32 max_distance, bvh_ray_hit *out_hit) {
+  ray_test test;
+  for (u32 axis = 0; axis < 3; ++axis) {
+    f32 direction = r.direction.elements[axis];
+    test.origin[axis] = r.origin.elements[axis];
+    test.inverse[axis] = direction != 0.0f ? 1.0f / direction : V_FLOAT_MAX;
+    b8 is_positive = test.inverse[axis] >= 0.0f;
+    test.enter_rows[axis] = is_positive ? axis : axis + 3;
+    test.exit_rows[axis] = is_positive ? axis + 3 : axis;
+  }
+
+  bvh_ray_hit hit = {BVH_PROXY_INVALID, max_distance};
+
+  // Removed objects have empty bounds and are never hit.
+  for (u32 k = b->built_count; k < b->object_count; ++k) {
+    f32 distance = ray_box_distance(&b->bounds[k], &test, hit.distance);
+    if (distance >= 0.0f) {
+      hit = (bvh_ray_hit){b->proxies[k], distance};
+    }
+  }
+
+  u32 stack[BVH_STACK_SIZE];
+  f32 stack_distances[BVH_STACK_SIZE];
+  u32 top = 0;
+  if (b->node_count) {
+    stack[top] = 0;
+    stack_distances[top++] = 0.0f;
+  }
+
+  while (top) {
+    --top;
+    if (stack_distances[top] > hit.distance) {
+      continue;
+    }
+
+    const bvh_node *node = &b->nodes[stack[top]];
+    f32 distances[BVH_WIDTH];
+    u32 mask = ray_mask(node, &test, hit.distance, distances);
+
+    // Leaves right away. Inner children sorted furthest first, so the
+    // nearest is popped next.
+    u32 inner[BVH_WIDTH];
+    u32 inner_count = 0;
+    for (u32 c = 0; c < BVH_WIDTH; ++c) {
+      if (!(mask & (1u << c))) {
+        continue;
+      }
+
+      u32 child = node->children[c];
+      if (!node->counts[c]) {
+        u32 slot = inner_count++;
+        while (slot > 0 && distances[inner[slot - 1]] < distances[c]) {
+          inner[slot] = inner[slot - 1];
+          --slot;
+        }
+        inner[slot] = c;
+        continue;
+      }
+      for (u32 k = child; k < child + node->counts[c]; ++k) {
+        f32 distance = ray_box_distance(&b->bounds[k], &test, hit.distance);
+        if (distance >= 0.0f) {
+          hit = (bvh_ray_hit){b->proxies[k], distance};
+        }
+      }
+    }
+
+    for (u32 i = 0; i < inner_count; ++i) {
+      stack[top] = node->children[inner[i]];
+      stack_distances[top++] = distances[inner[i]];
+    }
+  }
+
+  if (hit.proxy == BVH_PROXY_INVALID) {
+    return FALSE;
+  }
+  *out_hit = hit;
+  return TRUE;
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <defines.h>
+#include <math/math_types.h>
+
+/**
+ * Bounding volume hierarchy over the bounding boxes of scene objects, for
+ * overlap, ray and frustum queries that touch only the objects near the
+ * answer.
+ *
+ * Every node has up to four children whose bounds are stored one array per
+ * component, so a query tests all four against its shape in a few SSE
+ * instructions. A child is either another node or a leaf of up to
+ * BVH_LEAF_SIZE objects, whose bounds are stored contiguously in leaf order.
+ *
+ * The tree is kept up to date by bvh_update:
+ * - Moving objects only refits it: one backward pass over the nodes grows or
+ *   shrinks their bounds, without changing its shape.
+ * - New objects are kept outside the tree and tested one by one.
+ * - The tree is rebuilt with the surface area heuristic (SAH) once too many
+ *   objects were added or removed, or once refitting has made the tree much
+ *   worse than a fresh build.
+ *
+ * Queries see the bounds as of the last bvh_update.
+ */
+
+typedef u32 bvh_proxy;
+
+#define BVH_PROXY_INVALID 0xFFFFFFFFu
+
+// Children per node.
+#define BVH_WIDTH 4
+
+// Most objects in a leaf.
+#define BVH_LEAF_SIZE 4
+
+// Unused child slot.
+#define BVH_CHILD_EMPTY 0xFFFFFFFFu
+
+typedef struct bvh_node {
+  /**
+   * Bounds of each child: minimum x, y and z, then maximum x, y and z. Unused
+   * children and leaves of removed objects have empty bounds.
+   */
+  f32 bounds[6][BVH_WIDTH];
+  // The node index of an inner child, or the first object of a leaf.
+  u32 children[BVH_WIDTH];
+  // Objects in a leaf child, 0 for an inner or unused one.
+  u32 counts[BVH_WIDTH];
+} bvh_node;
+
+typedef struct bvh {
+  // In depth-first order, so children follow their parents. Root first.
+  bvh_node *nodes;
+  u32 node_count;
+  u32 node_capacity;
+
+  /**
+   * Objects in leaf order. The first built_count are in the tree and the
+   * rest were inserted since. Removed objects keep their place in the tree
+   * until the next build, with an invalid proxy and empty bounds.
+   */
+  aabb *bounds;
+  bvh_proxy *proxies;
+  u32 object_count;
+  u32 object_capacity;
+  u32 built_count;
+  u32 removed_count;
+
+  // Object index of each proxy. Free proxies chain to the next free one.
+  u32 *objects;
+  u64 *user_data;
+  u32 proxy_count;
+  u32 proxy_capacity;
+  u32 free_proxy;
+
+  // Surface area cost of the tree relative to its root after the last build
+  // and the last refit.
+  f32 build_cost;
+  f32 cost;
+
+  // Set when objects in the tree moved since the last refit.
+  b8 is_refit_needed;
+} bvh;
+
+typedef struct bvh_ray_hit {
+  bvh_proxy proxy;
+  // Where the ray enters the object's bounds, in multiples of its direction.
+  f32 distance;
+} bvh_ray_hit;
+
+/**
+ * Creates an empty hierarchy, with its memory tagged MEMORY_TAG_SCENE. It
+ * grows as needed.
+ *
+ * @param capacity Objects to make room for up front.
+ * @param out_bvh Receives the hierarchy.
+ */
+VAPI void bvh_create(u32 capacity, bvh *out_bvh);
+
+VAPI void bvh_destroy(bvh *bvh);
+
+/**
+ * Refits the tree to moved objects, or rebuilds it when inserted, removed or
+ * moved objects made that worthwhile. Call after changes, before querying.
+ *
+ * @return TRUE if the tree was rebuilt.
+ */
+VAPI b8 bvh_update(bvh *bvh);
+
+// Builds the tree from scratch over all objects.
+VAPI void bvh_rebuild(bvh *bvh);
+
+/**
+ * Adds an object.
+ *
+ * @param bounds The object's bounding box.
+ * @param user_data Returned with the object, e.g. its entity.
+ * @return The object's proxy, which stays valid until it is removed.
+ */
+VAPI bvh_proxy bvh_insert(bvh *bvh, aabb bounds, u64 user_data);
+
+VAPI void bvh_remove(bvh *bvh, bvh_proxy proxy);
+
+// Changes an object's bounding box.
+VAPI void bvh_move(bvh *bvh, bvh_proxy proxy, aabb bounds);
+
+VAPI aabb bvh_get_bounds(const bvh *bvh, bvh_proxy proxy);
+
+VAPI u64 bvh_get_user_data(const bvh *bvh, bvh_proxy proxy);
+
+/**
+ * Finds the objects whose bounds overlap or touch a box.
+ *
+ * @param out_proxies Receives up to max_proxies of them, in no particular
+ * order.
+ * @return The number of objects found, which can exceed max_proxies.
+ */
+VAPI u32 bvh_query_aabb(const bvh *bvh, aabb box, bvh_proxy *out_proxies,
+                        u32 max_proxies);
+
+/**
+ * Finds the objects whose bounds are not entirely behind a plane of the
+ * frustum. Subtrees found entirely inside are taken without further tests.
+ *
+ * @param out_proxies Receives up to max_proxies of them, in no particular
+ * order.
+ * @return The number of objects found, which can exceed max_proxies.
+ */
+VAPI u32 bvh_query_frustum(const bvh *bvh, const frustum *frustum,
+                           bvh_proxy *out_proxies, u32 max_proxies);
+
+/**
+ * Finds the object whose bounds the ray enters first. Nodes are visited
+ * nearest first and skipped once they lie beyond the nearest hit so far.
+ *
+ * @param max_distance Ignores hits further along than this.
+ * @param out_hit Receives the hit, if any.
+ * @return TRUE if the ray hits an object's bounds.
+ */
+VAPI b8 bvh_raycast(const bvh *bvh, ray r, f32 max_distance,
+                    bvh_ray_hit *out_hit);
@@ -0,0 +1,195 @@
+#include <scene/culling.h>
+
+#include <core/job.h>
+#include <math/simd.h>
+#include <math/vmath.h>
+
+// Most blocks frustum_cull_parallel splits the boxes into.
+#define CULL_MAX_BLOCKS 1024
+
+/**
+ * A frustum prepared for culling: per plane, the arrays holding the corner
+ * of each box furthest along its normal. A box is entirely behind the plane
+ * exactly when that corner is.
+ */
+typedef struct cull_planes {
+  plane planes[6];
+  const f32 *corners[6][3];
+} cull_planes;
+
+static void prepare_planes(const frustum *f, aabb_soa boxes,
+                           cull_planes *out_planes) {
+  for (u32 i = 0; i < 6; ++i) {
+    plane p = f->planes[i];
+    out_planes->planes[i] = p;
+    out_planes->corners[i][0] = p.x >= 0.0f ? boxes.max_x : boxes.min_x;
+    out_planes->corners[i][1] = p.y >= 0.0f ? boxes.max_y : boxes.min_y;
+    out_planes->corners[i][2] = p.z >= 0.0f ? boxes.max_z : boxes.min_z;
+  }
+}
+
+/**
+ * Culls the boxes in [start, end).
+ *
+ * @param out_visible Receives the indices of the boxes that pass. Up to
+ * end - start entries may be overwritten.
+ * @return The number of boxes that pass.
+ */
+static u32 cull_range(const cull_planes *cull, u32 start, u32 end,
+                      u32 *out_visible) {
+  u32 visible = 0;
+  u32 i = start;
+
+  // Every lane's index is stored and the count advanced only past those
+  // that pass, which compacts the list without branches. The stores stay
+  // within the lanes already tested.
+#ifdef VSIMD_AVX
+  __m256 zero8 = _mm256_setzero_ps();
+  __m256 normals8[6][4];
+  for (u32 p = 0; p < 6; ++p) {
+    for (u32 k = 0; k < 4; ++k) {
+      normals8[p][k] = _mm256_set1_ps(cull->planes[p].elements[k]);
+    }
+  }
+
+  for (; i + 8 <= end; i += 8) {
+    __m256 outside = zero8;
+    for (u32 p = 0; p < 6; ++p) {
+      const f32 *const *corner = cull->corners[p];
+      __m256 distance = vsimd_madd8(
+          normals8[p][0], _mm256_loadu_ps(&corner[0][i]),
+          vsimd_madd8(normals8[p][1], _mm256_loadu_ps(&corner[1][i]),
+                      vsimd_madd8(normals8[p][2],
+                                  _mm256_loadu_ps(&corner[2][i]),
+                                  normals8[p][3])));
+      outside =
+          _mm256_or_ps(outside, _mm256_cmp_ps(distance, zero8, _CMP_LT_OQ));
+    }
+
+    u32 mask = ~(u32)_mm256_movemask_ps(outside);
+    for (u32 lane = 0; lane < 8; ++lane) {
+      out_visible[visible] = i + lane;
+      visible += (mask >> lane) & 1;
+    }
+  }
+#endif
+
+#ifdef VSIMD_SSE
+  __m128 zero = _mm_setzero_ps();
+  __m128 normals[6][4];
+  for (u32 p = 0; p < 6; ++p) {
+    for (u32 k = 0; k < 4; ++k) {
+      normals[p][k] = _mm_set1_ps(cull->planes[p].elements[k]);
+    }
+  }
+
+  for (; i + 4 <= end; i += 4) {
+    __m128 outside = zero;
+    for (u32 p = 0; p < 6; ++p) {
+      const f32 *const *corner = cull->corners[p];
+      __m128 distance = vsimd_madd(
+          normals[p][0], _mm_loadu_ps(&corner[0][i]),
+          vsimd_madd(normals[p][1], _mm_loadu_ps(&corner[1][i]),
+                     vsimd_madd(normals[p][2], _mm_loadu_ps(&corner[2][i]),
+                                normals[p][3])));
+      outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, zero));
+    }
+
+    u32 mask = ~(u32)_mm_movemask_ps(outside);
+    for (u32 lane = 0; lane < 4; ++lane) {
+      out_visible[visible] = i + lane;
+      visible += (mask >> lane) & 1;
+    }
+  }
+#endif
+
+  for (; i < end; ++i) {
+    b8 is_outside = FALSE;
+    for (u32 p = 0; p < 6; ++p) {
+      plane pl = cull->planes[p];
+      const f32 *const *corner = cull->corners[p];
+      f32 distance = pl.x * corner[0][i] + pl.y * corner[1][i] +
+                     pl.z * corner[2][i] + pl.w;
+      is_outside |= distance < 0.0f;
+    }
+    out_visible[visible] = i;
+    visible += !is_outside;
+  }
+
+  return visible;
+}
+
+u32 frustum_cull(const frustum *frustum, aabb_soa boxes, u32 count,
+                 u32 *out_visible) {
+  cull_planes cull;
+  prepare_planes(frustum, boxes, &cull);
+  return cull_range(&cull, 0, count, out_visible);
+}
+
+typedef struct cull_job {
+  const cull_planes *cull;
+  u32 count;
+  u32 block_size;
+  u32 *out_visible;
+  // Boxes that passed in each block.
+  u32 *block_counts;
+} cull_job;
+
+// Culls blocks [start, end), each into its own part of the output.
+static void cull_blocks(void *params, u32 start, u32 end) {
+  cull_job *job = params;
+  for (u32 block = start; block < end; ++block) {
+    u32 first = block * job->block_size;
+    u32 last = first + job->block_size < job->count ? first + job->block_size
+                                                    : job->count;
+    job->block_counts[block] =
+        cull_range(job->cull, first, last, job->out_visible + first);
+  }
+}
+
+u32 frustum_cull_parallel(const frustum *frustum, aabb_soa boxes, u32 count,
+                          u32 *out_visible, u32 min_batch_size) {
+  if (count == 0) {
+    return 0;
+  }
+
+  cull_planes cull;
+  prepare_planes(frustum, boxes, &cull);
+
+  // Blocks of whole iterations, so only the last one has a scalar tail.
+  u32 block_size = (count + CULL_MAX_BLOCKS - 1) / CULL_MAX_BLOCKS;
+  if (block_size < min_batch_size) {
+    block_size = min_batch_size;
+  }
+  block_size = (u32)VALIGN_UP(block_size, 8);
+  u32 block_count = (count + block_size - 1) / block_size;
+
+  u32 block_counts[CULL_MAX_BLOCKS];
+  cull_job job = {&cull, count, block_size, out_visible, block_counts};
+  job_parallel_for(block_count, 1, cull_blocks, &job);
+
+  // Move each block's list down to the end of the previous one. Lists only
+  // move towards the front, so copying forwards is safe.
+  u32 visible = block_counts[0];
+  for (u32 block = 1; block < block_count; ++block) {
+    const u32 *list = out_visible + block * block_size;
+    for (u32 k = 0; k < block_counts[block]; ++k) {
+      out_visible[visible++] = list[k];
+    }
+  }
+
+  return visible;
+}
+
+u32 frustum_cull_reference(const frustum *frustum, aabb_soa boxes, u32 count,
+                           u32 *out_visible) {
+  u32 visible = 0;
+  for (u32 i = 0; i < count; ++i) {
+    aabb box = {{{boxes.min_x[i], boxes.min_y[i], boxes.min_z[i]}},
+                {{boxes.max_x[i], boxes.max_y[i], boxes.max_z[i]}}};
+    if (frustum_intersects_aabb(frustum, box)) {
+      out_visible[visible++] = i;
+    }
+  }
+  return visible;
+}
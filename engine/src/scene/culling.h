@@ -0,0 +1,42 @@
+#pragma once
+
+#include <defines.h>
+#include <math/math_types.h>
+
+/**
+ * Frustum culling of bounding boxes stored as structure of arrays. Each
+ * iteration tests 8 boxes with AVX, or 4 with SSE, against all six planes,
+ * and appends the indices of those that pass to a compact list in
+ * ascending order.
+ *
+ * A box passes unless it lies entirely behind one plane, the same test as
+ * frustum_intersects_aabb, so boxes near a corner of the frustum can pass
+ * while outside it.
+ */
+
+/**
+ * Culls count boxes on the calling thread.
+ *
+ * @param out_visible Receives the indices of the boxes that pass. Must hold
+ * count entries, all of which may be overwritten.
+ * @return The number of boxes that pass.
+ */
+VAPI u32 frustum_cull(const frustum *frustum, aabb_soa boxes, u32 count,
+                      u32 *out_visible);
+
+/**
+ * Like frustum_cull, but splits the boxes into blocks culled across the job
+ * system, then closes the gaps between the blocks' lists. Returns once done.
+ *
+ * @param min_batch_size Fewest boxes culled by one job.
+ */
+VAPI u32 frustum_cull_parallel(const frustum *frustum, aabb_soa boxes,
+                               u32 count, u32 *out_visible,
+                               u32 min_batch_size);
+
+/**
+ * Like frustum_cull, one box at a time with frustum_intersects_aabb. The
+ * reference to check the batched code against.
+ */
+VAPI u32 frustum_cull_reference(const frustum *frustum, aabb_soa boxes,
+                                u32 count, u32 *out_visible);
@@ -0,0 +1,82 @@
+#include <scene/scene.h>
+
+#include <core/vmemory.h>
+
+void scene_create(u32 capacity, scene *out_scene) {
+  vzero_memory(out_scene, sizeof(scene));
+  transform_hierarchy_create(capacity, &out_scene->transforms);
+  transform_hierarchy_attach(&out_scene->transforms, sizeof(u8),
+                             MEMORY_TAG_SCENE);
+  transform_hierarchy_attach(&out_scene->transforms, sizeof(u64),
+                             MEMORY_TAG_SCENE);
+}
+
+void scene_destroy(scene *scene) {
+  transform_hierarchy_destroy(&scene->transforms);
+}
+
+u32 scene_update(scene *scene) {
+  return transform_hierarchy_update(&scene->transforms);
+}
+
+scene_node scene_node_create(scene *scene, scene_node parent, u64 user_data) {
+  scene_node node = transform_create(&scene->transforms, parent);
+  if (node != SCENE_NODE_INVALID) {
+    scene_user_data(scene)[scene->transforms.indices[node]] = user_data;
+  }
+  return node;
+}
+
+void scene_node_destroy(scene *scene, scene_node node) {
+  transform_destroy(&scene->transforms, node);
+}
+
+b8 scene_node_set_parent(scene *scene, scene_node node, scene_node parent) {
+  return transform_set_parent(&scene->transforms, node, parent);
+}
+
+void scene_node_set_visible(scene *scene, scene_node node, b8 visible) {
+  u8 *flags = &scene_flags(scene)[scene->transforms.indices[node]];
+  *flags = visible ? *flags & ~SCENE_NODE_FLAG_HIDDEN
+                   : *flags | SCENE_NODE_FLAG_HIDDEN;
+}
+
+b8 scene_node_is_visible(const scene *scene, scene_node node) {
+  return !(scene_flags(scene)[scene->transforms.indices[node]] &
+           SCENE_NODE_FLAG_HIDDEN);
+}
+
+void scene_node_set_user_data(scene *scene, scene_node node, u64 user_data) {
+  scene_user_data(scene)[scene->transforms.indices[node]] = user_data;
+}
+
+u64 scene_node_get_user_data(const scene *scene, scene_node node) {
+  return scene_user_data(scene)[scene->transforms.indices[node]];
+}
+
+u32 scene_traverse(const scene *scene, pfn_scene_visit visit, void *params) {
+  const u32 *subtree_sizes = scene->transforms.subtree_sizes;
+  u32 count = scene->transforms.count;
+  u32 visited = 0;
+  for (u32 i = 0; i < count; ++visited) {
+    i += visit(scene, i, params) ? 1 : subtree_sizes[i];
+  }
+
+  return visited;
+}
+
+u32 scene_gather_visible(const scene *scene, u32 *out_indices) {
+  const u32 *subtree_sizes = scene->transforms.subtree_sizes;
+  const u8 *flags = scene_flags(scene);
+  u32 count = scene->transforms.count;
+  u32 visible = 0;
+  for (u32 i = 0; i < count;) {
+    if (flags[i] & SCENE_NODE_FLAG_HIDDEN) {
+      i += subtree_sizes[i];
+    } else {
+      out_indices[visible++] = i++;
+    }
+  }
+
+  return visible;
+}
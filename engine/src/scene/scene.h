@@ -0,0 +1,121 @@
+#pragma once
+
+#include <defines.h>
+#include <scene/transform_hierarchy.h>
+
+/**
+ * A scene graph stored flat. The nodes live in a transform hierarchy, which
+ * keeps them in depth-first order as a parent index and a subtree size per
+ * node, and the scene attaches its own per-node arrays to it. Traversals are
+ * then one forward walk over contiguous arrays, and a whole subtree is
+ * skipped by stepping over subtree_sizes[i] nodes, with no pointers to chase.
+ *
+ * Creating, reparenting and destroying nodes only records the change. The
+ * next scene_update re-sorts every array once for all of them and then
+ * recomputes the world matrices that changed. The traversals below walk the
+ * order of the last update.
+ *
+ * Nodes are addressed by the hierarchy's handles. Local transforms are set
+ * through the hierarchy, as in transform_set_position(&scene->transforms,
+ * node, position).
+ */
+
+typedef transform_handle scene_node;
+
+#define SCENE_NODE_INVALID TRANSFORM_HANDLE_INVALID
+
+// The node and its descendants are hidden.
+#define SCENE_NODE_FLAG_HIDDEN 0x1
+
+// The scene's arrays in transforms.attachments.
+#define SCENE_ATTACHMENT_FLAGS 0
+#define SCENE_ATTACHMENT_USER_DATA 1
+
+typedef struct scene {
+  transform_hierarchy transforms;
+} scene;
+
+/**
+ * Called by scene_traverse for each node in depth-first order.
+ *
+ * @param index The node's index into the hierarchy and scene arrays.
+ * @return FALSE to skip the node's descendants.
+ */
+typedef b8 (*pfn_scene_visit)(const scene *scene, u32 index, void *params);
+
+/**
+ * Creates an empty scene, with its arrays tagged MEMORY_TAG_SCENE.
+ *
+ * @param capacity Nodes to make room for up front.
+ * @param out_scene Receives the scene.
+ */
+VAPI void scene_create(u32 capacity, scene *out_scene);
+
+VAPI void scene_destroy(scene *scene);
+
+/**
+ * Re-sorts the nodes if the structure changed and recomputes dirty world
+ * matrices.
+ *
+ * @return Number of world matrices recomputed.
+ */
+VAPI u32 scene_update(scene *scene);
+
+/**
+ * Adds a visible node with the identity transform.
+ *
+ * @param parent The parent, or SCENE_NODE_INVALID for a root.
+ * @param user_data Stored with the node, e.g. an entity or a mesh id.
+ * @return The node, or SCENE_NODE_INVALID if parent is not valid.
+ */
+VAPI scene_node scene_node_create(scene *scene, scene_node parent,
+                                  u64 user_data);
+
+// Removes the node and its descendants.
+VAPI void scene_node_destroy(scene *scene, scene_node node);
+
+/**
+ * Moves the node, with its descendants, under a new parent.
+ *
+ * @return FALSE if parent is the node itself or one of its descendants.
+ */
+VAPI b8 scene_node_set_parent(scene *scene, scene_node node, scene_node parent);
+
+// Hiding a node hides its descendants too, whatever their own setting.
+VAPI void scene_node_set_visible(scene *scene, scene_node node, b8 visible);
+
+// The node's own setting, regardless of its ancestors.
+VAPI b8 scene_node_is_visible(const scene *scene, scene_node node);
+
+VAPI void scene_node_set_user_data(scene *scene, scene_node node,
+                                   u64 user_data);
+
+VAPI u64 scene_node_get_user_data(const scene *scene, scene_node node);
+
+/**
+ * Visits the nodes in depth-first order, skipping the descendants of nodes
+ * for which visit returns FALSE.
+ *
+ * @return Number of nodes visited.
+ */
+VAPI u32 scene_traverse(const scene *scene, pfn_scene_visit visit,
+                        void *params);
+
+/**
+ * Lists the indices of the nodes that are neither hidden nor below a hidden
+ * node, in depth-first order.
+ *
+ * @param out_indices Receives the indices. Must hold transforms.count.
+ * @return Number of indices written.
+ */
+VAPI u32 scene_gather_visible(const scene *scene, u32 *out_indices);
+
+// Per-node flags, indexed like the hierarchy's arrays.
+static inline u8 *scene_flags(const scene *scene) {
+  return scene->transforms.attachments[SCENE_ATTACHMENT_FLAGS].data;
+}
+
+// Per-node user data, indexed like the hierarchy's arrays.
+static inline u64 *scene_user_data(const scene *scene) {
+  return scene->transforms.attachments[SCENE_ATTACHMENT_USER_DATA].data;
+}
@@ -0,0 +1,492 @@
+#include <scene/transform_hierarchy.h>
+
+#include <core/vmemory.h>
+#include <math/vmath.h>
+
+#include <stdlib.h>
+
+#define TRANSFORM_MIN_CAPACITY 64
+
+// The node is queued in dirty_handles.
+#define TRANSFORM_FLAG_DIRTY 0x1
+// The node is removed with its subtree at the next re-sort.
+#define TRANSFORM_FLAG_DESTROYED 0x2
+// Set during a dense update on nodes recomputed so far this pass.
+#define TRANSFORM_FLAG_UPDATED 0x4
+
+// Marks stack entries below a destroyed node during a re-sort.
+#define REMOVED_BIT 0x80000000u
+
+/**
+ * Past this share of dirty nodes, one pass over every node is cheaper than
+ * sorting the dirty ones.
+ */
+#define DENSE_UPDATE_DIVISOR 32
+
+// Moves an array into a larger allocation.
+static void resize(void **array, u64 stride, u32 old_capacity,
+                   u32 new_capacity, memory_tag tag) {
+  void *resized = vallocate_aligned(stride * new_capacity, tag);
+  if (*array) {
+    vcopy_memory(resized, *array, stride * old_capacity);
+    vfree_aligned(*array, stride * old_capacity, tag);
+  }
+  *array = resized;
+}
+
+static void set_capacity(transform_hierarchy *h, u32 capacity) {
+  u32 old = h->capacity;
+  resize((void **)&h->positions, sizeof(vec3), old, capacity,
+         MEMORY_TAG_TRANSFORM);
+  resize((void **)&h->rotations, sizeof(quat), old, capacity,
+         MEMORY_TAG_TRANSFORM);
+  resize((void **)&h->scales, sizeof(vec3), old, capacity,
+         MEMORY_TAG_TRANSFORM);
+  resize((void **)&h->world_matrices, sizeof(mat4), old, capacity,
+         MEMORY_TAG_TRANSFORM);
+  resize((void **)&h->parents, sizeof(u32), old, capacity,
+         MEMORY_TAG_ENTITIY_NODE);
+  resize((void **)&h->subtree_sizes, sizeof(u32), old, capacity,
+         MEMORY_TAG_ENTITIY_NODE);
+  resize((void **)&h->handles, sizeof(transform_handle), old, capacity,
+         MEMORY_TAG_ENTITIY_NODE);
+  resize((void **)&h->flags, sizeof(u8), old, capacity,
+         MEMORY_TAG_ENTITIY_NODE);
+  resize((void **)&h->indices, sizeof(u32), old, capacity,
+         MEMORY_TAG_ENTITIY_NODE);
+  resize((void **)&h->dirty_handles, sizeof(transform_handle), old, capacity,
+         MEMORY_TAG_ENTITIY_NODE);
+  for (u32 i = 0; i < h->attachment_count; ++i) {
+    transform_attachment *attachment = &h->attachments[i];
+    resize(&attachment->data, attachment->stride, old, capacity,
+           attachment->tag);
+  }
+  h->capacity = capacity;
+}
+
+void transform_hierarchy_create(u32 capacity,
+                                transform_hierarchy *out_hierarchy) {
+  vzero_memory(out_hierarchy, sizeof(transform_hierarchy));
+  out_hierarchy->free_handle = TRANSFORM_HANDLE_INVALID;
+  set_capacity(out_hierarchy, capacity > TRANSFORM_MIN_CAPACITY
+                                  ? capacity
+                                  : TRANSFORM_MIN_CAPACITY);
+}
+
+void transform_hierarchy_destroy(transform_hierarchy *h) {
+  u32 capacity = h->capacity;
+  vfree_aligned(h->positions, sizeof(vec3) * capacity, MEMORY_TAG_TRANSFORM);
+  vfree_aligned(h->rotations, sizeof(quat) * capacity, MEMORY_TAG_TRANSFORM);
+  vfree_aligned(h->scales, sizeof(vec3) * capacity, MEMORY_TAG_TRANSFORM);
+  vfree_aligned(h->world_matrices, sizeof(mat4) * capacity,
+                MEMORY_TAG_TRANSFORM);
+  vfree_aligned(h->parents, sizeof(u32) * capacity, MEMORY_TAG_ENTITIY_NODE);
+  vfree_aligned(h->subtree_sizes, sizeof(u32) * capacity,
+                MEMORY_TAG_ENTITIY_NODE);
+  vfree_aligned(h->handles, sizeof(transform_handle) * capacity,
+                MEMORY_TAG_ENTITIY_NODE);
+  vfree_aligned(h->flags, sizeof(u8) * capacity, MEMORY_TAG_ENTITIY_NODE);
+  vfree_aligned(h->indices, sizeof(u32) * capacity, MEMORY_TAG_ENTITIY_NODE);
+  vfree_aligned(h->dirty_handles, sizeof(transform_handle) * capacity,
+                MEMORY_TAG_ENTITIY_NODE);
+  for (u32 i = 0; i < h->attachment_count; ++i) {
+    transform_attachment *attachment = &h->attachments[i];
+    vfree_aligned(attachment->data, (u64)attachment->stride * capacity,
+                  attachment->tag);
+  }
+  vzero_memory(h, sizeof(transform_hierarchy));
+}
+
+u32 transform_hierarchy_attach(transform_hierarchy *h, u32 stride,
+                               memory_tag tag) {
+  if (h->attachment_count == TRANSFORM_MAX_ATTACHMENTS) {
+    return TRANSFORM_ATTACHMENT_INVALID;
+  }
+
+  transform_attachment *attachment = &h->attachments[h->attachment_count];
+  attachment->data = vallocate_aligned((u64)stride * h->capacity, tag);
+  vzero_memory(attachment->data, (u64)stride * h->capacity);
+  attachment->stride = stride;
+  attachment->tag = tag;
+  return h->attachment_count++;
+}
+
+b8 transform_is_valid(const transform_hierarchy *h, transform_handle handle) {
+  if (handle >= h->handle_count) {
+    return FALSE;
+  }
+
+  // A free handle's entry links to another free handle, which is either out
+  // of range or the index of a node with a different handle.
+  u32 index = h->indices[handle];
+  return index < h->count && h->handles[index] == handle &&
+         !(h->flags[index] & TRANSFORM_FLAG_DESTROYED);
+}
+
+static void mark_dirty(transform_hierarchy *h, u32 index) {
+  if (!(h->flags[index] & TRANSFORM_FLAG_DIRTY)) {
+    h->flags[index] |= TRANSFORM_FLAG_DIRTY;
+    h->dirty_handles[h->dirty_count++] = h->handles[index];
+  }
+}
+
+static void free_handle(transform_hierarchy *h, transform_handle handle) {
+  h->indices[handle] = h->free_handle;
+  h->free_handle = handle;
+}
+
+transform_handle transform_create(transform_hierarchy *h,
+                                  transform_handle parent) {
+  u32 parent_index = TRANSFORM_NO_PARENT;
+  if (parent != TRANSFORM_HANDLE_INVALID) {
+    if (!transform_is_valid(h, parent)) {
+      return TRANSFORM_HANDLE_INVALID;
+    }
+    parent_index = h->indices[parent];
+  }
+
+  if (h->count == h->capacity) {
+    set_capacity(h, h->capacity * 2);
+  }
+
+  transform_handle handle = h->free_handle;
+  if (handle != TRANSFORM_HANDLE_INVALID) {
+    h->free_handle = h->indices[handle];
+  } else {
+    handle = h->handle_count++;
+  }
+
+  u32 index = h->count++;
+  h->indices[handle] = index;
+  h->handles[index] = handle;
+  h->positions[index] = vec3_zero();
+  h->rotations[index] = quat_identity();
+  h->scales[index] = vec3_one();
+  h->world_matrices[index] = mat4_identity();
+  h->parents[index] = parent_index;
+  h->subtree_sizes[index] = 1;
+  h->flags[index] = 0;
+  for (u32 i = 0; i < h->attachment_count; ++i) {
+    transform_attachment *attachment = &h->attachments[i];
+    vzero_memory((u8 *)attachment->data + (u64)attachment->stride * index,
+                 attachment->stride);
+  }
+  mark_dirty(h, index);
+
+  // Appending keeps the order if the parent's subtree ends at the back, and
+  // then so do the subtrees of all its ancestors.
+  if (parent_index != TRANSFORM_NO_PARENT && !h->is_order_dirty) {
+    if (parent_index + h->subtree_sizes[parent_index] == index) {
+      for (u32 p = parent_index; p != TRANSFORM_NO_PARENT; p = h->parents[p]) {
+        h->subtree_sizes[p]++;
+      }
+    } else {
+      h->is_order_dirty = TRUE;
+    }
+  }
+
+  return handle;
+}
+
+void transform_destroy(transform_hierarchy *h, transform_handle handle) {
+  if (!transform_is_valid(h, handle)) {
+    return;
+  }
+
+  h->flags[h->indices[handle]] |= TRANSFORM_FLAG_DESTROYED;
+  h->is_order_dirty = TRUE;
+}
+
+b8 transform_set_parent(transform_hierarchy *h, transform_handle handle,
+                        transform_handle parent) {
+  if (!transform_is_valid(h, handle)) {
+    return FALSE;
+  }
+
+  u32 index = h->indices[handle];
+  u32 parent_index = TRANSFORM_NO_PARENT;
+  if (parent != TRANSFORM_HANDLE_INVALID) {
+    if (!transform_is_valid(h, parent)) {
+      return FALSE;
+    }
+    parent_index = h->indices[parent];
+
+    // Parent links stay acyclic, so this walk ends even out of order.
+    for (u32 p = parent_index; p != TRANSFORM_NO_PARENT; p = h->parents[p]) {
+      if (p == index) {
+        return FALSE;
+      }
+    }
+  }
+
+  if (h->parents[index] != parent_index) {
+    h->parents[index] = parent_index;
+    h->is_order_dirty = TRUE;
+    mark_dirty(h, index);
+  }
+
+  return TRUE;
+}
+
+// Gathers array[order[k]] into scratch, then copies it back.
+#define PERMUTE(array, type, order, count, scratch)                            \
+  {                                                                            \
+    type *_sorted = (type *)(scratch);                                         \
+    for (u32 _k = 0; _k < (count); ++_k) {                                     \
+      _sorted[_k] = (array)[(order)[_k]];                                      \
+    }                                                                          \
+    vcopy_memory(array, _sorted, sizeof(type) * (count));                      \
+  }
+
+// PERMUTE for an array of stride byte elements.
+static void permute_bytes(void *array, u32 stride, const u32 *order, u32 count,
+                          void *scratch) {
+  u8 *source = array;
+  u8 *sorted = scratch;
+  for (u32 k = 0; k < count; ++k) {
+    vcopy_memory(sorted + (u64)stride * k, source + (u64)stride * order[k],
+                 stride);
+  }
+  vcopy_memory(array, sorted, (u64)stride * count);
+}
+
+/**
+ * Sorts the nodes back into depth-first order, keeping siblings in their
+ * current order, and drops destroyed subtrees. Linear in the node count.
+ */
+static void restore_order(transform_hierarchy *h) {
+  u32 n = h->count;
+  h->is_order_dirty = FALSE;
+  if (n == 0) {
+    return;
+  }
+
+  // order, new_index, children and stack hold n entries each. child_start
+  // holds n + 2, with the roots listed under a virtual parent n.
+  u64 scratch_size = sizeof(u32) * (4 * (u64)n + n + 2);
+  u32 *order = vallocate(scratch_size, MEMORY_TAG_ENTITIY_NODE);
+  u32 *new_index = order + n;
+  u32 *children = new_index + n;
+  u32 *stack = children + n;
+  u32 *child_start = stack + n;
+
+  // Group the children of each node with a counting sort on the parent.
+  for (u32 i = 0; i < n; ++i) {
+    u32 parent = h->parents[i] == TRANSFORM_NO_PARENT ? n : h->parents[i];
+    child_start[parent + 1]++;
+  }
+  for (u32 i = 1; i < n + 2; ++i) {
+    child_start[i] += child_start[i - 1];
+  }
+  // Fill using new_index as the insertion cursors.
+  vcopy_memory(new_index, child_start, sizeof(u32) * n);
+  u32 root_cursor = child_start[n];
+  for (u32 i = 0; i < n; ++i) {
+    u32 parent = h->parents[i];
+    if (parent == TRANSFORM_NO_PARENT) {
+      children[root_cursor++] = i;
+    } else {
+      children[new_index[parent]++] = i;
+    }
+  }
+
+  // Depth first. Children are pushed in reverse to come out in order.
+  u32 top = 0;
+  for (u32 k = child_start[n + 1]; k > child_start[n]; --k) {
+    stack[top++] = children[k - 1];
+  }
+
+  u32 kept = 0;
+  while (top) {
+    u32 entry = stack[--top];
+    u32 node = entry & ~REMOVED_BIT;
+    u32 removed = entry & REMOVED_BIT;
+    if (h->flags[node] & TRANSFORM_FLAG_DESTROYED) {
+      removed = REMOVED_BIT;
+    }
+
+    if (removed) {
+      free_handle(h, h->handles[node]);
+    } else {
+      new_index[node] = kept;
+      order[kept++] = node;
+    }
+
+    for (u32 k = child_start[node + 1]; k > child_start[node]; --k) {
+      stack[top++] = children[k - 1] | removed;
+    }
+  }
+
+  // A kept node's parent is kept too, and already has its new index.
+  u32 *parents = stack;
+  for (u32 k = 0; k < kept; ++k) {
+    u32 parent = h->parents[order[k]];
+    parents[k] =
+        parent == TRANSFORM_NO_PARENT ? TRANSFORM_NO_PARENT : new_index[parent];
+  }
+  vcopy_memory(h->parents, parents, sizeof(u32) * kept);
+
+  u64 scratch_stride = sizeof(mat4);
+  for (u32 i = 0; i < h->attachment_count; ++i) {
+    if (h->attachments[i].stride > scratch_stride) {
+      scratch_stride = h->attachments[i].stride;
+    }
+  }
+  void *scratch = vallocate(scratch_stride * n, MEMORY_TAG_TRANSFORM);
+  PERMUTE(h->positions, vec3, order, kept, scratch);
+  PERMUTE(h->rotations, quat, order, kept, scratch);
+  PERMUTE(h->scales, vec3, order, kept, scratch);
+  PERMUTE(h->world_matrices, mat4, order, kept, scratch);
+  PERMUTE(h->handles, transform_handle, order, kept, scratch);
+  PERMUTE(h->flags, u8, order, kept, scratch);
+  for (u32 i = 0; i < h->attachment_count; ++i) {
+    permute_bytes(h->attachments[i].data, h->attachments[i].stride, order,
+                  kept, scratch);
+  }
+  vfree(scratch, scratch_stride * n, MEMORY_TAG_TRANSFORM);
+  vfree(order, scratch_size, MEMORY_TAG_ENTITIY_NODE);
+
+  // Children come after their parents, so one backward pass sums subtrees.
+  for (u32 k = 0; k < kept; ++k) {
+    h->subtree_sizes[k] = 1;
+    h->indices[h->handles[k]] = k;
+  }
+  for (u32 k = kept; k-- > 0;) {
+    if (h->parents[k] != TRANSFORM_NO_PARENT) {
+      h->subtree_sizes[h->parents[k]] += h->subtree_sizes[k];
+    }
+  }
+
+  h->count = kept;
+}
+
+static inline void compute_world(transform_hierarchy *h, u32 index) {
+  mat4 local = mat4_from_trs(h->positions[index], h->rotations[index],
+                             h->scales[index]);
+  u32 parent = h->parents[index];
+  h->world_matrices[index] =
+      parent == TRANSFORM_NO_PARENT
+          ? local
+          : mat4_mul(h->world_matrices[parent], local);
+}
+
+static i32 compare_indices(const void *a, const void *b) {
+  u32 left = *(const u32 *)a;
+  u32 right = *(const u32 *)b;
+  return (left > right) - (left < right);
+}
+
+/**
+ * Recomputes every dirty node and whatever lies below one, in one pass. The
+ * pass rewrites each node's UPDATED mark before any child reads it, so marks
+ * left from an earlier pass are never seen.
+ */
+static u32 update_dense(transform_hierarchy *h) {
+  u32 recomputed = 0;
+  for (u32 i = 0; i < h->count; ++i) {
+    u8 flags = h->flags[i];
+    u32 parent = h->parents[i];
+    if ((flags & TRANSFORM_FLAG_DIRTY) ||
+        (parent != TRANSFORM_NO_PARENT &&
+         (h->flags[parent] & TRANSFORM_FLAG_UPDATED))) {
+      compute_world(h, i);
+      h->flags[i] = (flags & ~TRANSFORM_FLAG_DIRTY) | TRANSFORM_FLAG_UPDATED;
+      recomputed++;
+    } else {
+      h->flags[i] = flags & ~TRANSFORM_FLAG_UPDATED;
+    }
+  }
+
+  return recomputed;
+}
+
+/**
+ * Recomputes the subtrees of the dirty nodes in ascending order, skipping
+ * nodes inside a subtree already done. Touches only the dirty subtrees.
+ */
+static u32 update_sparse(transform_hierarchy *h) {
+  // Reuse the handle list for the indices.
+  u32 *dirty = h->dirty_handles;
+  u32 dirty_count = 0;
+  for (u32 i = 0; i < h->dirty_count; ++i) {
+    if (transform_is_valid(h, h->dirty_handles[i])) {
+      dirty[dirty_count++] = h->indices[h->dirty_handles[i]];
+    }
+  }
+  qsort(dirty, dirty_count, sizeof(u32), compare_indices);
+
+  u32 recomputed = 0;
+  u32 end = 0;
+  for (u32 i = 0; i < dirty_count; ++i) {
+    u32 root = dirty[i];
+    if (root < end) {
+      continue;
+    }
+
+    end = root + h->subtree_sizes[root];
+    for (u32 k = root; k < end; ++k) {
+      compute_world(h, k);
+      h->flags[k] &= ~TRANSFORM_FLAG_DIRTY;
+    }
+    recomputed += end - root;
+  }
+
+  return recomputed;
+}
+
+u32 transform_hierarchy_update(transform_hierarchy *h) {
+  if (h->is_order_dirty) {
+    restore_order(h);
+  }
+
+  if (h->dirty_count == 0) {
+    return 0;
+  }
+
+  u32 recomputed = h->dirty_count > h->count / DENSE_UPDATE_DIVISOR
+                       ? update_dense(h)
+                       : update_sparse(h);
+  h->dirty_count = 0;
+  return recomputed;
+}
+
+void transform_set_position(transform_hierarchy *h, transform_handle handle,
+                            vec3 position) {
+  u32 index = h->indices[handle];
+  h->positions[index] = position;
+  mark_dirty(h, index);
+}
+
+void transform_set_rotation(transform_hierarchy *h, transform_handle handle,
+                            quat rotation) {
+  u32 index = h->indices[handle];
+  h->rotations[index] = rotation;
+  mark_dirty(h, index);
+}
+
+void transform_set_scale(transform_hierarchy *h, transform_handle handle,
+                         vec3 scale) {
+  u32 index = h->indices[handle];
+  h->scales[index] = scale;
+  mark_dirty(h, index);
+}
+
+vec3 transform_get_position(const transform_hierarchy *h,
+                            transform_handle handle) {
+  return h->positions[h->indices[handle]];
+}
+
+quat transform_get_rotation(const transform_hierarchy *h,
+                            transform_handle handle) {
+  return h->rotations[h->indices[handle]];
+}
+
+vec3 transform_get_scale(const transform_hierarchy *h,
+                         transform_handle handle) {
+  return h->scales[h->indices[handle]];
+}
+
+const mat4 *transform_get_world(const transform_hierarchy *h,
+                                transform_handle handle) {
+  return &h->world_matrices[h->indices[handle]];
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <core/vmemory.h>
+#include <defines.h>
+#include <math/math_types.h>
+
+/**
+ * A hierarchy of transforms stored as structure of arrays: positions,
+ * rotations, scales and world matrices each live in their own array, indexed
+ * by node. Nodes are kept in depth-first order, so a parent precedes its
+ * children and every subtree is a contiguous run of subtree_sizes[i] nodes
+ * starting at the subtree's root.
+ *
+ * Changing a local transform marks the node dirty. transform_hierarchy_update
+ * then recomputes world matrices in one forward pass over the dirty subtrees
+ * only, so the cost follows what moved rather than the size of the scene.
+ *
+ * Structural changes (creating, reparenting or destroying nodes) are cheap
+ * until the next update, which restores the depth-first order in one pass
+ * over all nodes when anything changed. Nodes appended below the most
+ * recently added branch, as when a scene is loaded depth first, keep the
+ * order and need no re-sort.
+ *
+ * Nodes are addressed by handles, which stay valid across re-sorts. Node
+ * indices do not. Destroyed handles are reused. The accessors below expect a
+ * valid handle.
+ *
+ * Other systems can attach per-node arrays of their own, which the hierarchy
+ * grows and re-sorts along with its own arrays, so they can be walked in the
+ * same depth-first order without going through handles.
+ */
+
+typedef u32 transform_handle;
+
+#define TRANSFORM_HANDLE_INVALID 0xFFFFFFFFu
+
+// Parent index of a root node.
+#define TRANSFORM_NO_PARENT 0xFFFFFFFFu
+
+// Most per-node arrays that can be attached to one hierarchy.
+#define TRANSFORM_MAX_ATTACHMENTS 4
+
+#define TRANSFORM_ATTACHMENT_INVALID 0xFFFFFFFFu
+
+// A per-node array owned by the hierarchy on behalf of another system.
+typedef struct transform_attachment {
+  // stride bytes per node, indexed like the node arrays.
+  void *data;
+  u32 stride;
+  memory_tag tag;
+} transform_attachment;
+
+typedef struct transform_hierarchy {
+  u32 count;
+  u32 capacity;
+
+  // Local transforms, with MEMORY_TAG_TRANSFORM.
+  vec3 *positions;
+  quat *rotations;
+  vec3 *scales;
+  // Valid for clean nodes after transform_hierarchy_update.
+  mat4 *world_matrices;
+
+  // Structure, with MEMORY_TAG_ENTITIY_NODE. Indices only hold while the
+  // order is not dirty.
+  u32 *parents;
+  // Nodes in the subtree, including its root.
+  u32 *subtree_sizes;
+  transform_handle *handles;
+  // Per node: set when queued in dirty_handles, or destroyed.
+  u8 *flags;
+
+  // Node index of each handle. Free handles chain to the next free one.
+  u32 *indices;
+  u32 handle_count;
+  u32 free_handle;
+
+  // Nodes whose world matrix must be recomputed, each at most once.
+  transform_handle *dirty_handles;
+  u32 dirty_count;
+
+  // Set when nodes were added or moved out of depth-first order.
+  b8 is_order_dirty;
+
+  transform_attachment attachments[TRANSFORM_MAX_ATTACHMENTS];
+  u32 attachment_count;
+} transform_hierarchy;
+
+/**
+ * Creates an empty hierarchy. It grows as needed.
+ *
+ * @param capacity Nodes to make room for up front.
+ * @param out_hierarchy Receives the hierarchy.
+ */
+VAPI void transform_hierarchy_create(u32 capacity,
+                                     transform_hierarchy *out_hierarchy);
+
+VAPI void transform_hierarchy_destroy(transform_hierarchy *hierarchy);
+
+/**
+ * Attaches a per-node array, allocated cache-line aligned with the given tag
+ * and zeroed for each new node.
+ *
+ * @param stride Bytes per node.
+ * @return Index of the array in attachments, or TRANSFORM_ATTACHMENT_INVALID
+ * if TRANSFORM_MAX_ATTACHMENTS are attached already.
+ */
+VAPI u32 transform_hierarchy_attach(transform_hierarchy *hierarchy, u32 stride,
+                                    memory_tag tag);
+
+/**
+ * Restores the depth-first order if the structure changed, then recomputes
+ * the world matrices of all dirty nodes and their descendants.
+ *
+ * @return Number of world matrices recomputed.
+ */
+VAPI u32 transform_hierarchy_update(transform_hierarchy *hierarchy);
+
+/**
+ * Adds a node with the identity as its local transform.
+ *
+ * @param parent The parent, or TRANSFORM_HANDLE_INVALID for a root.
+ * @return The new node's handle.
+ */
+VAPI transform_handle transform_create(transform_hierarchy *hierarchy,
+                                       transform_handle parent);
+
+/**
+ * Removes a node together with all of its descendants. The node's handle is
+ * invalid right away; those of its descendants at the next update.
+ */
+VAPI void transform_destroy(transform_hierarchy *hierarchy,
+                            transform_handle handle);
+
+/**
+ * Moves a node, with its descendants, under a new parent. The local
+ * transform is kept, so the node moves in the world along with its new
+ * parent.
+ *
+ * @param parent The new parent, or TRANSFORM_HANDLE_INVALID to make the node
+ * a root.
+ * @return FALSE if parent is the node itself or one of its descendants.
+ */
+VAPI b8 transform_set_parent(transform_hierarchy *hierarchy,
+                             transform_handle handle, transform_handle parent);
+
+// TRUE if the handle refers to a node that was not destroyed.
+VAPI b8 transform_is_valid(const transform_hierarchy *hierarchy,
+                           transform_handle handle);
+
+VAPI void transform_set_position(transform_hierarchy *hierarchy,
+                                 transform_handle handle, vec3 position);
+VAPI void transform_set_rotation(transform_hierarchy *hierarchy,
+                                 transform_handle handle, quat rotation);
+VAPI void transform_set_scale(transform_hierarchy *hierarchy,
+                              transform_handle handle, vec3 scale);
+
+VAPI vec3 transform_get_position(const transform_hierarchy *hierarchy,
+                                 transform_handle handle);
+VAPI quat transform_get_rotation(const transform_hierarchy *hierarchy,
+                                 transform_handle handle);
+VAPI vec3 transform_get_scale(const transform_hierarchy *hierarchy,
+                              transform_handle handle);
+
+/**
+ * The node's local-to-world matrix as of the last update.
+ */
+VAPI const mat4 *transform_get_world(const transform_hierarchy *hierarchy,
+                                     transform_handle handle);
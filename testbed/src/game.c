@@ -1,14 +1,40 @@
 #include "game.h"
 
 #include <core/logger.h>
+#include <core/vmemory.h>
+
+b8 game_module_bind(game *game_instance, b8 is_reload) {
+  if (!is_reload) {
+    game_instance->app_config.name = "Vivid Engine Testbed";
+    game_instance->app_config.width = 1280;
+    game_instance->app_config.height = 720;
+    game_instance->app_config.start_pos_x = 100;
+    game_instance->app_config.start_pos_y = 100;
+    game_instance->app_config.target_frame_rate = 60;
+    game_instance->app_config.fixed_update_rate = 60;
+
+    // Create the game state.
+    game_instance->state_size = sizeof(game_state);
+    game_instance->state = vallocate(sizeof(game_state), MEMORY_TAG_GAME);
+  }
+
+  game_instance->initialize = game_init;
+  game_instance->update = game_update;
+  game_instance->render = game_render;
+  game_instance->on_resize = game_on_resize;
+
+  return TRUE;
+}
 
 b8 game_init(game *game_instance) {
-  VDEBUG("Game initialized");
+  VDEBUG_CAT(LOG_CATEGORY_GAME, "Game initialized");
   return TRUE;
 }
 
 b8 game_update(game *game_instance, f64 delta_time) { return TRUE; }
 
-b8 game_render(game *game_instance, f64 delta_time) { return TRUE; }
+b8 game_render(game *game_instance, f64 delta_time, f64 alpha) {
+  return TRUE;
+}
 
 b8 game_on_resize(game *game_instance, u32 width, u32 height) { return TRUE; }
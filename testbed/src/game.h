@@ -1,5 +1,6 @@
 #pragma once
 
+#include <core/game_module.h>
 #include <defines.h>
 #include <game_types.h>
 
@@ -7,10 +8,14 @@ typedef struct game_state {
   f64 delta_time;
 } game_state;
 
+// Sets the config and creates the state on the first bind, and points the
+// game at this module's functions on every bind.
+GAME_MODULE_EXPORT b8 game_module_bind(game *game_instance, b8 is_reload);
+
 b8 game_init(game *game_instance);
 
 b8 game_update(game *game_instance, f64 delta_time);
 
-b8 game_render(game *game_instance, f64 delta_time);
+b8 game_render(game *game_instance, f64 delta_time, f64 alpha);
 
 b8 game_on_resize(game *game_instance, u32 width, u32 height);
@@ -0,0 +1,242 @@
+/**
+ * Randomized test of the bounding volume hierarchy. Objects are inserted,
+ * removed and moved at random, and after every bvh_update the results of
+ * bvh_query_aabb, bvh_query_frustum and bvh_raycast are compared against a
+ * linear scan over all live objects.
+ *
+ * CMake builds this twice, with the SSE node tests and with VMATH_SCALAR,
+ * each with its own copy of bvh.c and vmath.c.
+ */
+
+#include <math/vmath.h>
+#include <scene/bvh.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MAX_OBJECTS (64 * 1024)
+#define ROUND_COUNT 300
+#define MAX_CHANGES_PER_ROUND 400
+#define AABB_QUERIES_PER_ROUND 20
+#define FRUSTUM_QUERIES_PER_ROUND 10
+#define RAYS_PER_ROUND 50
+
+// The test's own copy of every object, indexed by proxy.
+static aabb bounds[MAX_OBJECTS];
+static b8 is_alive[MAX_OBJECTS];
+static u32 proxy_limit = 0;
+static u32 alive_count = 0;
+
+static bvh_proxy found[MAX_OBJECTS];
+// Set for the objects the linear scan finds, cleared as the query finds them.
+static b8 is_expected[MAX_OBJECTS];
+
+static u32 random_state = 0x6A09E667u;
+
+// Uniform in [low, high]. Deterministic, so failures reproduce.
+static f32 random_range(f32 low, f32 high) {
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 17;
+  random_state ^= random_state << 5;
+  return low + (high - low) * (f32)((f64)random_state / 4294967295.0);
+}
+
+static u32 random_index(u32 count) {
+  return (u32)random_range(0.0f, (f32)count - 0.5f);
+}
+
+static vec3 random_position(f32 extent) {
+  return vec3_create(random_range(-extent, extent),
+                     random_range(-extent, extent),
+                     random_range(-extent, extent));
+}
+
+static aabb random_box(f32 extent, f32 max_half_size) {
+  vec3 center = random_position(extent);
+  vec3 half_size = vec3_create(random_range(0.1f, max_half_size),
+                               random_range(0.1f, max_half_size),
+                               random_range(0.1f, max_half_size));
+  return (aabb){vec3_sub(center, half_size), vec3_add(center, half_size)};
+}
+
+// Picks a live object at random, or returns BVH_PROXY_INVALID if none are.
+static bvh_proxy random_live_proxy() {
+  if (alive_count == 0) {
+    return BVH_PROXY_INVALID;
+  }
+  for (;;) {
+    bvh_proxy proxy = random_index(proxy_limit);
+    if (is_alive[proxy]) {
+      return proxy;
+    }
+  }
+}
+
+static void random_changes(bvh *b) {
+  u32 change_count = random_index(MAX_CHANGES_PER_ROUND);
+  for (u32 i = 0; i < change_count; ++i) {
+    f32 choice = random_range(0.0f, 1.0f);
+    bvh_proxy proxy = random_live_proxy();
+
+    if (choice < 0.4f || proxy == BVH_PROXY_INVALID) {
+      if (alive_count == MAX_OBJECTS) {
+        continue;
+      }
+      aabb box = random_box(100.0f, 3.0f);
+      proxy = bvh_insert(b, box, 0);
+      bounds[proxy] = box;
+      is_alive[proxy] = TRUE;
+      alive_count++;
+      if (proxy >= proxy_limit) {
+        proxy_limit = proxy + 1;
+      }
+    } else if (choice < 0.6f) {
+      bvh_remove(b, proxy);
+      is_alive[proxy] = FALSE;
+      alive_count--;
+    } else {
+      vec3 offset = random_position(3.0f);
+      aabb box = {vec3_add(bounds[proxy].min, offset),
+                  vec3_add(bounds[proxy].max, offset)};
+      bvh_move(b, proxy, box);
+      bounds[proxy] = box;
+    }
+  }
+}
+
+/**
+ * Checks a query's results against the objects marked in is_expected, and
+ * clears the marks.
+ */
+static b8 check_found(const char *query, u32 found_count,
+                      u32 expected_count) {
+  b8 passed = found_count == expected_count;
+  for (u32 i = 0; i < found_count && i < MAX_OBJECTS; ++i) {
+    passed = passed && is_expected[found[i]];
+    is_expected[found[i]] = FALSE;
+  }
+  for (u32 proxy = 0; proxy < proxy_limit; ++proxy) {
+    is_expected[proxy] = FALSE;
+  }
+
+  if (!passed) {
+    printf("%s found %u objects, the linear scan %u.\n", query, found_count,
+           expected_count);
+  }
+  return passed;
+}
+
+static b8 check_aabb_queries(const bvh *b) {
+  for (u32 i = 0; i < AABB_QUERIES_PER_ROUND; ++i) {
+    aabb box = random_box(100.0f, 10.0f);
+    u32 expected_count = 0;
+    for (u32 proxy = 0; proxy < proxy_limit; ++proxy) {
+      if (is_alive[proxy] && aabb_overlaps(bounds[proxy], box)) {
+        is_expected[proxy] = TRUE;
+        expected_count++;
+      }
+    }
+
+    u32 found_count = bvh_query_aabb(b, box, found, MAX_OBJECTS);
+    if (!check_found("bvh_query_aabb", found_count, expected_count)) {
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+static b8 check_frustum_queries(const bvh *b) {
+  for (u32 i = 0; i < FRUSTUM_QUERIES_PER_ROUND; ++i) {
+    mat4 view = mat4_look_at(random_position(100.0f),
+                             random_position(100.0f), vec3_up());
+    mat4 projection = mat4_perspective(deg_to_rad(60.0f), 1.6f, 0.1f,
+                                       random_range(50.0f, 300.0f));
+    mat4 view_projection = mat4_mul(projection, view);
+    frustum f = frustum_from_matrix(&view_projection);
+
+    u32 expected_count = 0;
+    for (u32 proxy = 0; proxy < proxy_limit; ++proxy) {
+      if (is_alive[proxy] && frustum_intersects_aabb(&f, bounds[proxy])) {
+        is_expected[proxy] = TRUE;
+        expected_count++;
+      }
+    }
+
+    u32 found_count = bvh_query_frustum(b, &f, found, MAX_OBJECTS);
+    if (!check_found("bvh_query_frustum", found_count, expected_count)) {
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+static b8 check_raycasts(const bvh *b) {
+  for (u32 i = 0; i < RAYS_PER_ROUND; ++i) {
+    ray r = {random_position(120.0f), random_position(1.0f)};
+    // Directions with a zero component take the slab tests' special case.
+    if (i % 5 == 0) {
+      r.direction.y = 0.0f;
+    }
+    r.direction = vec3_normalized(r.direction);
+    f32 max_distance = random_range(10.0f, 400.0f);
+
+    f32 nearest = max_distance;
+    b8 expect_hit = FALSE;
+    for (u32 proxy = 0; proxy < proxy_limit; ++proxy) {
+      if (!is_alive[proxy]) {
+        continue;
+      }
+      f32 distance = aabb_ray_distance(bounds[proxy], r, nearest);
+      if (distance >= 0.0f) {
+        nearest = distance;
+        expect_hit = TRUE;
+      }
+    }
+
+    // Objects at the same distance may be reported in either order, so only
+    // the distance is compared.
+    bvh_ray_hit hit;
+    b8 is_hit = bvh_raycast(b, r, max_distance, &hit);
+    if (is_hit != expect_hit ||
+        (is_hit && vabs(hit.distance - nearest) > 1e-3f * (1.0f + nearest))) {
+      printf("bvh_raycast %s at %f, the linear scan %s at %f.\n",
+             is_hit ? "hit" : "missed", is_hit ? hit.distance : 0.0f,
+             expect_hit ? "hit" : "missed", nearest);
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+int main() {
+#ifdef VSIMD_SSE
+  printf("BVH test, SSE node tests:\n");
+#else
+  printf("BVH test, scalar node tests:\n");
+#endif
+
+  bvh b;
+  bvh_create(0, &b);
+
+  u32 rebuild_count = 0;
+  b8 passed = TRUE;
+  for (u32 round = 0; passed && round < ROUND_COUNT; ++round) {
+    random_changes(&b);
+    rebuild_count += bvh_update(&b);
+
+    passed = check_aabb_queries(&b) && check_frustum_queries(&b) &&
+             check_raycasts(&b);
+    if (!passed) {
+      printf("FAILED in round %u with %u objects.\n", round, alive_count);
+    }
+  }
+
+  if (passed) {
+    printf("  %u rounds passed, %u objects at the end, %u rebuilds, tree "
+           "cost %.2f (%.2f when built).\n",
+           ROUND_COUNT, alive_count, rebuild_count, b.cost, b.build_cost);
+  }
+
+  bvh_destroy(&b);
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,202 @@
+/**
+ * Frustum culling benchmark. Times frustum_cull, frustum_cull_parallel and
+ * frustum_cull_reference over N boxes scattered around a camera (the first
+ * argument, 1M by default) and prints boxes per second for each.
+ *
+ * Fails if the batched or parallel cull ever returns a different index list
+ * than the reference, checked first over many random frusta and box counts
+ * and then on every timed run.
+ */
+
+#include <core/job.h>
+#include <core/vmemory.h>
+#include <math/vmath.h>
+#include <scene/culling.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_BOX_COUNT (1024 * 1024)
+#define RANDOM_FRUSTUM_COUNT 200
+#define TIMED_RUNS 20
+#define PARALLEL_MIN_BATCH 4096
+
+static u32 random_state = 0x2545F491u;
+
+static f64 seconds() {
+  struct timespec now;
+  timespec_get(&now, TIME_UTC);
+  return (f64)now.tv_sec + (f64)now.tv_nsec * 1e-9;
+}
+
+// Uniform in [low, high]. Deterministic, so failures reproduce.
+static f32 random_range(f32 low, f32 high) {
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 17;
+  random_state ^= random_state << 5;
+  return low + (high - low) * (f32)((f64)random_state / 4294967295.0);
+}
+
+static vec3 random_position(f32 extent) {
+  return vec3_create(random_range(-extent, extent),
+                     random_range(-extent, extent),
+                     random_range(-extent, extent));
+}
+
+// Cubes of half size 0.5 to 4 within 1000 units of the origin.
+static void fill_boxes(aabb_soa boxes, u32 count) {
+  for (u32 i = 0; i < count; ++i) {
+    vec3 center = random_position(1000.0f);
+    f32 half_size = random_range(0.5f, 4.0f);
+    boxes.min_x[i] = center.x - half_size;
+    boxes.min_y[i] = center.y - half_size;
+    boxes.min_z[i] = center.z - half_size;
+    boxes.max_x[i] = center.x + half_size;
+    boxes.max_y[i] = center.y + half_size;
+    boxes.max_z[i] = center.z + half_size;
+  }
+}
+
+static frustum random_frustum() {
+  vec3 eye = random_position(500.0f);
+  vec3 target = random_position(500.0f);
+  mat4 view = mat4_look_at(eye, target, vec3_up());
+  mat4 projection = mat4_perspective(deg_to_rad(random_range(30.0f, 100.0f)),
+                                     random_range(1.0f, 2.0f), 0.1f,
+                                     random_range(100.0f, 1500.0f));
+  mat4 view_projection = mat4_mul(projection, view);
+  return frustum_from_matrix(&view_projection);
+}
+
+static b8 lists_match(const u32 *list, u32 count, const u32 *reference,
+                      u32 reference_count) {
+  return count == reference_count &&
+         memcmp(list, reference, sizeof(u32) * count) == 0;
+}
+
+/**
+ * Compares all three culls over random frusta, with box counts that leave
+ * every possible remainder after the SIMD iterations.
+ */
+static b8 check_random_frusta(aabb_soa boxes, u32 box_count, u32 *batched,
+                              u32 *parallel, u32 *reference) {
+  for (u32 i = 0; i < RANDOM_FRUSTUM_COUNT; ++i) {
+    frustum f = random_frustum();
+    u32 count = i < RANDOM_FRUSTUM_COUNT / 2
+                    ? i * 37 % (box_count < 5000 ? box_count : 5000)
+                    : box_count - i % 17 % (box_count + 1);
+    u32 min_batch = 1 + i * 97 % 3000;
+
+    u32 reference_count = frustum_cull_reference(&f, boxes, count, reference);
+    u32 batched_count = frustum_cull(&f, boxes, count, batched);
+    u32 parallel_count =
+        frustum_cull_parallel(&f, boxes, count, parallel, min_batch);
+    if (!lists_match(batched, batched_count, reference, reference_count) ||
+        !lists_match(parallel, parallel_count, reference, reference_count)) {
+      printf("Mismatch on frustum %u over %u boxes: reference %u, batched "
+             "%u, parallel %u visible.\n",
+             i, count, reference_count, batched_count, parallel_count);
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+static void print_rate(const char *name, f64 best, u32 box_count) {
+  printf("  %-24s %9.3f ms %10.1f M boxes/s\n", name, best * 1e3,
+         box_count / best * 1e-6);
+}
+
+int main(int argc, char **argv) {
+  u32 box_count = argc > 1 ? (u32)atoi(argv[1]) : DEFAULT_BOX_COUNT;
+  if (box_count == 0) {
+    box_count = DEFAULT_BOX_COUNT;
+  }
+
+  u64 job_memory_size;
+  job_system_init(&job_memory_size, NULL, 0);
+  void *job_memory = vallocate_aligned(job_memory_size, MEMORY_TAG_JOB);
+  if (!job_system_init(&job_memory_size, job_memory, 0)) {
+    printf("Failed to start the job system.\n");
+    return 1;
+  }
+
+  f32 *box_memory =
+      vallocate_aligned(sizeof(f32) * 6 * (u64)box_count, MEMORY_TAG_SCENE);
+  aabb_soa boxes = {box_memory,
+                    box_memory + box_count,
+                    box_memory + 2 * (u64)box_count,
+                    box_memory + 3 * (u64)box_count,
+                    box_memory + 4 * (u64)box_count,
+                    box_memory + 5 * (u64)box_count};
+  fill_boxes(boxes, box_count);
+
+  u64 list_size = sizeof(u32) * (u64)box_count;
+  u32 *batched = vallocate_aligned(list_size, MEMORY_TAG_SCENE);
+  u32 *parallel = vallocate_aligned(list_size, MEMORY_TAG_SCENE);
+  u32 *reference = vallocate_aligned(list_size, MEMORY_TAG_SCENE);
+
+  b8 passed = check_random_frusta(boxes, box_count, batched, parallel,
+                                  reference);
+
+  // A camera at the origin looking down -z sees about a tenth of the boxes.
+  mat4 view_projection =
+      mat4_mul(mat4_perspective(deg_to_rad(70.0f), 16.0f / 9.0f, 0.1f,
+                                1000.0f),
+               mat4_look_at(vec3_zero(), vec3_forward(), vec3_up()));
+  frustum f = frustum_from_matrix(&view_projection);
+
+  f64 best_reference = 0.0, best_batched = 0.0, best_parallel = 0.0;
+  u32 visible = 0;
+  for (u32 run = 0; passed && run < TIMED_RUNS; ++run) {
+    f64 start = seconds();
+    visible = frustum_cull_reference(&f, boxes, box_count, reference);
+    f64 reference_time = seconds() - start;
+
+    start = seconds();
+    u32 batched_count = frustum_cull(&f, boxes, box_count, batched);
+    f64 batched_time = seconds() - start;
+
+    start = seconds();
+    u32 parallel_count = frustum_cull_parallel(&f, boxes, box_count, parallel,
+                                               PARALLEL_MIN_BATCH);
+    f64 parallel_time = seconds() - start;
+
+    if (!lists_match(batched, batched_count, reference, visible) ||
+        !lists_match(parallel, parallel_count, reference, visible)) {
+      printf("Mismatch on timed run %u.\n", run);
+      passed = FALSE;
+      break;
+    }
+
+    if (run == 0 || reference_time < best_reference) {
+      best_reference = reference_time;
+    }
+    if (run == 0 || batched_time < best_batched) {
+      best_batched = batched_time;
+    }
+    if (run == 0 || parallel_time < best_parallel) {
+      best_parallel = parallel_time;
+    }
+  }
+
+  if (passed) {
+    printf("%u boxes, %u visible, %u workers, best of %u runs:\n", box_count,
+           visible, job_worker_count(), TIMED_RUNS);
+    print_rate("frustum_cull_reference", best_reference, box_count);
+    print_rate("frustum_cull", best_batched, box_count);
+    print_rate("frustum_cull_parallel", best_parallel, box_count);
+  }
+
+  vfree_aligned(reference, list_size, MEMORY_TAG_SCENE);
+  vfree_aligned(parallel, list_size, MEMORY_TAG_SCENE);
+  vfree_aligned(batched, list_size, MEMORY_TAG_SCENE);
+  vfree_aligned(box_memory, sizeof(f32) * 6 * (u64)box_count,
+                MEMORY_TAG_SCENE);
+  job_system_shutdown();
+  vfree_aligned(job_memory, job_memory_size, MEMORY_TAG_JOB);
+
+  return passed ? 0 : 1;
+}
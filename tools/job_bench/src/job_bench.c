@@ -0,0 +1,130 @@
+/**
+ * Job system benchmark. For every worker count from 1 up to one per physical
+ * core (or the count given as the first argument), reports:
+ * - the overhead per job, from submitting and waiting on batches of empty
+ *   jobs;
+ * - the time and speedup over one worker of a job_parallel_for over a
+ *   compute bound loop.
+ */
+
+#include <core/job.h>
+#include <core/vmemory.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define EMPTY_JOB_COUNT (256 * 1024)
+// Jobs submitted before each wait. Stays below the deque capacity.
+#define EMPTY_JOB_BATCH 1024
+
+#define PARALLEL_ITEM_COUNT (1024 * 1024)
+#define PARALLEL_MIN_BATCH 1024
+#define PARALLEL_REPEATS 5
+
+static f64 values[PARALLEL_ITEM_COUNT];
+
+static f64 seconds() {
+  struct timespec now;
+  timespec_get(&now, TIME_UTC);
+  return (f64)now.tv_sec + (f64)now.tv_nsec * 1e-9;
+}
+
+static void empty_job(void *params) {}
+
+// About 200 dependent multiply-adds per item.
+static void compute_range(void *params, u32 start, u32 end) {
+  for (u32 i = start; i < end; ++i) {
+    f64 x = values[i];
+    for (u32 k = 0; k < 200; ++k) {
+      x = x * 0.999 + 1.0;
+    }
+    values[i] = x;
+  }
+}
+
+static b8 start_workers(u32 worker_count, void **out_memory,
+                        u64 *out_size) {
+  if (!job_system_init(out_size, NULL, worker_count)) {
+    return FALSE;
+  }
+  *out_memory = vallocate_aligned(*out_size, MEMORY_TAG_JOB);
+  return job_system_init(out_size, *out_memory, worker_count);
+}
+
+static void stop_workers(void *memory, u64 size) {
+  job_system_shutdown();
+  vfree_aligned(memory, size, MEMORY_TAG_JOB);
+}
+
+// Seconds per job, from submitting, running and waiting on empty jobs.
+static f64 measure_job_overhead() {
+  job_desc job = {empty_job, NULL, JOB_PRIORITY_NORMAL};
+  job_desc batch[EMPTY_JOB_BATCH];
+  for (u32 i = 0; i < EMPTY_JOB_BATCH; ++i) {
+    batch[i] = job;
+  }
+
+  f64 start = seconds();
+  for (u32 i = 0; i < EMPTY_JOB_COUNT; i += EMPTY_JOB_BATCH) {
+    job_counter counter = {0};
+    job_submit_batch(batch, EMPTY_JOB_BATCH, &counter);
+    job_wait(&counter);
+  }
+  return (seconds() - start) / EMPTY_JOB_COUNT;
+}
+
+// Fastest of a few runs of the parallel loop, in seconds.
+static f64 measure_parallel_for() {
+  f64 best = 0.0;
+  for (u32 r = 0; r < PARALLEL_REPEATS; ++r) {
+    f64 start = seconds();
+    job_parallel_for(PARALLEL_ITEM_COUNT, PARALLEL_MIN_BATCH, compute_range,
+                     NULL);
+    f64 elapsed = seconds() - start;
+    if (r == 0 || elapsed < best) {
+      best = elapsed;
+    }
+  }
+  return best;
+}
+
+int main(int argc, char **argv) {
+  u32 max_workers = argc > 1 ? (u32)atoi(argv[1]) : 0;
+  if (max_workers == 0) {
+    // One worker per physical core, as the engine starts by default.
+    void *memory;
+    u64 size;
+    if (!start_workers(0, &memory, &size)) {
+      printf("Failed to start the job system.\n");
+      return 1;
+    }
+    max_workers = job_worker_count();
+    stop_workers(memory, size);
+  }
+
+  printf("%-8s %14s %16s %10s\n", "workers", "us per job", "parallel_for ms",
+         "speedup");
+
+  f64 single_worker_time = 0.0;
+  for (u32 workers = 1; workers <= max_workers; ++workers) {
+    void *memory;
+    u64 size;
+    if (!start_workers(workers, &memory, &size)) {
+      printf("Failed to start the job system with %u workers.\n", workers);
+      return 1;
+    }
+
+    f64 overhead = measure_job_overhead();
+    f64 parallel_time = measure_parallel_for();
+    if (workers == 1) {
+      single_worker_time = parallel_time;
+    }
+    printf("%-8u %14.3f %16.3f %9.2fx\n", workers, overhead * 1e6,
+           parallel_time * 1e3, single_worker_time / parallel_time);
+
+    stop_workers(memory, size);
+  }
+
+  return 0;
+}
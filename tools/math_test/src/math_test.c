@@ -0,0 +1,399 @@
+/**
+ * Accuracy and throughput tests for the math library. Every kernel is
+ * compared against the same computation in double precision, and the run
+ * fails if any kernel's largest error exceeds its tolerance.
+ *
+ * CMake builds this twice, once with the SIMD paths the compiler targets and
+ * once with VMATH_SCALAR, each with its own copy of vmath.c, so both
+ * implementations are held to the same references. Comparing the two runs'
+ * throughput shows what the SIMD paths gain.
+ */
+
+#include <math/vmath.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+
+#define MATRIX_COUNT 4096
+#define POINT_COUNT (64 * 1024)
+
+// Largest absolute error allowed, for inputs in [-1, 1] unless noted.
+#define TOLERANCE_VECTOR 1e-6
+#define TOLERANCE_MATRIX 1e-5
+#define TOLERANCE_INVERSE 1e-4
+#define TOLERANCE_ROTATION 1e-5
+// quat_slerp falls back to a normalized lerp for nearly parallel rotations,
+// which is off by up to about 1.5e-5.
+#define TOLERANCE_SLERP 5e-5
+
+static mat4 matrices_a[MATRIX_COUNT];
+static mat4 matrices_b[MATRIX_COUNT];
+static mat4 matrices_out[MATRIX_COUNT];
+
+static _Alignas(32) f32 points_x[POINT_COUNT];
+static _Alignas(32) f32 points_y[POINT_COUNT];
+static _Alignas(32) f32 points_z[POINT_COUNT];
+static _Alignas(32) f32 out_x[POINT_COUNT];
+static _Alignas(32) f32 out_y[POINT_COUNT];
+static _Alignas(32) f32 out_z[POINT_COUNT];
+
+static u32 random_state = 0x9E3779B9u;
+static u32 failure_count = 0;
+
+// Keeps the benchmark loops from being optimized away.
+static volatile f32 sink;
+
+// Uniform in [-1, 1]. Deterministic, so failures reproduce.
+static f32 random_f32() {
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 17;
+  random_state ^= random_state << 5;
+  return (f32)((f64)random_state / 4294967295.0 * 2.0 - 1.0);
+}
+
+static vec3 random_vec3() {
+  return vec3_create(random_f32(), random_f32(), random_f32());
+}
+
+static quat random_quat() {
+  return quat_normalized(
+      vec4_create(random_f32(), random_f32(), random_f32(), random_f32()));
+}
+
+// A transform with scales in [0.5, 1.5], so it is well conditioned.
+static mat4 random_trs() {
+  vec3 scale = vec3_create(1.0f + 0.5f * random_f32(),
+                           1.0f + 0.5f * random_f32(),
+                           1.0f + 0.5f * random_f32());
+  return mat4_from_trs(random_vec3(), random_quat(), scale);
+}
+
+static f64 seconds() {
+  struct timespec now;
+  timespec_get(&now, TIME_UTC);
+  return (f64)now.tv_sec + (f64)now.tv_nsec * 1e-9;
+}
+
+static void check(const char *name, f64 max_error, f64 tolerance) {
+  b8 passed = max_error <= tolerance;
+  printf("  %-28s max error %.3e (tolerance %.0e) %s\n", name, max_error,
+         tolerance, passed ? "ok" : "FAILED");
+  if (!passed) {
+    failure_count++;
+  }
+}
+
+static f64 max_f64(f64 a, f64 b) { return a > b ? a : b; }
+
+static void reference_mat4_mul(const mat4 *a, const mat4 *b, f64 out[16]) {
+  for (u32 column = 0; column < 4; ++column) {
+    for (u32 row = 0; row < 4; ++row) {
+      f64 sum = 0.0;
+      for (u32 k = 0; k < 4; ++k) {
+        sum += (f64)a->data[k * 4 + row] * (f64)b->data[column * 4 + k];
+      }
+      out[column * 4 + row] = sum;
+    }
+  }
+}
+
+static f64 mat4_error(const mat4 *m, const f64 reference[16]) {
+  f64 error = 0.0;
+  for (u32 i = 0; i < 16; ++i) {
+    error = max_f64(error, fabs((f64)m->data[i] - reference[i]));
+  }
+  return error;
+}
+
+// Rotates v by the unit quaternion q: v + 2w(u x v) + 2u x (u x v).
+static void reference_quat_rotate(quat q, vec3 v, f64 out[3]) {
+  f64 u[3] = {q.x, q.y, q.z};
+  f64 p[3] = {v.x, v.y, v.z};
+  f64 t[3] = {2.0 * (u[1] * p[2] - u[2] * p[1]),
+              2.0 * (u[2] * p[0] - u[0] * p[2]),
+              2.0 * (u[0] * p[1] - u[1] * p[0])};
+  out[0] = p[0] + q.w * t[0] + (u[1] * t[2] - u[2] * t[1]);
+  out[1] = p[1] + q.w * t[1] + (u[2] * t[0] - u[0] * t[2]);
+  out[2] = p[2] + q.w * t[2] + (u[0] * t[1] - u[1] * t[0]);
+}
+
+static void test_vectors() {
+  f64 dot_error = 0.0, cross_error = 0.0, normalize_error = 0.0;
+  for (u32 i = 0; i < 100000; ++i) {
+    vec4 a = vec4_create(random_f32(), random_f32(), random_f32(),
+                         random_f32());
+    vec4 b = vec4_create(random_f32(), random_f32(), random_f32(),
+                         random_f32());
+    f64 dot = (f64)a.x * b.x + (f64)a.y * b.y + (f64)a.z * b.z +
+              (f64)a.w * b.w;
+    dot_error = max_f64(dot_error, fabs(vec4_dot(a, b) - dot));
+
+    vec3 c = vec3_cross(vec4_to_vec3(a), vec4_to_vec3(b));
+    f64 cross[3] = {(f64)a.y * b.z - (f64)a.z * b.y,
+                    (f64)a.z * b.x - (f64)a.x * b.z,
+                    (f64)a.x * b.y - (f64)a.y * b.x};
+    for (u32 k = 0; k < 3; ++k) {
+      cross_error = max_f64(cross_error, fabs(c.elements[k] - cross[k]));
+    }
+
+    f64 length = sqrt((f64)a.x * a.x + (f64)a.y * a.y + (f64)a.z * a.z +
+                      (f64)a.w * a.w);
+    if (length > 1e-3) {
+      vec4 n = vec4_normalized(a);
+      for (u32 k = 0; k < 4; ++k) {
+        normalize_error = max_f64(normalize_error,
+                                  fabs(n.elements[k] - a.elements[k] / length));
+      }
+    }
+  }
+
+  check("vec4_dot", dot_error, TOLERANCE_VECTOR);
+  check("vec3_cross", cross_error, TOLERANCE_VECTOR);
+  check("vec4_normalized", normalize_error, TOLERANCE_VECTOR);
+}
+
+static void test_matrices() {
+  f64 mul_error = 0.0, batch_error = 0.0, vec4_error = 0.0;
+  for (u32 i = 0; i < MATRIX_COUNT; ++i) {
+    for (u32 k = 0; k < 16; ++k) {
+      matrices_a[i].data[k] = random_f32();
+      matrices_b[i].data[k] = random_f32();
+    }
+  }
+
+  mat4_mul_batch(matrices_a, matrices_b, matrices_out, MATRIX_COUNT);
+  for (u32 i = 0; i < MATRIX_COUNT; ++i) {
+    f64 reference[16];
+    reference_mat4_mul(&matrices_a[i], &matrices_b[i], reference);
+
+    mat4 product = mat4_mul(matrices_a[i], matrices_b[i]);
+    mul_error = max_f64(mul_error, mat4_error(&product, reference));
+    batch_error =
+        max_f64(batch_error, mat4_error(&matrices_out[i], reference));
+
+    vec4 v = matrices_b[i].columns[0];
+    vec4 r = mat4_mul_vec4(matrices_a[i], v);
+    for (u32 k = 0; k < 4; ++k) {
+      vec4_error = max_f64(vec4_error, fabs(r.elements[k] - reference[k]));
+    }
+  }
+
+  // out may alias b.
+  mat4_mul_batch(matrices_a, matrices_b, matrices_b, MATRIX_COUNT);
+  f64 alias_error = 0.0;
+  for (u32 i = 0; i < MATRIX_COUNT; ++i) {
+    for (u32 k = 0; k < 16; ++k) {
+      alias_error = max_f64(alias_error, fabs(matrices_b[i].data[k] -
+                                              matrices_out[i].data[k]));
+    }
+  }
+
+  check("mat4_mul", mul_error, TOLERANCE_MATRIX);
+  check("mat4_mul_batch", batch_error, TOLERANCE_MATRIX);
+  check("mat4_mul_batch in place", alias_error, 0.0);
+  check("mat4_mul_vec4", vec4_error, TOLERANCE_MATRIX);
+}
+
+static void test_transforms() {
+  f64 inverse_error = 0.0, trs_error = 0.0, rotate_error = 0.0;
+  f64 slerp_error = 0.0;
+  for (u32 i = 0; i < 10000; ++i) {
+    mat4 m = random_trs();
+    mat4 inverse = mat4_inverse(m);
+    f64 product[16];
+    reference_mat4_mul(&m, &inverse, product);
+    for (u32 k = 0; k < 16; ++k) {
+      f64 identity = k % 5 == 0 ? 1.0 : 0.0;
+      inverse_error = max_f64(inverse_error, fabs(product[k] - identity));
+    }
+
+    vec3 translation = random_vec3();
+    quat rotation = random_quat();
+    vec3 scale = random_vec3();
+    mat4 trs = mat4_from_trs(translation, rotation, scale);
+    mat4 rotation_matrix = quat_to_mat4(rotation);
+    mat4 scale_matrix = mat4_scale(scale);
+    mat4 translation_matrix = mat4_translation(translation);
+    f64 rs[16], expected[16];
+    reference_mat4_mul(&rotation_matrix, &scale_matrix, rs);
+    mat4 rs_f32;
+    for (u32 k = 0; k < 16; ++k) {
+      rs_f32.data[k] = (f32)rs[k];
+    }
+    reference_mat4_mul(&translation_matrix, &rs_f32, expected);
+    trs_error = max_f64(trs_error, mat4_error(&trs, expected));
+
+    vec3 v = random_vec3();
+    f64 rotated[3];
+    reference_quat_rotate(rotation, v, rotated);
+    vec3 by_quat = quat_rotate(rotation, v);
+    vec3 by_matrix = mat4_transform_direction(rotation_matrix, v);
+    for (u32 k = 0; k < 3; ++k) {
+      rotate_error =
+          max_f64(rotate_error, fabs(by_quat.elements[k] - rotated[k]));
+      rotate_error =
+          max_f64(rotate_error, fabs(by_matrix.elements[k] - rotated[k]));
+    }
+
+    // Slerp between rotations about one axis is the rotation by the
+    // interpolated angle, as long as that is the shorter arc.
+    vec3 axis = vec3_normalized(random_vec3());
+    f32 angle_a = random_f32() * 1.5f, angle_b = random_f32() * 1.5f;
+    f32 t = 0.5f + 0.5f * random_f32();
+    quat slerped = quat_slerp(quat_from_axis_angle(axis, angle_a),
+                              quat_from_axis_angle(axis, angle_b), t);
+    f64 angle = (f64)angle_a + ((f64)angle_b - angle_a) * t;
+    f64 half_sin = sin(angle * 0.5), half_cos = cos(angle * 0.5);
+    f64 expected_quat[4] = {axis.x * half_sin, axis.y * half_sin,
+                            axis.z * half_sin, half_cos};
+    for (u32 k = 0; k < 4; ++k) {
+      slerp_error = max_f64(slerp_error,
+                            fabs(slerped.elements[k] - expected_quat[k]));
+    }
+  }
+
+  check("mat4_inverse", inverse_error, TOLERANCE_INVERSE);
+  check("mat4_from_trs", trs_error, TOLERANCE_MATRIX);
+  check("quat_rotate, quat_to_mat4", rotate_error, TOLERANCE_ROTATION);
+  check("quat_slerp", slerp_error, TOLERANCE_SLERP);
+}
+
+static void test_points() {
+  for (u32 i = 0; i < POINT_COUNT; ++i) {
+    points_x[i] = random_f32();
+    points_y[i] = random_f32();
+    points_z[i] = random_f32();
+  }
+
+  mat4 m = random_trs();
+  vec3_soa points = {points_x, points_y, points_z};
+  vec3_soa out_points = {out_x, out_y, out_z};
+
+  // An odd count exercises the remainder after the SIMD iterations.
+  u32 count = POINT_COUNT - 3;
+  mat4_transform_points(&m, points, out_points, count);
+
+  f64 error = 0.0;
+  for (u32 i = 0; i < count; ++i) {
+    f64 p[3] = {points_x[i], points_y[i], points_z[i]};
+    f64 result[3] = {out_x[i], out_y[i], out_z[i]};
+    for (u32 row = 0; row < 3; ++row) {
+      f64 expected = m.data[row] * p[0] + m.data[4 + row] * p[1] +
+                     m.data[8 + row] * p[2] + m.data[12 + row];
+      error = max_f64(error, fabs(result[row] - expected));
+    }
+  }
+  check("mat4_transform_points", error, TOLERANCE_MATRIX);
+}
+
+static void test_frustum() {
+  mat4 view = mat4_look_at(vec3_create(1.0f, 2.0f, 3.0f), vec3_zero(),
+                           vec3_up());
+  mat4 projection = mat4_perspective(1.0f, 1.5f, 0.1f, 100.0f);
+  mat4 view_projection = mat4_mul(projection, view);
+  frustum f = frustum_from_matrix(&view_projection);
+
+  // A point is inside exactly when it is in front of all six planes, which
+  // for points clearly inside or outside must agree with clip space.
+  u32 mismatches = 0;
+  for (u32 i = 0; i < 100000; ++i) {
+    vec3 p = vec3_scale(random_vec3(), 20.0f);
+    vec4 clip = mat4_mul_vec4(view_projection, vec4_from_vec3(p, 1.0f));
+    f32 margin = 1e-3f * vabs(clip.w);
+    b8 clearly_inside = clip.w > 0.0f && vabs(clip.x) < clip.w - margin &&
+                        vabs(clip.y) < clip.w - margin &&
+                        clip.z > margin && clip.z < clip.w - margin;
+    b8 clearly_outside = clip.w > 0.0f &&
+                         (vabs(clip.x) > clip.w + margin ||
+                          vabs(clip.y) > clip.w + margin ||
+                          clip.z < -margin || clip.z > clip.w + margin);
+
+    b8 inside = TRUE;
+    for (u32 k = 0; k < 6; ++k) {
+      inside = inside && plane_distance(f.planes[k], p) >= 0.0f;
+    }
+    if ((clearly_inside && !inside) || (clearly_outside && inside)) {
+      mismatches++;
+    }
+  }
+  check("frustum_from_matrix", (f64)mismatches, 0.0);
+}
+
+static void benchmark() {
+  const u32 repeats = 200;
+  f64 start = seconds();
+  for (u32 r = 0; r < repeats; ++r) {
+    mat4_mul_batch(matrices_a, matrices_out, matrices_b, MATRIX_COUNT);
+    sink = matrices_b[r % MATRIX_COUNT].data[0];
+  }
+  f64 elapsed = seconds() - start;
+  printf("  %-28s %8.1f M matrices/s\n", "mat4_mul_batch",
+         repeats * (f64)MATRIX_COUNT / elapsed * 1e-6);
+
+  start = seconds();
+  for (u32 r = 0; r < repeats; ++r) {
+    for (u32 i = 0; i < MATRIX_COUNT; ++i) {
+      matrices_b[i] = mat4_mul(matrices_a[i], matrices_out[i]);
+    }
+    sink = matrices_b[r % MATRIX_COUNT].data[0];
+  }
+  elapsed = seconds() - start;
+  printf("  %-28s %8.1f M matrices/s\n", "mat4_mul",
+         repeats * (f64)MATRIX_COUNT / elapsed * 1e-6);
+
+  mat4 m = random_trs();
+  vec3_soa points = {points_x, points_y, points_z};
+  vec3_soa out_points = {out_x, out_y, out_z};
+  start = seconds();
+  for (u32 r = 0; r < repeats; ++r) {
+    mat4_transform_points(&m, points, out_points, POINT_COUNT);
+    sink = out_x[r % POINT_COUNT];
+  }
+  elapsed = seconds() - start;
+  printf("  %-28s %8.1f M points/s\n", "mat4_transform_points",
+         repeats * (f64)POINT_COUNT / elapsed * 1e-6);
+
+  start = seconds();
+  for (u32 r = 0; r < repeats; ++r) {
+    for (u32 i = 0; i < POINT_COUNT; ++i) {
+      vec3 p = mat4_transform_point(
+          m, vec3_create(points_x[i], points_y[i], points_z[i]));
+      out_x[i] = p.x;
+      out_y[i] = p.y;
+      out_z[i] = p.z;
+    }
+    sink = out_x[r % POINT_COUNT];
+  }
+  elapsed = seconds() - start;
+  printf("  %-28s %8.1f M points/s\n", "mat4_transform_point",
+         repeats * (f64)POINT_COUNT / elapsed * 1e-6);
+}
+
+int main() {
+#if defined(VSIMD_AVX2) && defined(VSIMD_FMA)
+  printf("Math library test, AVX2 and FMA:\n");
+#elif defined(VSIMD_AVX)
+  printf("Math library test, AVX:\n");
+#elif defined(VSIMD_SSE)
+  printf("Math library test, SSE:\n");
+#else
+  printf("Math library test, scalar:\n");
+#endif
+
+  test_vectors();
+  test_matrices();
+  test_transforms();
+  test_points();
+  test_frustum();
+
+  printf("Throughput:\n");
+  benchmark();
+
+  if (failure_count) {
+    printf("%u checks FAILED.\n", failure_count);
+    return 1;
+  }
+  printf("All checks passed.\n");
+  return 0;
+}
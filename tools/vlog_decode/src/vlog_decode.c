@@ -0,0 +1,468 @@
+/**
+ * vlog_decode: turns a binary log written with LOG_BINARY_ENABLED back into
+ * text.
+ *
+ * Usage: vlog_decode <input.vlog> [output.txt]
+ *
+ * Records from all threads are merged and printed in timestamp order.
+ */
+#include <core/log_binary_format.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct decoded_site {
+  b8 is_defined;
+  u8 level;
+  u8 arg_count;
+  u8 arg_types[LOG_BINARY_MAX_ARGS];
+  u32 line;
+  char *format;
+  char *file;
+} decoded_site;
+
+typedef struct decoded_record {
+  f64 timestamp;
+  // Position in the file, used to keep the order stable for equal times.
+  u64 sequence;
+  u32 thread_index;
+  u32 site_id;
+  // Points at the record's arguments within the file contents.
+  const u8 *args;
+} decoded_record;
+
+typedef struct decoder {
+  const u8 *data;
+  u64 size;
+  decoded_site *sites;
+  u32 site_capacity;
+  decoded_record *records;
+  u64 record_count;
+  u64 record_capacity;
+} decoder;
+
+static const char *level_strings[6] = {"[FATAL]: ", "[ERROR]: ", "[WARN]: ",
+                                       "[INFO]: ",  "[DEBUG]: ", "[TRACE]: "};
+
+static u64 read_u64(const u8 *p) {
+  u64 value;
+  memcpy(&value, p, sizeof(u64));
+  return value;
+}
+
+static u32 read_u32(const u8 *p) {
+  u32 value;
+  memcpy(&value, p, sizeof(u32));
+  return value;
+}
+
+static u16 read_u16(const u8 *p) {
+  u16 value;
+  memcpy(&value, p, sizeof(u16));
+  return value;
+}
+
+static char *copy_string(const u8 *p, u16 length) {
+  char *str = malloc(length + 1);
+  memcpy(str, p, length);
+  str[length] = '\0';
+  return str;
+}
+
+// Returns the encoded size of a record's arguments, or 0 if it overruns end.
+static u64 args_size(const decoded_site *site, const u8 *args, const u8 *end) {
+  const u8 *p = args;
+  for (u32 i = 0; i < site->arg_count; ++i) {
+    if (site->arg_types[i] == LOG_ARG_STRING) {
+      if (p + sizeof(u16) > end) {
+        return 0;
+      }
+      p += sizeof(u16) + read_u16(p);
+    } else {
+      p += sizeof(u64);
+    }
+
+    if (p > end) {
+      return 0;
+    }
+  }
+
+  return (u64)(p - args);
+}
+
+static b8 parse_site(decoder *d, const u8 *p, u32 size) {
+  const u32 fixed_size = sizeof(u32) + 2 * sizeof(u8) + LOG_BINARY_MAX_ARGS +
+                         sizeof(u32) + 2 * sizeof(u16);
+  if (size < fixed_size) {
+    return FALSE;
+  }
+
+  u32 id = read_u32(p);
+  p += sizeof(u32);
+
+  if (id >= d->site_capacity) {
+    u32 new_capacity = d->site_capacity ? d->site_capacity : 64;
+    while (new_capacity <= id) {
+      new_capacity *= 2;
+    }
+    d->sites = realloc(d->sites, new_capacity * sizeof(decoded_site));
+    memset(d->sites + d->site_capacity, 0,
+           (new_capacity - d->site_capacity) * sizeof(decoded_site));
+    d->site_capacity = new_capacity;
+  }
+
+  decoded_site *site = &d->sites[id];
+  site->level = *p++;
+  site->arg_count = *p++;
+  memcpy(site->arg_types, p, LOG_BINARY_MAX_ARGS);
+  p += LOG_BINARY_MAX_ARGS;
+  site->line = read_u32(p);
+  p += sizeof(u32);
+  u16 format_length = read_u16(p);
+  u16 file_length = read_u16(p + sizeof(u16));
+  p += 2 * sizeof(u16);
+
+  if (fixed_size + format_length + file_length > size ||
+      site->arg_count > LOG_BINARY_MAX_ARGS || site->level > 5) {
+    return FALSE;
+  }
+
+  site->format = copy_string(p, format_length);
+  site->file = copy_string(p + format_length, file_length);
+  site->is_defined = TRUE;
+  return TRUE;
+}
+
+static b8 parse_records(decoder *d, const u8 *p, u32 size) {
+  if (size < sizeof(u32)) {
+    return FALSE;
+  }
+
+  const u8 *end = p + size;
+  u32 thread_index = read_u32(p);
+  p += sizeof(u32);
+
+  while (p < end) {
+    if (p + LOG_BINARY_RECORD_HEADER_SIZE > end) {
+      return FALSE;
+    }
+
+    u32 site_id = read_u32(p);
+    if (site_id >= d->site_capacity || !d->sites[site_id].is_defined) {
+      fprintf(stderr, "Record refers to unknown site %u.\n", site_id);
+      return FALSE;
+    }
+
+    if (d->record_count == d->record_capacity) {
+      d->record_capacity = d->record_capacity ? d->record_capacity * 2 : 1024;
+      d->records =
+          realloc(d->records, d->record_capacity * sizeof(decoded_record));
+    }
+
+    decoded_record *record = &d->records[d->record_count];
+    record->site_id = site_id;
+    record->thread_index = thread_index;
+    record->sequence = d->record_count;
+    memcpy(&record->timestamp, p + sizeof(u32), sizeof(f64));
+    record->args = p + LOG_BINARY_RECORD_HEADER_SIZE;
+
+    u64 size_of_args = args_size(&d->sites[site_id], record->args, end);
+    if (d->sites[site_id].arg_count && !size_of_args) {
+      return FALSE;
+    }
+
+    p = record->args + size_of_args;
+    d->record_count++;
+  }
+
+  return TRUE;
+}
+
+static b8 parse(decoder *d) {
+  if (d->size < 2 * sizeof(u32) || read_u32(d->data) != LOG_BINARY_MAGIC) {
+    fprintf(stderr, "Not a binary log file.\n");
+    return FALSE;
+  }
+
+  if (read_u32(d->data + sizeof(u32)) != LOG_BINARY_VERSION) {
+    fprintf(stderr, "Unsupported binary log version %u.\n",
+            read_u32(d->data + sizeof(u32)));
+    return FALSE;
+  }
+
+  u64 offset = 2 * sizeof(u32);
+  while (offset + sizeof(log_binary_block_header) <= d->size) {
+    log_binary_block_header header;
+    memcpy(&header, d->data + offset, sizeof(header));
+    offset += sizeof(header);
+
+    if (offset + header.size > d->size) {
+      // A crash can leave a partially written block at the end.
+      fprintf(stderr, "Ignoring truncated block at end of file.\n");
+      break;
+    }
+
+    const u8 *payload = d->data + offset;
+    b8 result = TRUE;
+    if (header.type == LOG_BLOCK_SITE) {
+      result = parse_site(d, payload, header.size);
+    } else if (header.type == LOG_BLOCK_RECORDS) {
+      result = parse_records(d, payload, header.size);
+    }
+
+    if (!result) {
+      fprintf(stderr, "Malformed block at offset %llu.\n",
+              (unsigned long long)(offset - sizeof(header)));
+      return FALSE;
+    }
+
+    offset += header.size;
+  }
+
+  return TRUE;
+}
+
+static int compare_records(const void *a, const void *b) {
+  const decoded_record *left = a;
+  const decoded_record *right = b;
+  if (left->timestamp != right->timestamp) {
+    return left->timestamp < right->timestamp ? -1 : 1;
+  }
+  return left->sequence < right->sequence ? -1 : 1;
+}
+
+/**
+ * Consumes the next recorded argument, whatever its type, so the ones after
+ * it are read from the right bytes.
+ *
+ * @param out_string Receives a copy of a string argument, which the caller
+ * frees, or NULL for a number. Can be NULL if strings are not wanted.
+ * @return The raw bits of a number, or 0 for a string or past the last
+ * argument.
+ */
+static u64 take_arg(const decoded_site *site, const u8 **args, u32 *arg_index,
+                    char **out_string) {
+  if (out_string) {
+    *out_string = NULL;
+  }
+  if (*arg_index >= site->arg_count) {
+    return 0;
+  }
+
+  if (site->arg_types[(*arg_index)++] == LOG_ARG_STRING) {
+    u16 length = read_u16(*args);
+    if (out_string) {
+      *out_string = copy_string(*args + sizeof(u16), length);
+    }
+    *args += sizeof(u16) + length;
+    return 0;
+  }
+
+  u64 raw = read_u64(*args);
+  *args += sizeof(u64);
+  return raw;
+}
+
+/**
+ * Formats a record by walking its format string and handing each conversion
+ * to snprintf with the matching recorded argument.
+ */
+static void format_record(const decoded_site *site, const u8 *args, FILE *out) {
+  const char *f = site->format;
+  u32 arg_index = 0;
+
+  // Fetches the next argument as a number.
+#define NEXT_ARG() take_arg(site, &args, &arg_index, NULL)
+
+  while (*f) {
+    if (*f != '%') {
+      fputc(*f++, out);
+      continue;
+    }
+
+    if (f[1] == '%') {
+      fputc('%', out);
+      f += 2;
+      continue;
+    }
+
+    // Copy the conversion, dropping length modifiers; the cast below supplies
+    // the right width.
+    char spec[64];
+    u32 spec_length = 0;
+    spec[spec_length++] = *f++;
+
+    i32 star_values[2];
+    u32 star_count = 0;
+    while (*f && strchr("-+ #0123456789.*", *f) && spec_length < 48) {
+      if (*f == '*' && star_count < 2) {
+        star_values[star_count++] = (i32)NEXT_ARG();
+      }
+      spec[spec_length++] = *f++;
+    }
+    while (*f && strchr("hlLjzt", *f)) {
+      ++f;
+    }
+
+    char conversion = *f ? *f++ : '\0';
+    char buffer[LOG_BINARY_MAX_STRING_LENGTH + 128];
+    buffer[0] = '\0';
+
+    switch (conversion) {
+    case 'd':
+    case 'i':
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X': {
+      spec[spec_length++] = 'l';
+      spec[spec_length++] = 'l';
+      spec[spec_length++] = conversion;
+      spec[spec_length] = '\0';
+      long long value = (long long)NEXT_ARG();
+      if (star_count == 2) {
+        snprintf(buffer, sizeof(buffer), spec, star_values[0], star_values[1],
+                 value);
+      } else if (star_count == 1) {
+        snprintf(buffer, sizeof(buffer), spec, star_values[0], value);
+      } else {
+        snprintf(buffer, sizeof(buffer), spec, value);
+      }
+    } break;
+
+    case 'c': {
+      spec[spec_length++] = 'c';
+      spec[spec_length] = '\0';
+      snprintf(buffer, sizeof(buffer), spec, (int)NEXT_ARG());
+    } break;
+
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A': {
+      spec[spec_length++] = conversion;
+      spec[spec_length] = '\0';
+      u64 raw = NEXT_ARG();
+      f64 value;
+      memcpy(&value, &raw, sizeof(f64));
+      if (star_count == 2) {
+        snprintf(buffer, sizeof(buffer), spec, star_values[0], star_values[1],
+                 value);
+      } else if (star_count == 1) {
+        snprintf(buffer, sizeof(buffer), spec, star_values[0], value);
+      } else {
+        snprintf(buffer, sizeof(buffer), spec, value);
+      }
+    } break;
+
+    case 'p': {
+      snprintf(buffer, sizeof(buffer), "0x%llx",
+               (unsigned long long)NEXT_ARG());
+    } break;
+
+    case 's': {
+      b8 is_missing = arg_index >= site->arg_count;
+      char *value = NULL;
+      take_arg(site, &args, &arg_index, &value);
+
+      spec[spec_length++] = 's';
+      spec[spec_length] = '\0';
+      const char *text = value ? value
+                         : is_missing ? "<missing>"
+                                      : "<not a string>";
+      if (star_count == 2) {
+        snprintf(buffer, sizeof(buffer), spec, star_values[0], star_values[1],
+                 text);
+      } else if (star_count == 1) {
+        snprintf(buffer, sizeof(buffer), spec, star_values[0], text);
+      } else {
+        snprintf(buffer, sizeof(buffer), spec, text);
+      }
+      free(value);
+    } break;
+
+    default:
+      // Unknown conversion; print it untouched.
+      spec[spec_length++] = conversion;
+      spec[spec_length] = '\0';
+      snprintf(buffer, sizeof(buffer), "%s", spec);
+      break;
+    }
+
+    fputs(buffer, out);
+  }
+
+#undef NEXT_ARG
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s <input.vlog> [output.txt]\n", argv[0]);
+    return 1;
+  }
+
+  FILE *in = fopen(argv[1], "rb");
+  if (!in) {
+    fprintf(stderr, "Failed to open '%s'.\n", argv[1]);
+    return 1;
+  }
+
+  fseek(in, 0, SEEK_END);
+  long file_size = ftell(in);
+  fseek(in, 0, SEEK_SET);
+
+  u8 *data = malloc(file_size > 0 ? (u64)file_size : 1);
+  if (fread(data, 1, (u64)file_size, in) != (u64)file_size) {
+    fprintf(stderr, "Failed to read '%s'.\n", argv[1]);
+    fclose(in);
+    return 1;
+  }
+  fclose(in);
+
+  FILE *out = stdout;
+  if (argc > 2) {
+    out = fopen(argv[2], "w");
+    if (!out) {
+      fprintf(stderr, "Failed to open '%s' for writing.\n", argv[2]);
+      return 1;
+    }
+  }
+
+  decoder d = {0};
+  d.data = data;
+  d.size = (u64)file_size;
+
+  b8 result = parse(&d);
+
+  // Per-thread buffers are flushed independently, so restore global order.
+  qsort(d.records, d.record_count, sizeof(decoded_record), compare_records);
+
+  f64 start_time = d.record_count ? d.records[0].timestamp : 0.0;
+  for (u64 i = 0; i < d.record_count; ++i) {
+    const decoded_record *record = &d.records[i];
+    const decoded_site *site = &d.sites[record->site_id];
+    fprintf(out, "[%12.6f] [T%02u] %s", record->timestamp - start_time,
+            record->thread_index, level_strings[site->level]);
+    format_record(site, record->args, out);
+    fputc('\n', out);
+  }
+
+  if (out != stdout) {
+    fclose(out);
+  }
+
+  for (u32 i = 0; i < d.site_capacity; ++i) {
+    free(d.sites[i].format);
+    free(d.sites[i].file);
+  }
+  free(d.sites);
+  free(d.records);
+  free(data);
+
+  return result ? 0 : 1;
+}